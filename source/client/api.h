@@ -9,6 +9,7 @@
 #include <sys/stat.h>
 
 #include "definitions.h"
+#include "io_utils.h"
 
 #define UNIX_PATH_MAX 108
 #define RESPONSE_BUFF_SIZE 2
@@ -16,9 +17,10 @@
 struct request_args {
     char *pathname;
     int flags;
-    char *n;
+    int n;
     char *content;
-    int size;
+    size_t size;
+    size_t offset;
 };
 
 struct response_args {
@@ -35,6 +37,7 @@ int openfile = 0;
 char *last_request_target = NULL;                                               // Indica il filename dell'ultima a cui si riferisce l'ultima operazione openFile(, O_CREATE | O_LOCK)
 char *sel_dirname = NULL;                                                       // Indica la directory in cui salvare i file inviati dal server
 int print_upper_r = 0;                                                          // Indica se la verbose mode è richiesta
+uint64_t request_id = 0;                                                        // Identificativo dell'ultima richiesta inviata al server
 
 /*
  * Abilita la modalità verbose per l'operazione -R, necessario per poter fornire informazioni per ogni singolo file letto
@@ -57,10 +60,14 @@ void reset_dirname();
 /*
  * Implementa il salvataggio di file letti dal server oppure espulsi a seguito di un'operazione di scrittura
  * Parametri:
- *      file_list: la lista dei file da memorizzare sullo storage, con il corrispondente contenuto
+ *      file_list: il payload della risposta, contiene un frame per ogni file da memorizzare sullo storage, vedi "definitions.h"
+ *      size: la dimensione in byte del payload
+ * Errno:
+ *      ENOENT: se la directory di salvataggio non è stata impostata
+ *      EPROTO: se il payload non contiene una sequenza di frame valida
  * Ritorna: 0 in caso di successo, -1 altrimenti
  */
-int save_file(char *file_list);
+int save_file(char *file_list, size_t size);
 
 /*
  * Imposta la variabile openfile, necessaria per verificare se l'operazione precedente alla writeFile è stata openFile(pathname, O_CREATE | O_LOCK)
@@ -71,19 +78,45 @@ int save_file(char *file_list);
 void set_openfile(int n_val, char *pathname);
 
 /*
- * Gestisce la generazione del messaggio di richiesta e l'invio del messaggio al server
+ * Gestisce la generazione del messaggio di richiesta e l'invio del messaggio al server, la richiesta riceve l'identificativo successivo a request_id
  * Parametri: 
  *      type: la tipologia dell'operazione che deve inviare la richiesta al server, le tipologie sono definite in definitions.h
  *      args: eventuali argomenti da includere nella richiesta
  * Errno: 
- *      EINVAL: se type è NULL
+ *      EINVAL: se type non è una tipologia valida oppure se mancano gli argomenti richiesti da type
  *      vedi man write per altri errno impostati da write
  * Ritorna: 0 in caso di successo, -1 in caso di errore
  */
-int send_request(char *type, request_args *args);
+int send_request(int type, request_args *args);
+
+/*
+ * Riceve il messaggio di risposta successivo del server, senza elaborarlo
+ * Parametri:
+ *      header: il puntatore in cui memorizzare l'intestazione della risposta
+ *      payload: il puntatore in cui memorizzare il payload, terminato da '\0', da passare a process_response
+ * Errno:
+ *      EPROTO: se la versione del protocollo della risposta non è supportata
+ *      ECONNRESET: se il server ha chiuso la connessione prima di inviare la risposta completa
+ *      vedi man read per errno impostati da read
+ * Ritorna: 0 in caso di successo, -1 in caso di errore
+ */
+int recv_response(frame_header *header, char **payload);
 
 /*
- * Gestisce la ricezione e l'elaborazione del messaggio di risposta del server
+ * Elabora un messaggio di risposta ricevuto con recv_response, il payload viene deallocato oppure ceduto al chiamante tramite args
+ * Parametri:
+ *      type: la tipologia dell'operazione a cui si riferisce la risposta
+ *      args: eventuali argomenti in cui inserire i risultati ricevuti dal server
+ *      header: l'intestazione della risposta
+ *      response_m: il payload della risposta
+ * Errno:
+ *      vedi manage_response
+ * Ritorna: 0 se l'operazione ha avuto successo, -1 altrimenti
+ */
+int process_response(int type, response_args *args, frame_header *header, char *response_m);
+
+/*
+ * Gestisce la ricezione e l'elaborazione del messaggio di risposta del server all'ultima richiesta inviata
  * Parametri:
  *      type: la tipologia dell'operazione che deve ricevere la risposta dal server, le tipologie sono definite in definitions.h
  *      args: eventuali argomenti in cui inserire i risultati ricevuti dal server
@@ -96,10 +129,12 @@ int send_request(char *type, request_args *args);
  *      EBADF: se il file non è stato aperto prima dell'operazione
  *      EPERM: se la lock del file è posseduta da un altro utente
  *      ENOMEM: se il file è troppo grande per poter essere memorizzato sul server
+ *      EPROTO: se la risposta del server non rispetta il protocollo oppure non si riferisce all'ultima richiesta inviata
+ *      ECONNRESET: se il server ha chiuso la connessione prima di inviare la risposta completa
  *      vedi man read per errno impostati da read
  * Ritorna: 0 in caso di successo, -1 in caso di successo
  */
-int manage_response(char *type, response_args *args);
+int manage_response(int type, response_args *args);
 
 /*
  * Connette il client con il server con un socket AF_UNIX
@@ -223,6 +258,44 @@ int writeFile(const char *pathname, const char *dirname);
  */
 int appendToFile(const char *pathname, void *buf, size_t size, const char *dirname);
 
+/*
+ * Invia al server una richiesta di lettura di un intervallo di byte del file con filename == pathname, sono trasferiti solo i byte richiesti
+ * Parametri:
+ *      pathname: il nome del file da leggere
+ *      offset: la posizione del primo byte da leggere
+ *      length: il numero massimo di byte da leggere
+ *      buf: il puntatore in cui memorizzare i byte letti, da deallocare con free
+ *      size: il puntatore in cui memorizzare il numero di byte letti, minore di length se l'intervallo supera la fine del file
+ * Errno:
+ *      ENOTCONN: se il client non ha aperto la connessione con il server
+ *      ENOENT: se il file della richiesta non esiste sul server
+ *      EINVAL: se si è verificato un errore sconosciuto sul server
+ *      ENAMETOOLONG: se il/i filename è/sono di lunghezza eccessiva
+ *      EPERM: se la lock sul file è posseduta da un altro utente
+ * Ritorna: 0 in caso di successo, -1 in caso di errore, imposta errno adeguatamente
+ */
+int readFileRange(const char *pathname, size_t offset, size_t length, void **buf, size_t *size);
+
+/*
+ * Invia al server una richiesta di scrittura di size byte nel file con filename == pathname a partire da offset, i byte oltre la fine del file lo estendono
+ * Parametri:
+ *      pathname: il nome del file in cui scrivere
+ *      offset: la posizione del primo byte da scrivere, al più la dimensione del file sul server
+ *      buf: il buffer che contiene i byte da scrivere
+ *      size: la dimensione del buffer
+ *      dirname: la directory sulla macchina, su cui viene eseguito il client, in cui salvare eventuali file rimossi dal server per mancanza di spazio
+ * Errno:
+ *      ENOTCONN: se il client non ha aperto la connessione con il server
+ *      ENOENT: se il file della richiesta non esiste sul server
+ *      EINVAL: se offset è oltre la fine del file oppure si è verificato un errore sconosciuto sul server
+ *      ENAMETOOLONG: se il/i filename è/sono di lunghezza eccessiva
+ *      EBADF: se il file non è stato aperto prima dell'operazione
+ *      EPERM: se la lock sul file è posseduta da un altro utente
+ *      ENOMEM: se il file risultante è troppo grande per poter essere memorizzato sul server
+ * Ritorna: 0 in caso di successo, -1 in caso di errore, imposta errno adeguatamente
+ */
+int writeFileAt(const char *pathname, size_t offset, void *buf, size_t size, const char *dirname);
+
 /*
  * Invia al server una richiesta di acquisizione della lock del file con filename == pathname
  * Parametri:
@@ -265,6 +338,124 @@ int unlockFile(const char *pathname);
  */
 int removeFile(const char *pathname);
 
+/*
+ * Crea sul server un file con il contenuto del file pathname, equivale a openFile(pathname, O_CREATE | O_LOCK), writeFile e closeFile con una sola richiesta
+ * Parametri:
+ *      pathname: il nome del file da creare
+ *      dirname: la directory sulla macchina, su cui viene eseguito il client, in cui salvare eventuali file rimossi dal server per mancanza di spazio
+ * Errno:
+ *      ENOTCONN: se il client non ha aperto la connessione con il server
+ *      ENOENT: se il file pathname non esiste sulla macchina del client
+ *      EPERM: se l'utente non ha i permessi di accesso alla directory dirname
+ *      EEXIST: se il file esiste già sul server
+ *      ENAMETOOLONG: se il filename è di lunghezza eccessiva
+ *      ENOMEM: se il file è troppo grande per poter essere memorizzato sul server
+ * Ritorna: 0 in caso di successo, -1 in caso di errore, imposta errno adeguatamente
+ */
+int putFile(const char *pathname, const char *dirname);
+
+/*
+ * Legge dal server il contenuto del file con filename == pathname, equivale a openFile(pathname, O_LOCK), readFile e closeFile con una sola richiesta
+ * Parametri:
+ *      pathname: il nome del file da leggere
+ *      buf: il puntatore in cui memorizzare il contenuto del file, da deallocare con free
+ *      size: il puntatore in cui memorizzare la dimensione del contenuto
+ * Errno:
+ *      ENOTCONN: se il client non ha aperto la connessione con il server
+ *      ENAMETOOLONG: se il filename è di lunghezza eccessiva
+ *      ENOENT: se il file non esiste sul server
+ *      EPERM: se la lock sul file è posseduta da un altro utente
+ * Ritorna: 0 in caso di successo, -1 in caso di errore, imposta errno adeguatamente
+ */
+int getFile(const char *pathname, void **buf, size_t *size);
+
+/*
+ * Legge dal server una sequenza di file con una richiesta GETFILE per ogni file, vedi getFile
+ * Le richieste sono inviate senza attendere le risposte, fino a PIPELINE_DEPTH richieste senza risposta, le letture su file diversi sono eseguite in parallelo dal server
+ * Parametri:
+ *      pathnames: i percorsi assoluti dei file da leggere
+ *      n: il numero di file
+ *      bufs: l'array di n puntatori in cui memorizzare il contenuto dei file letti, da deallocare con free, NULL se il file non è stato letto
+ *      sizes: l'array di n elementi in cui memorizzare la dimensione dei file letti
+ *      errors: l'array di n elementi in cui memorizzare 0 se il file è stato letto, altrimenti l'errno della lettura fallita
+ *              ENAMETOOLONG indica che il filename supera UNIX_PATH_MAX e la richiesta non è stata inviata
+ * Errno:
+ *      ENOTCONN: se il client non ha una connessione aperta con il server
+ *      EPROTO: se una risposta non si riferisce ad una richiesta inviata
+ *      vedi manage_response per gli errori di comunicazione con il server
+ * Ritorna: 0 se il server ha risposto a tutte le richieste, anche se alcune operazioni sono fallite, -1 in caso di errore di comunicazione
+ */
+int readFiles(char **pathnames, int n, void **bufs, size_t *sizes, int *errors);
+
+/*
+ * Scrive sul server una sequenza di file con una richiesta PUTFILE per ogni file, vedi putFile
+ * Le richieste sono inviate senza attendere le risposte, fino a PIPELINE_DEPTH richieste senza risposta, le scritture su file diversi sono eseguite in parallelo dal server
+ * Parametri:
+ *      pathnames: i percorsi assoluti dei file da scrivere
+ *      n: il numero di file
+ *      dirname: la directory in cui salvare eventuali file rimossi dal server per mancanza di spazio, NULL se devono essere ignorati
+ *      errors: l'array di n elementi in cui memorizzare 0 se il file è stato scritto, altrimenti l'errno della scrittura fallita
+ *              EEXIST indica che il file esiste già sul server e non è stato scritto
+ *              ENAMETOOLONG indica che il filename supera UNIX_PATH_MAX e la richiesta non è stata inviata
+ * Errno:
+ *      ENOTCONN: se il client non ha una connessione aperta con il server
+ *      EPROTO: se una risposta non si riferisce ad una richiesta inviata
+ *      vedi manage_response per gli errori di comunicazione con il server
+ * Ritorna: 0 se il server ha risposto a tutte le richieste, anche se alcune operazioni sono fallite, -1 in caso di errore di comunicazione
+ */
+int writeFiles(char **pathnames, int n, const char *dirname, int *errors);
+
+/*
+ * Riceve ed elabora la risposta ad una delle richieste inviate da readFiles o writeFiles
+ * Parametri:
+ *      base: l'identificativo della prima richiesta inviata
+ *      n_sent: il numero di richieste inviate
+ *      files: per ogni richiesta senza risposta, in posizione (identificativo - base) % PIPELINE_DEPTH, l'indice del file a cui si riferisce, -1 nelle posizioni libere
+ *      type: la tipologia delle richieste
+ *      bufs: l'array in cui memorizzare il contenuto dei file letti, NULL se le richieste non leggono file
+ *      sizes: l'array in cui memorizzare la dimensione dei file letti, NULL se le richieste non leggono file
+ *      errors: l'array in cui memorizzare l'errno delle operazioni fallite
+ * Errno:
+ *      EPROTO: se la risposta non si riferisce ad una richiesta senza risposta
+ *      vedi recv_response
+ * Ritorna: 0 in caso di successo, -1 in caso di errore di comunicazione
+ */
+static int collect_response(uint64_t base, long n_sent, int *files, int type, void **bufs, size_t *sizes, int *errors);
+
+/*
+ * Salva nella directory sel_dirname il contenuto di un file ricevuto dal server, con il solo nome senza il percorso con cui è memorizzato nel server
+ * Parametri:
+ *      name: il filename del file nel server, terminato da '\0'
+ *      content: il contenuto del file
+ *      size: la dimensione in byte del contenuto
+ * Errno:
+ *      vedi man fopen
+ * Ritorna: 0 in caso di successo, -1 altrimenti
+ */
+static int store_file(char *name, char *content, size_t size);
+
+/*
+ * Riceve la risposta a readNFiles, divisa dal server in più risposte, e ne elabora i file uno alla volta appena arrivano
+ * Solo il contenuto del file in corso di ricezione è in memoria, i file sono salvati in sel_dirname se è impostata
+ * Errno:
+ *      EPROTO: se una risposta non si riferisce all'ultima richiesta inviata oppure non contiene una sequenza di frame valida
+ *      vedi manage_response
+ * Ritorna: 0 in caso di successo, -1 altrimenti
+ */
+static int recv_read_files();
+
+/*
+ * Riceve esattamente size byte dal socket
+ * Parametri:
+ *      buf: il buffer in cui ricevere i byte
+ *      size: il numero di byte da ricevere
+ * Errno:
+ *      ECONNRESET: se il server ha chiuso la connessione prima di inviare tutti i byte
+ *      vedi man read per errno impostati da read
+ * Ritorna: 0 in caso di successo, -1 altrimenti
+ */
+static int recv_exact(void *buf, size_t size);
+
 void set_p() {
     print_upper_r = 1;
 }
@@ -287,14 +478,13 @@ void reset_dirname() {
     }
 }
 
-int save_file(char *file_list) {
-    FILE *file;
-    char delimiter[2] = {1, '\0'};
+int save_file(char *file_list, size_t size) {
+    frame_header header;
 
-    char *pathname;
-    char *filename;
+    char name[UNIX_PATH_MAX + 1];
     char *content;
-    char *saveptr;
+
+    size_t offset = 0;
 
     if(sel_dirname == NULL) {
         errno = ENOENT;
@@ -302,38 +492,33 @@ int save_file(char *file_list) {
         return -1;
     }
 
-    if(strcmp(file_list, "") == 0) {
-        return 0;
-    }
-
-    filename = strtok_r(file_list, delimiter, &saveptr);
-
-    while(filename != NULL) {
-        content = strtok_r(NULL, delimiter, &saveptr);
+    // Ogni file è rappresentato da un frame, il filename e il contenuto non sono terminati da '\0'
+    while(offset + sizeof(frame_header) <= size) {
+        memcpy(&header, file_list + offset, sizeof(frame_header));
+        offset += sizeof(frame_header);
 
-        pathname = malloc((UNIX_PATH_MAX + strlen(content) + 2) * sizeof(char));
+        if(header.name_len > UNIX_PATH_MAX || offset + header.name_len + (header.flags & DISCARD_VICTIMS ? 0 : header.payload_len) > size) {
+            errno = EPROTO;
 
-        strcpy(pathname, sel_dirname);
-            
-        if(sel_dirname[strlen(sel_dirname) - 1] != '/') {
-            strcat(pathname, "/");
+            return -1;
         }
 
-        filename = strrchr(filename, '/') + 1;
+        memcpy(name, file_list + offset, header.name_len);
+        name[header.name_len] = '\0';
 
-        strcat(pathname, filename);
+        if(header.flags & DISCARD_VICTIMS) {
+            // Il frame contiene solo il filename e la dimensione del file, non c'è contenuto da salvare
+            offset += header.name_len;
 
-        if((file = fopen(pathname, "w")) == NULL) {
-            return -1;
+            continue;
         }
 
-        fwrite(content, sizeof(char), strlen(content), file);
+        content = file_list + offset + header.name_len;
+        offset += header.name_len + header.payload_len;
 
-        free(pathname);
-
-        fclose(file);
-
-        filename = strtok_r(NULL, delimiter, &saveptr);
+        if(store_file(name, content, header.payload_len) == -1) {
+            return -1;
+        }
     }
 
     return 0;
@@ -371,302 +556,228 @@ int check_openfile(char *pathname) {
     return 0;
 }
 
-int send_request(char *type, request_args *args) {
-    char *request_m;
-    char delimiter[2] = {1, '\0'};
-
-    int request_size;
-
-    if(type == NULL) {
-        errno = EINVAL;
-
-        return -1;
-    }
-
-    // Genera il messaggio di richiesta
-    if(strcmp(type, CLOSECONN) == 0) {
-        request_m = malloc(2 * sizeof(char));
-
-        strcpy(request_m, type);
-    } else if(strcmp(type, OPENFILE) == 0) {
+int send_request(int type, request_args *args) {
+    frame_header header;
+    file_range range;
+    struct iovec iov[4];
+    char *payload = NULL;
+    size_t range_len = 0;
+
+    header.version = PROTOCOL_VERSION;
+    header.opcode = type;
+    header.flags = 0;
+    header.name_len = 0;
+    header.payload_len = 0;
+    header.request_id = request_id + 1;
+
+    // Genera l'intestazione della richiesta, il filename e il payload sono inviati senza essere copiati
+    if(type == CLOSECONN || type == WRITE_NO_CONTENT) {
+        // La richiesta è composta dalla sola intestazione
+    } else if(type == OPENFILE) {
         if(args == NULL || args->pathname == NULL || args->flags < 0 || args->flags > 3) {
             errno = EINVAL;
 
             return -1;
         }
 
-        request_m = malloc((UNIX_PATH_MAX + 5) * sizeof(char));
-
-        strcpy(request_m, type);
-        strcat(request_m, delimiter);
-        strcat(request_m, args->pathname);
-        strcat(request_m, delimiter);
-
-        switch (args->flags) {
-            case 0:
-                strcat(request_m, "0");
-                break;
-            case 1:
-                strcat(request_m, "1");
-                break;
-            case 2:
-                strcat(request_m, "2");
-                break;
-            case 3:
-                strcat(request_m, "3");
-                break;
+        header.flags = args->flags;
+        header.name_len = strlen(args->pathname);
 
+        if(sel_dirname == NULL) {
+            // I file eventualmente espulsi non verranno salvati, quindi il loro contenuto non deve essere inviato
+            header.flags |= DISCARD_VICTIMS;
         }
-    } else if(strcmp(type, CLOSEFILE) == 0) {
+    } else if(type == CLOSEFILE || type == READFILE || type == GETFILE || type == LOCKFILE || type == UNLOCKFILE || type == REMOVEFILE) {
         if(args == NULL || args->pathname == NULL) {
             errno = EINVAL;
 
             return -1;
         }
 
-        request_m = malloc((UNIX_PATH_MAX + 3) * sizeof(char));
-
-        strcpy(request_m, type);
-        strcat(request_m, delimiter);
-        strcat(request_m, args->pathname);
-    } else if(strcmp(type, WRITEFILE) == 0) {
+        header.name_len = strlen(args->pathname);
+    } else if(type == WRITEFILE || type == APPENDFILE || type == PUTFILE) {
         if(args == NULL || args->pathname == NULL || args->content == NULL) {
             errno = EINVAL;
 
             return -1;
         }
 
-        request_m = malloc((4 + UNIX_PATH_MAX + strlen(args->content)) * sizeof(char));
-
-        strcpy(request_m, type);
-        strcat(request_m, delimiter);
-        strcat(request_m, args->pathname);
-        strcat(request_m, delimiter);
-        strcat(request_m, args->content);
-    } else if(strcmp(type, READFILE) == 0) {
-        if(args == NULL || args->pathname == NULL) {
-            errno = EINVAL;
+        header.name_len = strlen(args->pathname);
+        header.payload_len = args->size;
+        payload = args->content;
 
-            return -1;
+        if(sel_dirname == NULL) {
+            header.flags |= DISCARD_VICTIMS;
         }
-
-        request_m = malloc((UNIX_PATH_MAX + 3) * sizeof(char));
-
-        strcpy(request_m, type);
-        strcat(request_m, delimiter);
-        strcat(request_m, args->pathname);
-    } else if(strcmp(type, READNFILE) == 0) {
-        if(args == NULL || args->n == NULL) {
+    } else if(type == READRANGE || type == WRITEAT) {
+        if(args == NULL || args->pathname == NULL || (type == WRITEAT && args->content == NULL)) {
             errno = EINVAL;
 
             return -1;
         }
 
-        request_m = malloc((strlen(args->n) + 3) * sizeof(char));
+        // Il payload inizia con l'intervallo, per WRITEAT seguito dai byte da scrivere
+        range.offset = args->offset;
+        range.length = args->size;
+        range_len = sizeof(file_range);
 
-        strcpy(request_m, type);
-        strcat(request_m, delimiter);
-        strcat(request_m, args->n);
-    } else if(strcmp(type, APPENDFILE) == 0) {
-        if(args == NULL || args->pathname == NULL || args->content == NULL) {
-            errno = EINVAL;
-
-            return -1;
-        }
+        header.name_len = strlen(args->pathname);
+        header.payload_len = range_len;
 
-        request_m = malloc((4 + UNIX_PATH_MAX + args->size) * sizeof(char));
+        if(type == WRITEAT) {
+            header.payload_len += args->size;
+            payload = args->content;
 
-        strcpy(request_m, type);
-        strcat(request_m, delimiter);
-        strcat(request_m, args->pathname);
-        strcat(request_m, delimiter);
-        strcat(request_m, args->content);
-    } else if(strcmp(type, LOCKFILE) == 0) {
-        if(args == NULL || args->pathname == NULL) {
+            if(sel_dirname == NULL) {
+                header.flags |= DISCARD_VICTIMS;
+            }
+        }
+    } else if(type == READNFILE) {
+        if(args == NULL) {
             errno = EINVAL;
 
             return -1;
         }
 
-        request_m = malloc((strlen(args->pathname) + 3) * sizeof(char));
+        header.payload_len = sizeof(int);
+        payload = (char *)&args->n;
+    } else {
+        errno = EINVAL;
 
-        strcpy(request_m, type);
-        strcat(request_m, delimiter);
-        strcat(request_m, args->pathname);
-    } else if(strcmp(type, UNLOCKFILE) == 0) {
-        if(args == NULL || args->pathname == NULL) {
-            errno = EINVAL;
+        return -1;
+    }
 
-            return -1;
-        }
+    iov[0].iov_base = &header;
+    iov[0].iov_len = sizeof(frame_header);
+    iov[1].iov_base = header.name_len > 0 ? args->pathname : NULL;
+    iov[1].iov_len = header.name_len;
+    iov[2].iov_base = &range;
+    iov[2].iov_len = range_len;
+    iov[3].iov_base = payload;
+    iov[3].iov_len = header.payload_len - range_len;
+
+    // Invia l'intestazione, il filename e il payload con una sola writev
+    if(writevn(socket_fd, iov, 4) == -1) {
+        return -1;
+    }
 
-        request_m = malloc((strlen(args->pathname) + 3) * sizeof(char));
+    request_id = header.request_id;
 
-        strcpy(request_m, type);
-        strcat(request_m, delimiter);
-        strcat(request_m, args->pathname);
-    } else if(strcmp(type, REMOVEFILE) == 0) {
-        if(args == NULL || args->pathname == NULL) {
-            errno = EINVAL;
+    return 0;
+}
 
-            return -1;
+int recv_response(frame_header *header, char **payload) {
+    ssize_t read_size;
+
+    if((read_size = readn(socket_fd, header, sizeof(frame_header))) != sizeof(frame_header)) {
+        if(read_size != -1) {
+            // Il server ha chiuso la connessione prima di inviare la risposta completa
+            errno = ECONNRESET;
         }
 
-        request_m = malloc((strlen(args->pathname) + 3) * sizeof(char));
+        return -1;
+    }
 
-        strcpy(request_m, type);
-        strcat(request_m, delimiter);
-        strcat(request_m, args->pathname);
-    } else if(strcmp(type, WRITE_NO_CONTENT) == 0) {
-        request_m = malloc(3 * sizeof(char));
+    if(header->version != PROTOCOL_VERSION) {
+        errno = EPROTO;
 
-        strcpy(request_m, WRITE_NO_CONTENT);
+        return -1;
     }
 
-    request_size = strlen(request_m) + 1;
-
-    if(write(socket_fd, &request_size, sizeof(request_size)) == -1) {
+    // Il payload viene letto direttamente nel buffer che sarà restituito al chiamante, con un terminatore aggiuntivo
+    if((*payload = malloc((header->payload_len + 1) * sizeof(char))) == NULL) {
         return -1;
     }
 
-    if(write(socket_fd, request_m, request_size) == -1) {
+    if((read_size = readn(socket_fd, *payload, header->payload_len)) != header->payload_len) {
+        if(read_size != -1) {
+            errno = ECONNRESET;
+        }
+
+        free(*payload);
+
         return -1;
     }
 
-    free(request_m);
+    (*payload)[header->payload_len] = '\0';
 
     return 0;
 }
 
-int manage_response(char *type, response_args *args) {
+int manage_response(int type, response_args *args) {
+    frame_header header;
     char *response_m;
-    char *response_code;
-    char *filename;
-    char *content;
-    char *saveptr;
-    char *temp;
-    char delimiter[2] = {1, '\0'};
-
-    int response_size;
-    int result;
 
-    if(read(socket_fd, &response_size, sizeof(int)) == -1) {
+    if(recv_response(&header, &response_m) == -1) {
         return -1;
     }
 
-    response_m = malloc(response_size * sizeof(char));
-    memset(response_m, 0, response_size);
+    // Le operazioni sincrone attendono la risposta prima di inviare un'altra richiesta
+    if(header.request_id != request_id) {
+        free(response_m);
+
+        errno = EPROTO;
 
-    if(read(socket_fd, response_m, response_size) == -1) {
         return -1;
     }
 
-    temp = malloc(response_size * sizeof(char));
-    strcpy(temp, response_m);
+    return process_response(type, args, &header, response_m);
+}
 
-    response_code = strtok_r(temp, delimiter, &saveptr);
-    // L'operazione ha avuto successo e la risposta viene elaborata in base al tipo della richiesta
-    if(strcmp(response_code, SUCCESS) == 0) {
-        if(strcmp(type, OPENFILE) == 0) {
-            if(response_size > 2) {
-                if(sel_dirname != NULL) {
-                    save_file(response_m + 2);
-                }
-            }
-        } else if(strcmp(type, WRITEFILE) == 0) {
-            if(response_size > 2) {
-                if(sel_dirname != NULL) {
-                    save_file(response_m + 2);
-                }
-            }
-        } else if(strcmp(type, READFILE) == 0) {
-            if(response_size > 2) {
-                char *file_content;
-                char *t_content;
+int process_response(int type, response_args *args, frame_header *header, char *response_m) {
+    int result = -1;
 
-                if(args == NULL) {
-                    errno = EINVAL;
+    // L'operazione ha avuto successo e la risposta viene elaborata in base al tipo della richiesta
+    if(header->opcode == SUCCESS) {
+        result = 0;
 
-                    return -1;
+        if(type == OPENFILE || type == WRITEFILE || type == APPENDFILE || type == PUTFILE || type == WRITEAT) {
+            // Il payload contiene gli eventuali file espulsi dal server
+            if(header->payload_len > 0) {
+                if(sel_dirname != NULL) {
+                    save_file(response_m, header->payload_len);
                 }
-
-                t_content = strtok_r(NULL, delimiter, &saveptr);
-
-                file_content = malloc((strlen(t_content) + 1) * sizeof(char));
-
-                strcpy(file_content, t_content);
-        
-                *args->buf = file_content;
-                *args->size = strlen(file_content);
             }
-        } else if(strcmp(type, READNFILE) == 0) {
-            if(response_size > 2) {
-                if(print_upper_r) {
-                    filename = strtok_r(NULL, delimiter, &saveptr);
-                    while(filename != NULL) {
-                        content = strtok_r(NULL, delimiter, &saveptr);
+        } else if(type == READFILE || type == GETFILE || type == READRANGE) {
+            if(args == NULL) {
+                free(response_m);
 
-                        printf("-R: Successo, letto il file %s, di %ldbytes\n", filename, strlen(content));
-
-                        filename = strtok_r(NULL, delimiter, &saveptr);;
-                    }
-                }
+                errno = EINVAL;
 
-                if(sel_dirname != NULL) {
-                    save_file(response_m + 2);
-                }
-            } else {
-                if(print_upper_r) {
-                    printf("-R: Successo, il server non contiene alcun file\n");
-                }
+                return -1;
             }
-        } else if(strcmp(type, APPENDFILE) == 0) {
-            if(response_size > 2) {
-                if(sel_dirname != NULL) {
-                    save_file(response_m + 2);
-                }
-            }             
-        } 
 
-        result = 0;
-    }
+            // Il buffer del payload viene ceduto al chiamante
+            *args->buf = response_m;
+            *args->size = header->payload_len;
 
-    // Verifica se è avvenuto un errore e imposta errno
-    if(strcmp(response_code, ALREADY_OPENED) == 0) {
+            response_m = NULL;
+        }
+    } else if(header->opcode == ALREADY_OPENED) {
+        // Verifica se è avvenuto un errore e imposta errno
         errno = EBADR;
-
-        result = -1;
-    } else if(strcmp(response_code, FILE_NOT_EXIST) == 0) {
+    } else if(header->opcode == FILE_NOT_EXIST) {
         errno = ENOENT;
-
-        result = -1;
-    } else if(strcmp(response_code, UNKNOWN) == 0) {
+    } else if(header->opcode == UNKNOWN) {
         errno = EINVAL;
-
-        result = -1;
-    } else if(strcmp(response_code, FILENAME_TOO_LONG) == 0) {
+    } else if(header->opcode == FILENAME_TOO_LONG) {
         errno = ENAMETOOLONG;
-
-        result = -1;
-    } else if(strcmp(response_code, FILE_ALREADY_EXIST) == 0) {
+    } else if(header->opcode == FILE_ALREADY_EXIST) {
         errno = EEXIST;
-
-        result = -1;
-    } else if(strcmp(response_code, FILE_NOT_OPENED) == 0) {
+    } else if(header->opcode == FILE_NOT_OPENED) {
         errno = EBADF;
-
-        result = -1;
-    } else if(strcmp(response_code, FILE_LOCKED) == 0) {
+    } else if(header->opcode == FILE_LOCKED) {
         errno = EPERM;
-
-        result = -1;
-    } else if(strcmp(response_code, NOT_ENO_MEM) == 0) {
+    } else if(header->opcode == NOT_ENO_MEM) {
         errno = ENOMEM;
-
-        result = -1;
+    } else if(header->opcode == BAD_REQUEST) {
+        errno = EPROTO;
+    } else if(header->opcode == PAYLOAD_TOO_LARGE) {
+        errno = EFBIG;
+    } else {
+        errno = EPROTO;
     }
 
-    free(temp);
     free(response_m);
 
     return result;
@@ -772,6 +883,12 @@ int openFile(const char *pathname, int flags) {
         return -1;
     }
 
+    if(strlen(pathname) > UNIX_PATH_MAX) {
+        errno = ENAMETOOLONG;
+
+        return -1;
+    }
+
     args.pathname = (char *)pathname;
     args.flags = flags;
 
@@ -859,7 +976,6 @@ int readFile(const char *pathname, void **buf, size_t *size) {
 
 int readNFiles(int n, const char *dirname) {
     request_args args;
-    char *string_n;
 
     int result;
 
@@ -889,28 +1005,19 @@ int readNFiles(int n, const char *dirname) {
         }
     }
 
-    if(n != 0) {
-        string_n = malloc((int)((ceil(log10(n)) + 2) * sizeof(char)));
-    } else {
-        string_n = malloc(2 * sizeof(char));
-    }
-
-    sprintf(string_n, "%d", n);
-
-    args.n = string_n;
+    // Se n <= 0 vengono letti tutti i file presenti nel server
+    args.n = n > 0 ? n : 0;
     if(send_request(READNFILE, &args) == -1) {
         set_openfile(0, NULL);
 
         return -1;
     }
 
-    free(string_n);
-
     if(dirname != NULL) {   
         set_dirname((char *)dirname);
     }
 
-    result = manage_response(READNFILE, NULL);
+    result = recv_read_files();
 
     set_openfile(0, NULL);
 
@@ -935,6 +1042,12 @@ int writeFile(const char *pathname, const char *dirname) {
         return -1;
     }
 
+    if(strlen(pathname) > UNIX_PATH_MAX) {
+        errno = ENAMETOOLONG;
+
+        return -1;
+    }
+
     if(check_openfile((char *)pathname) == 0) {
         errno = EBADF;
 
@@ -970,16 +1083,23 @@ int writeFile(const char *pathname, const char *dirname) {
     fread(file_content, sizeof(char), file_size, file);
     fclose(file);
 
-    if(strcmp(file_content, "") != 0) {
+    if(file_size > 0) {
         args.pathname = (char *)pathname;
         args.content = file_content;
-        send_request(WRITEFILE, &args);
+        args.size = file_size;
 
+        // La directory è impostata prima dell'invio, altrimenti il server scarta i file espulsi
         if(dirname != NULL) {
             set_dirname((char *)dirname);
         }
 
-        result = manage_response(WRITEFILE, NULL);
+        result = send_request(WRITEFILE, &args);
+
+        if(result == 0) {
+            result = manage_response(WRITEFILE, NULL);
+        }
+
+        reset_dirname();
     } else {
         send_request(WRITE_NO_CONTENT, NULL);
 
@@ -1005,6 +1125,12 @@ int appendToFile(const char *pathname, void *buf, size_t size, const char *dirna
         return -1;
     }
 
+    if(strlen(pathname) > UNIX_PATH_MAX) {
+        errno = ENAMETOOLONG;
+
+        return -1;
+    }
+
     // Verifica se la directory dirname esiste e se l'utente ha i permessi di leggere scrivere in quella directory
     if(dirname != NULL) {
         if(access(dirname, F_OK | R_OK | W_OK) == -1) {
@@ -1016,20 +1142,28 @@ int appendToFile(const char *pathname, void *buf, size_t size, const char *dirna
     args.pathname = (char *)pathname;
     args.content = (char *)buf;
     args.size = size;
-    send_request(APPENDFILE, &args);
 
+    // La directory è impostata prima dell'invio, altrimenti il server scarta i file espulsi
     if(dirname != NULL) {
         set_dirname((char *)dirname);
     }
-    result = manage_response(APPENDFILE, NULL);
+
+    result = send_request(APPENDFILE, &args);
+
+    if(result == 0) {
+        result = manage_response(APPENDFILE, NULL);
+    }
+
+    reset_dirname();
 
     set_openfile(0, NULL);
 
     return result;
 }
 
-int lockFile(const char *pathname) {
-    request_args args;
+int readFileRange(const char *pathname, size_t offset, size_t length, void **buf, size_t *size) {
+    request_args request_args;
+    response_args response_args;
 
     int result;
 
@@ -1046,17 +1180,23 @@ int lockFile(const char *pathname) {
         return -1;
     }
 
-    args.pathname = (char *)pathname;
-    send_request(LOCKFILE, &args);
+    request_args.pathname = (char *)pathname;
+    request_args.offset = offset;
+    request_args.size = length;
+    if(send_request(READRANGE, &request_args) != 0) {
+        return -1;
+    }
 
-    result = manage_response(LOCKFILE, NULL);
+    response_args.buf = buf;
+    response_args.size = size;
+    result = manage_response(READRANGE, &response_args);
 
     set_openfile(0, NULL);
 
     return result;
 }
 
-int unlockFile(const char *pathname) {
+int writeFileAt(const char *pathname, size_t offset, void *buf, size_t size, const char *dirname) {
     request_args args;
 
     int result;
@@ -1074,17 +1214,37 @@ int unlockFile(const char *pathname) {
         return -1;
     }
 
+    // Verifica se la directory dirname esiste e se l'utente ha i permessi di leggere scrivere in quella directory
+    if(dirname != NULL) {
+        if(access(dirname, F_OK | R_OK | W_OK) == -1) {
+            errno = EPERM;
+
+            return -1;
+        }
+
+        // La directory è impostata prima dell'invio, altrimenti il server scarta i file espulsi
+        set_dirname((char *)dirname);
+    }
+
     args.pathname = (char *)pathname;
-    send_request(UNLOCKFILE, &args);
+    args.content = (char *)buf;
+    args.size = size;
+    args.offset = offset;
 
-    result = manage_response(UNLOCKFILE, NULL);
+    result = send_request(WRITEAT, &args);
+
+    if(result == 0) {
+        result = manage_response(WRITEAT, NULL);
+    }
+
+    reset_dirname();
 
     set_openfile(0, NULL);
 
     return result;
 }
 
-int removeFile(const char *pathname) {
+int lockFile(const char *pathname) {
     request_args args;
 
     int result;
@@ -1103,7 +1263,63 @@ int removeFile(const char *pathname) {
     }
 
     args.pathname = (char *)pathname;
-    send_request(REMOVEFILE, &args);
+    send_request(LOCKFILE, &args);
+
+    result = manage_response(LOCKFILE, NULL);
+
+    set_openfile(0, NULL);
+
+    return result;
+}
+
+int unlockFile(const char *pathname) {
+    request_args args;
+
+    int result;
+
+    // Verifica se la connessione con il server è stata effettuata
+    if(sel_socketname == NULL) {
+        errno = ENOTCONN;
+
+        return -1;
+    }
+
+    if(strlen(pathname) > UNIX_PATH_MAX) {
+        errno = ENAMETOOLONG;
+
+        return -1;
+    }
+
+    args.pathname = (char *)pathname;
+    send_request(UNLOCKFILE, &args);
+
+    result = manage_response(UNLOCKFILE, NULL);
+
+    set_openfile(0, NULL);
+
+    return result;
+}
+
+int removeFile(const char *pathname) {
+    request_args args;
+
+    int result;
+
+    // Verifica se la connessione con il server è stata effettuata
+    if(sel_socketname == NULL) {
+        errno = ENOTCONN;
+
+        return -1;
+    }
+
+    if(strlen(pathname) > UNIX_PATH_MAX) {
+        errno = ENAMETOOLONG;
+
+        return -1;
+    }
+
+    args.pathname = (char *)pathname;
+    send_request(REMOVEFILE, &args);
 
     result = manage_response(REMOVEFILE, NULL);
 
@@ -1111,3 +1327,462 @@ int removeFile(const char *pathname) {
 
     return result;
 }
+
+int putFile(const char *pathname, const char *dirname) {
+    FILE *file;
+    long file_size;
+    char *file_content;
+
+    request_args args;
+
+    int result;
+
+    // Verifica se la connessione con il server è stata effettuata
+    if(sel_socketname == NULL) {
+        errno = ENOTCONN;
+
+        return -1;
+    }
+
+    if(strlen(pathname) > UNIX_PATH_MAX) {
+        errno = ENAMETOOLONG;
+
+        return -1;
+    }
+
+    // Verifica se la directory dirname esiste e se l'utente ha i permessi di leggere scrivere in quella directory
+    if(dirname != NULL && (access(dirname, F_OK) == -1 || access(dirname, R_OK | W_OK) == -1)) {
+        errno = EPERM;
+
+        return -1;
+    }
+
+    // Verifica e apre il file pathname
+    if((file = fopen(pathname, "rb")) == NULL) {
+        errno = ENOENT;
+
+        return -1;
+    }
+
+    fseek(file, 0L, SEEK_END);
+    file_size = ftell(file);
+    fseek(file, 0L, SEEK_SET);
+
+    file_content = malloc((file_size + 1) * sizeof(char));
+    memset(file_content, 0, file_size + 1);
+    fread(file_content, sizeof(char), file_size, file);
+    fclose(file);
+
+    set_openfile(0, NULL);
+
+    args.pathname = (char *)pathname;
+    args.content = file_content;
+    args.size = file_size;
+
+    // La directory è impostata prima dell'invio, altrimenti il server scarta i file espulsi
+    if(dirname != NULL) {
+        set_dirname((char *)dirname);
+    }
+
+    result = send_request(PUTFILE, &args);
+
+    free(file_content);
+
+    if(result == 0) {
+        result = manage_response(PUTFILE, NULL);
+    }
+
+    reset_dirname();
+
+    return result;
+}
+
+int getFile(const char *pathname, void **buf, size_t *size) {
+    request_args request_args;
+    response_args response_args;
+
+    // Verifica se la connessione con il server è stata effettuata
+    if(sel_socketname == NULL) {
+        errno = ENOTCONN;
+
+        return -1;
+    }
+
+    if(strlen(pathname) > UNIX_PATH_MAX) {
+        errno = ENAMETOOLONG;
+
+        return -1;
+    }
+
+    set_openfile(0, NULL);
+
+    request_args.pathname = (char *)pathname;
+    if(send_request(GETFILE, &request_args) != 0) {
+        return -1;
+    }
+
+    response_args.buf = buf;
+    response_args.size = size;
+
+    return manage_response(GETFILE, &response_args);
+}
+
+int readFiles(char **pathnames, int n, void **bufs, size_t *sizes, int *errors) {
+    request_args args;
+    int files[PIPELINE_DEPTH];
+
+    uint64_t base;
+    long sent = 0;
+    long received = 0;
+    int i;
+
+    // Verifica se la connessione con il server è stata effettuata
+    if(sel_socketname == NULL) {
+        errno = ENOTCONN;
+
+        return -1;
+    }
+
+    for(i = 0; i < n; i++) {
+        bufs[i] = NULL;
+        sizes[i] = 0;
+        errors[i] = 0;
+    }
+
+    for(i = 0; i < PIPELINE_DEPTH; i++) {
+        files[i] = -1;
+    }
+
+    set_openfile(0, NULL);
+
+    base = request_id + 1;
+    i = 0;
+
+    while(i < n || received < sent) {
+        // Invia le richieste senza attendere le risposte, finchè la posizione della richiesta non è libera
+        // le risposte arrivano fuori ordine, quindi la richiesta più vecchia senza risposta limita la finestra degli identificativi
+        while(i < n && files[sent % PIPELINE_DEPTH] == -1) {
+            if(strlen(pathnames[i]) > UNIX_PATH_MAX) {
+                // La richiesta del file non viene inviata
+                errors[i++] = ENAMETOOLONG;
+
+                continue;
+            }
+
+            args.pathname = pathnames[i];
+
+            if(send_request(GETFILE, &args) == -1) {
+                return -1;
+            }
+
+            files[sent % PIPELINE_DEPTH] = i++;
+            sent++;
+        }
+
+        if(received < sent) {
+            if(collect_response(base, sent, files, GETFILE, bufs, sizes, errors) == -1) {
+                return -1;
+            }
+
+            received++;
+        }
+    }
+
+    return 0;
+}
+
+int writeFiles(char **pathnames, int n, const char *dirname, int *errors) {
+    FILE *file;
+    char *content;
+    long content_size;
+
+    request_args args;
+    int files[PIPELINE_DEPTH];
+
+    uint64_t base;
+    long sent = 0;
+    long received = 0;
+    int result;
+    int i;
+
+    // Verifica se la connessione con il server è stata effettuata
+    if(sel_socketname == NULL) {
+        errno = ENOTCONN;
+
+        return -1;
+    }
+
+    // Verifica se la directory dirname esiste e se l'utente ha i permessi di leggere scrivere in quella directory
+    if(dirname != NULL) {
+        if(access(dirname, F_OK) == -1 || access(dirname, R_OK | W_OK) == -1) {
+            errno = EPERM;
+
+            return -1;
+        }
+
+        set_dirname((char *)dirname);
+    }
+
+    for(i = 0; i < PIPELINE_DEPTH; i++) {
+        files[i] = -1;
+    }
+
+    set_openfile(0, NULL);
+
+    base = request_id + 1;
+    i = 0;
+
+    while(i < n || received < sent) {
+        // Invia le richieste senza attendere le risposte, finchè la posizione della richiesta non è libera
+        while(i < n && files[sent % PIPELINE_DEPTH] == -1) {
+            errors[i] = 0;
+
+            if(strlen(pathnames[i]) > UNIX_PATH_MAX) {
+                // La richiesta del file non viene inviata
+                errors[i++] = ENAMETOOLONG;
+
+                continue;
+            }
+
+            if((file = fopen(pathnames[i], "rb")) == NULL) {
+                // La richiesta del file non viene inviata
+                errors[i++] = ENOENT;
+
+                continue;
+            }
+
+            fseek(file, 0L, SEEK_END);
+            content_size = ftell(file);
+            fseek(file, 0L, SEEK_SET);
+
+            content = malloc((content_size + 1) * sizeof(char));
+            memset(content, 0, content_size + 1);
+            fread(content, sizeof(char), content_size, file);
+            fclose(file);
+
+            args.pathname = pathnames[i];
+            args.content = content;
+            args.size = content_size;
+
+            result = send_request(PUTFILE, &args);
+
+            free(content);
+
+            if(result == -1) {
+                reset_dirname();
+
+                return -1;
+            }
+
+            files[sent % PIPELINE_DEPTH] = i++;
+            sent++;
+        }
+
+        if(received < sent) {
+            if(collect_response(base, sent, files, PUTFILE, NULL, NULL, errors) == -1) {
+                reset_dirname();
+
+                return -1;
+            }
+
+            received++;
+        }
+    }
+
+    reset_dirname();
+
+    return 0;
+}
+
+static int collect_response(uint64_t base, long n_sent, int *files, int type, void **bufs, size_t *sizes, int *errors) {
+    frame_header header;
+    response_args args;
+    char *response_m;
+
+    int i;
+
+    if(recv_response(&header, &response_m) == -1) {
+        return -1;
+    }
+
+    // Le risposte a richieste su file diversi possono arrivare in un ordine diverso da quello di invio
+    if(header.request_id < base || (long)(header.request_id - base) >= n_sent || n_sent - (long)(header.request_id - base) > PIPELINE_DEPTH) {
+        free(response_m);
+
+        errno = EPROTO;
+
+        return -1;
+    }
+
+    i = files[(header.request_id - base) % PIPELINE_DEPTH];
+
+    if(i == -1) {
+        free(response_m);
+
+        errno = EPROTO;
+
+        return -1;
+    }
+
+    // La posizione viene liberata per la richiesta successiva
+    files[(header.request_id - base) % PIPELINE_DEPTH] = -1;
+
+    if(bufs != NULL) {
+        args.buf = &bufs[i];
+        args.size = &sizes[i];
+    }
+
+    if(process_response(type, bufs != NULL ? &args : NULL, &header, response_m) == -1) {
+        errors[i] = errno;
+    }
+
+    return 0;
+}
+
+static int store_file(char *name, char *content, size_t size) {
+    FILE *file;
+
+    char *pathname;
+    char *filename;
+
+    pathname = malloc((strlen(sel_dirname) + strlen(name) + 2) * sizeof(char));
+
+    strcpy(pathname, sel_dirname);
+
+    if(sel_dirname[strlen(sel_dirname) - 1] != '/') {
+        strcat(pathname, "/");
+    }
+
+    // Il file viene salvato con il solo nome, senza il percorso con cui è memorizzato nel server
+    if((filename = strrchr(name, '/')) != NULL) {
+        filename++;
+    } else {
+        filename = name;
+    }
+
+    strcat(pathname, filename);
+
+    if((file = fopen(pathname, "w")) == NULL) {
+        free(pathname);
+
+        return -1;
+    }
+
+    fwrite(content, sizeof(char), size, file);
+
+    free(pathname);
+
+    fclose(file);
+
+    return 0;
+}
+
+static int recv_read_files() {
+    frame_header header;
+    frame_header file_header;
+
+    char name[UNIX_PATH_MAX + 1];
+    char *content;
+
+    uint64_t remaining;
+    uint64_t content_len;
+    long n_files = 0;
+
+    do {
+        // Ogni passo della lettura è una risposta, il cui payload è la sequenza dei frame dei file letti nel passo
+        if(recv_exact(&header, sizeof(frame_header)) == -1) {
+            return -1;
+        }
+
+        if(header.version != PROTOCOL_VERSION || header.request_id != request_id) {
+            errno = EPROTO;
+
+            return -1;
+        }
+
+        if(header.opcode != SUCCESS) {
+            // La lettura è terminata con un errore, la risposta non ha payload
+            if(header.payload_len > 0) {
+                errno = EPROTO;
+
+                return -1;
+            }
+
+            return process_response(READNFILE, NULL, &header, NULL);
+        }
+
+        remaining = header.payload_len;
+
+        // I frame sono ricevuti uno alla volta, il contenuto di un file è deallocato prima di ricevere il successivo
+        while(remaining > 0) {
+            if(remaining < sizeof(frame_header)) {
+                errno = EPROTO;
+
+                return -1;
+            }
+
+            if(recv_exact(&file_header, sizeof(frame_header)) == -1) {
+                return -1;
+            }
+
+            remaining -= sizeof(frame_header);
+            content_len = file_header.flags & DISCARD_VICTIMS ? 0 : file_header.payload_len;
+
+            if(file_header.name_len > UNIX_PATH_MAX || file_header.name_len + content_len > remaining) {
+                errno = EPROTO;
+
+                return -1;
+            }
+
+            if(recv_exact(name, file_header.name_len) == -1) {
+                return -1;
+            }
+
+            name[file_header.name_len] = '\0';
+
+            if((content = malloc(content_len + 1)) == NULL) {
+                return -1;
+            }
+
+            if(recv_exact(content, content_len) == -1) {
+                free(content);
+
+                return -1;
+            }
+
+            remaining -= file_header.name_len + content_len;
+            n_files++;
+
+            if(print_upper_r) {
+                printf("-R: Successo, letto il file %s, di %ldbytes\n", name, (long)file_header.payload_len);
+            }
+
+            if(sel_dirname != NULL && !(file_header.flags & DISCARD_VICTIMS)) {
+                store_file(name, content, content_len);
+            }
+
+            free(content);
+        }
+    } while(header.flags & MORE_FRAMES);
+
+    if(n_files == 0 && print_upper_r) {
+        printf("-R: Successo, il server non contiene alcun file\n");
+    }
+
+    return 0;
+}
+
+static int recv_exact(void *buf, size_t size) {
+    ssize_t read_size;
+
+    if((read_size = readn(socket_fd, buf, size)) != size) {
+        if(read_size != -1) {
+            // Il server ha chiuso la connessione prima di inviare tutti i byte
+            errno = ECONNRESET;
+        }
+
+        return -1;
+    }
+
+    return 0;
+}
@@ -57,6 +57,16 @@ int lower_w_fun(char *dirname, int n, int part_n, char *save_dirname, long timeo
  */
 int upper_w_fun(char *files, char *save_dirname, long timeout, int p);
 
+/*
+ * Invia al server i file con filename definiti in files senza attendere la risposta ad ogni richiesta, usata da upper_w_fun se non è definito un timeout
+ * Parametri:
+ *      files: contiene i filename dei file da scrivere sul server separati da una virgola
+ *      save_dirname: il percorso della directory in cui salvare eventuali file espulsi dal server, se NULL allora i file inviati dal server vengono ignorati
+ *      p: indica se è richiesta la modalità verbose
+ * Ritorna: 0 in caso di successo, -1 in caso di errore
+ */
+int upper_w_pipelined(char *files, char *save_dirname, int p);
+
 /*
  * Richiede al server la lettura dei file con i filename definiti in files
  * Parametri:
@@ -68,6 +78,37 @@ int upper_w_fun(char *files, char *save_dirname, long timeout, int p);
  */
 int lower_r_fun(char *files, char *dirname, long timeout, int p);
 
+/*
+ * Richiede al server la lettura dei file con i filename definiti in files senza attendere la risposta ad ogni richiesta, usata da lower_r_fun se non è definito un timeout
+ * Parametri:
+ *      files: i filename dei file da leggere
+ *      dirname: il percorso della directory in cui salvare i file letti dal server, se NULL allora i file inviati dal server non vengono salvati
+ *      p: indica se è richiesta la modalità verbose
+ * Ritorna: 0 in caso di successo, -1 in caso di errore
+ */
+int lower_r_pipelined(char *files, char *dirname, int p);
+
+/*
+ * Restituisce il percorso assoluto di un file, anche se il file non esiste sulla macchina del client
+ * Parametri:
+ *      pathname: il pathname inserito dall'utente
+ * Ritorna: il percorso assoluto da deallocare con free
+ */
+char *absolute_pathname(char *pathname);
+
+/*
+ * Salva nella directory dirname il contenuto di un file letto dal server e stampa l'esito della lettura in modalità verbose
+ * Parametri:
+ *      abs_pathname: il percorso assoluto del file letto
+ *      dirname: il percorso della directory in cui salvare il file, se NULL il file non viene salvato
+ *      content: il contenuto del file, NULL se la lettura è fallita oppure il file è vuoto
+ *      content_size: la dimensione del contenuto
+ *      error: l'errno della lettura fallita, 0 se la lettura ha avuto successo
+ *      p: indica se è richiesta la modalità verbose
+ * Ritorna: none
+ */
+void save_read_file(char *abs_pathname, char *dirname, char *content, size_t content_size, int error, int p);
+
 /*
  * Richiede la lettura di al più n file qualsiasi dal server
  * Parametri:
@@ -632,6 +673,21 @@ int write_file(char *pathname, char *dirname, long timeout) {
             return -1;
         }
 
+    }
+
+    // Senza attesa tra le richieste il file viene creato, scritto e chiuso con una sola richiesta
+    if(timeout == 0) {
+        if(putFile(pathname, dirname) == 0) {
+            return 0;
+        }
+
+        // Se il file esiste già viene sostituito con la sequenza di operazioni singole
+        if(errno != EEXIST) {
+            return -1;
+        }
+    }
+
+    if(dirname != NULL) {
         set_dirname(dirname);
     }
 
@@ -827,6 +883,11 @@ int upper_w_fun(char *files, char *save_dirname, long timeout, int p) {
     int result = 0;
     int file_size;
 
+    if(timeout == 0) {
+        // Senza attese tra le richieste le scritture sono inviate insieme
+        return upper_w_pipelined(files, save_dirname, p);
+    }
+
     pathname = strtok_r(files, ",", &strtok_state);
     while(pathname != NULL) {
         result = 0;
@@ -884,13 +945,108 @@ int upper_w_fun(char *files, char *save_dirname, long timeout, int p) {
     return result;
 }
 
-int lower_r_fun(char *files, char *dirname, long timeout, int p) {
-    FILE *file;
+int upper_w_pipelined(char *files, char *save_dirname, int p) {
+    struct stat file_stat;
+
+    char **pathnames;
+    int *errors;
+
+    char *pathname;
+    char *abs_pathname;
+    char *strtok_state;
+
+    int n = 1;
+    int result = 0;
+    int i;
+
+    if(save_dirname != NULL && (access(save_dirname, F_OK) == -1 || access(save_dirname, R_OK | W_OK) == -1)) {
+        if(p) {
+            printf("-W: Errore, la directory definita con l'argomento -D non esiste oppure l'utente non ha i permessi di accesso\n");
+        }
+
+        return -1;
+    }
+
+    for(i = 0; files[i] != '\0'; i++) {
+        if(files[i] == ',') {
+            n++;
+        }
+    }
 
+    pathnames = malloc(n * sizeof(char *));
+    errors = malloc(n * sizeof(int));
+
+    if(pathnames == NULL || errors == NULL) {
+        free(pathnames);
+        free(errors);
+
+        return -1;
+    }
+
+    n = 0;
+    pathname = strtok_r(files, ",", &strtok_state);
+    while(pathname != NULL) {
+        if((abs_pathname = realpath(pathname, NULL)) == NULL) {
+            if(p) {
+                printf("-W %s: Errore, il file non esiste\n", pathname);
+            }
+
+            result = -1;
+        } else {
+            pathnames[n++] = abs_pathname;
+        }
+
+        pathname = strtok_r(NULL, ",", &strtok_state);
+    }
+
+    if(writeFiles(pathnames, n, save_dirname, errors) == -1) {
+        if(p) {
+            perror("-W: Errore, comunicando con il server");
+        }
+
+        result = -1;
+    } else {
+        for(i = 0; i < n; i++) {
+            if(errors[i] == EEXIST) {
+                // Il file esiste già sul server, viene sostituito con la sequenza di operazioni di write_file
+                errno = 0;
+                errors[i] = write_file(pathnames[i], save_dirname, 0) == -1 ? errno : 0;
+            }
+
+            if(errors[i] != 0) {
+                result = -1;
+            }
+
+            if(p) {
+                if(errors[i] == 0) {
+                    printf("-W %s: Successo, %ldbytes scritti\n", pathnames[i], stat(pathnames[i], &file_stat) == 0 ? (long)file_stat.st_size : 0L);
+                } else {
+                    switch(errors[i]) {
+                        case ENOENT:
+                            printf("-W %s: Errore, la directory definita con l'argomento -D non esiste\n", pathnames[i]);
+                            break;
+                        case EPERM:
+                            printf("-W %s: Errore, la lock sul file è posseduta da un altro utente oppure l'utente non ha i permessi di accesso alla directory definita con l'argomento -D\n", pathnames[i]);
+                            break;
+                    }
+                }
+            }
+        }
+    }
+
+    for(i = 0; i < n; i++) {
+        free(pathnames[i]);
+    }
+
+    free(pathnames);
+    free(errors);
+
+    return result;
+}
+
+int lower_r_fun(char *files, char *dirname, long timeout, int p) {
     char *pathname;                                     // pathname ottenuto dal pathname inserito dall'utente
     char *abs_pathname;                                 // pathname assoluto del pathname inserito dall'utente
-    char saved_pathname[UNIX_PATH_MAX];                 // pathname in cui salvare il file letto dal server
-    char *saved_filename;                               // nome con cui salvare il file nella directory di salvataggio
 
     char *strtok_state;
 
@@ -898,6 +1054,7 @@ int lower_r_fun(char *files, char *dirname, long timeout, int p) {
     size_t content_size;
 
     int result = 0;
+    int error;
 
     if(dirname != NULL) {
         if(access(dirname, F_OK) == -1) {
@@ -915,21 +1072,14 @@ int lower_r_fun(char *files, char *dirname, long timeout, int p) {
         }
     }
 
+    if(timeout == 0) {
+        // Senza attese tra le richieste le letture sono inviate insieme
+        return lower_r_pipelined(files, dirname, p);
+    }
+
     pathname = strtok_r(files, ",", &strtok_state);
     while(pathname != NULL) {
-        abs_pathname = realpath(pathname, NULL);
-
-        if(abs_pathname == NULL) {
-            abs_pathname = malloc((UNIX_PATH_MAX + 1) * sizeof(char));
-            getcwd(abs_pathname, UNIX_PATH_MAX + 1);
-
-            strcat(abs_pathname, "/");
-            if(pathname[0] == '.' && pathname[1] == '/') {
-                strcat(abs_pathname, pathname + 2);
-            } else {
-                strcat(abs_pathname, pathname);
-            }
-        }
+        abs_pathname = absolute_pathname(pathname);
 
         if(openFile(abs_pathname, O_LOCK) == -1) {
             if(p) {
@@ -942,55 +1092,16 @@ int lower_r_fun(char *files, char *dirname, long timeout, int p) {
                 usleep(timeout);
             }
 
-            //Usa l'api per scrivere il contenuto del file
+            //Usa l'api per leggere il contenuto del file
+            content = NULL;
+            error = 0;
             if(readFile(abs_pathname, (void **)&content, &content_size) == -1){
+                error = errno;
 
                 result = -1;
             }
 
-            if(result != -1 && dirname != NULL) {
-                strcpy(saved_pathname, dirname);
-
-                if(saved_pathname[strlen(saved_pathname) - 2] != '/') {
-                    strcat(saved_pathname, "/");
-                }
-
-                saved_filename = strrchr(abs_pathname, '/') + 1;
-                strcat(saved_pathname, saved_filename);
-
-                if((file = fopen(saved_pathname, "w")) == NULL) {
-                    if(p) {
-                        perror("Aprendo il file");
-                    }
-                } else {
-                    if(fwrite(content, sizeof(char), content_size, file) == 0) {
-                        if(!feof(file)) {
-                            if(p) {
-                                printf("-r %s: Errore, errore sconosciuto durante il salvataggio del file in locale\n", abs_pathname);
-                            }
-                        }
-                    }
-
-                    fclose(file);
-                }
-            }
-
-            if(p) {
-                if(result != -1) {
-                    printf("-r %s: Successo, %.33s\n", abs_pathname, content);
-
-                    free(content);
-                } else {
-                    switch(errno) {
-                        case ENOENT:
-                            printf("-r %s: Errore, il file non esiste\n", abs_pathname);
-                            break;
-                        case EPERM:
-                            printf("-r %s: Errore, la lock sul file è posseduta da un altro utente\n", abs_pathname);
-                            break;
-                    }
-                }
-            }
+            save_read_file(abs_pathname, dirname, content, content_size, error, p);
 
             if(timeout != 0) {
                 usleep(timeout);
@@ -1008,8 +1119,145 @@ int lower_r_fun(char *files, char *dirname, long timeout, int p) {
         pathname = strtok_r(NULL, ",", &strtok_state);
     }
 
+    return result;
+}
 
-    return 0;
+int lower_r_pipelined(char *files, char *dirname, int p) {
+    char **pathnames;
+    char **contents;
+    size_t *sizes;
+    int *errors;
+
+    char *pathname;
+    char *strtok_state;
+
+    int n = 1;
+    int result = 0;
+    int i;
+
+    for(i = 0; files[i] != '\0'; i++) {
+        if(files[i] == ',') {
+            n++;
+        }
+    }
+
+    pathnames = malloc(n * sizeof(char *));
+    contents = malloc(n * sizeof(char *));
+    sizes = malloc(n * sizeof(size_t));
+    errors = malloc(n * sizeof(int));
+
+    if(pathnames == NULL || contents == NULL || sizes == NULL || errors == NULL) {
+        free(pathnames);
+        free(contents);
+        free(sizes);
+        free(errors);
+
+        return -1;
+    }
+
+    n = 0;
+    pathname = strtok_r(files, ",", &strtok_state);
+    while(pathname != NULL) {
+        pathnames[n++] = absolute_pathname(pathname);
+
+        pathname = strtok_r(NULL, ",", &strtok_state);
+    }
+
+    if(readFiles(pathnames, n, (void **)contents, sizes, errors) == -1) {
+        if(p) {
+            perror("-r: Errore, comunicando con il server");
+        }
+
+        result = -1;
+    }
+
+    for(i = 0; i < n; i++) {
+        if(result != -1) {
+            // La lettura ha avuto successo se la risposta è SUCCESS, anche se la chiusura del file è fallita
+            save_read_file(pathnames[i], dirname, contents[i], sizes[i], errors[i], p);
+        } else {
+            free(contents[i]);
+        }
+
+        free(pathnames[i]);
+    }
+
+    free(pathnames);
+    free(contents);
+    free(sizes);
+    free(errors);
+
+    return result;
+}
+
+char *absolute_pathname(char *pathname) {
+    char *abs_pathname = realpath(pathname, NULL);
+
+    if(abs_pathname == NULL) {
+        abs_pathname = malloc((UNIX_PATH_MAX + 1) * sizeof(char));
+        getcwd(abs_pathname, UNIX_PATH_MAX + 1);
+
+        strcat(abs_pathname, "/");
+        if(pathname[0] == '.' && pathname[1] == '/') {
+            strcat(abs_pathname, pathname + 2);
+        } else {
+            strcat(abs_pathname, pathname);
+        }
+    }
+
+    return abs_pathname;
+}
+
+void save_read_file(char *abs_pathname, char *dirname, char *content, size_t content_size, int error, int p) {
+    FILE *file;
+
+    char saved_pathname[UNIX_PATH_MAX];                 // pathname in cui salvare il file letto dal server
+    char *saved_filename;                               // nome con cui salvare il file nella directory di salvataggio
+
+    if(error == 0 && dirname != NULL) {
+        strcpy(saved_pathname, dirname);
+
+        if(saved_pathname[strlen(saved_pathname) - 2] != '/') {
+            strcat(saved_pathname, "/");
+        }
+
+        saved_filename = strrchr(abs_pathname, '/') + 1;
+        strcat(saved_pathname, saved_filename);
+
+        if((file = fopen(saved_pathname, "w")) == NULL) {
+            if(p) {
+                perror("Aprendo il file");
+            }
+        } else {
+            // Un file vuoto viene salvato senza contenuto
+            if(content_size > 0 && fwrite(content, sizeof(char), content_size, file) == 0) {
+                if(!feof(file)) {
+                    if(p) {
+                        printf("-r %s: Errore, errore sconosciuto durante il salvataggio del file in locale\n", abs_pathname);
+                    }
+                }
+            }
+
+            fclose(file);
+        }
+    }
+
+    if(p) {
+        if(error == 0) {
+            printf("-r %s: Successo, %.33s\n", abs_pathname, content != NULL ? content : "");
+        } else {
+            switch(error) {
+                case ENOENT:
+                    printf("-r %s: Errore, il file non esiste\n", abs_pathname);
+                    break;
+                case EPERM:
+                    printf("-r %s: Errore, la lock sul file è posseduta da un altro utente\n", abs_pathname);
+                    break;
+            }
+        }
+    }
+
+    free(content);
 }
 
 int upper_r_fun(int n, char *dirname, int p) {
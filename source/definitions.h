@@ -1,26 +1,80 @@
-// Definizione dei messaggi di richiesta
-#define CLOSECONN "0"                               // È richiesta la chiusura della connessione
-#define OPENFILE "1"                                // È richiesta l'apertura del file
-#define CLOSEFILE "2"                               // È richiesta la chiusura del file
-#define WRITEFILE "3"                               // È richiesta la scrittura in un file
-#define READFILE "4"                                // È richiesta la lettura di un file
-#define READNFILE "5"                               // È richiesta la lettura di n file dallo storage
-#define APPENDFILE "6"                              // È richiesta la scrittura in coda al contenuto di un file
-#define LOCKFILE "7"                                // È richiesta l'acquisizione della lock su un file
-#define UNLOCKFILE "8"                              // È richiesto il rilascio della lock su un file
-#define REMOVEFILE "9"                              // È richiesta la rimozione di un file dallo storage
-#define WRITE_NO_CONTENT "10"                       // È richiesta la scrittura di un file senza contenuto
-
-// Definizione dei messaggi di risposta
-#define SUCCESS "0"                                 // L'operazione è terminata con successo
-#define ALREADY_OPENED "1"                          // Il file è stato già aperto
-#define FILE_NOT_EXIST "2"                          // Il file specificato non esiste
-#define UNKNOWN "3"                                 // Errore sconosciuto
-#define FILENAME_TOO_LONG "4"                       // Il nome del file è troppo lungo
-#define FILE_ALREADY_EXIST "5"                      // Il file esiste già 
-#define FILE_NOT_OPENED "6"                         // Il file non è stato aperto 
-#define FILE_LOCKED "7"                             // Il file è locked e l'operazione è richiesta da un utente che non è in possesso della lock    
-#define NOT_ENO_MEM "8"                             // Lo storage non è sufficiente per memorizzare il file
-// Definizione flags per open_file
-#define O_CREATE 1                                  // Crea il file se non esistente
-#define O_LOCK 2                                    // Crea o apre il file in modalità locked
+#ifndef DEFINITIONS_H
+#define DEFINITIONS_H
+
+#include <stdint.h>
+
+// Versione del protocollo, un frame con una versione diversa viene rifiutato
+#define PROTOCOL_VERSION 3
+
+// Definizione dei messaggi di richiesta
+#define CLOSECONN 0                                 // È richiesta la chiusura della connessione
+#define OPENFILE 1                                  // È richiesta l'apertura del file
+#define CLOSEFILE 2                                 // È richiesta la chiusura del file
+#define WRITEFILE 3                                 // È richiesta la scrittura in un file
+#define READFILE 4                                  // È richiesta la lettura di un file
+#define READNFILE 5                                 // È richiesta la lettura di n file dallo storage
+#define APPENDFILE 6                                // È richiesta la scrittura in coda al contenuto di un file
+#define LOCKFILE 7                                  // È richiesta l'acquisizione della lock su un file
+#define UNLOCKFILE 8                                // È richiesto il rilascio della lock su un file
+#define REMOVEFILE 9                                // È richiesta la rimozione di un file dallo storage
+#define WRITE_NO_CONTENT 10                         // È richiesta la scrittura di un file senza contenuto
+#define PUTFILE 11                                  // È richiesta la creazione di un file con il contenuto del payload, equivale a openFile(O_CREATE | O_LOCK), writeFile e closeFile
+#define GETFILE 12                                  // È richiesta la lettura di un file, equivale a openFile(O_LOCK), readFile e closeFile
+#define READRANGE 13                                // È richiesta la lettura di un intervallo di byte di un file, il payload è un file_range
+#define WRITEAT 14                                  // È richiesta la scrittura di byte a partire da una posizione del file, il payload è un file_range seguito dai byte
+
+// Definizione dei messaggi di risposta
+#define SUCCESS 0                                   // L'operazione è terminata con successo
+#define ALREADY_OPENED 1                            // Il file è stato già aperto
+#define FILE_NOT_EXIST 2                            // Il file specificato non esiste
+#define UNKNOWN 3                                   // Errore sconosciuto
+#define FILENAME_TOO_LONG 4                         // Il nome del file è troppo lungo
+#define FILE_ALREADY_EXIST 5                        // Il file esiste già
+#define FILE_NOT_OPENED 6                           // Il file non è stato aperto
+#define FILE_LOCKED 7                               // Il file è locked e l'operazione è richiesta da un utente che non è in possesso della lock
+#define NOT_ENO_MEM 8                               // Lo storage non è sufficiente per memorizzare il file
+#define BAD_REQUEST 9                               // L'operazione richiede un filename che non è stato specificato
+#define PAYLOAD_TOO_LARGE 10                        // Il payload della richiesta supera la capacità dello storage, la connessione viene chiusa
+// Definizione flags per open_file
+#define O_CREATE 1                                  // Crea il file se non esistente
+#define O_LOCK 2                                    // Crea o apre il file in modalità locked
+// Definizione flags per le richieste che possono espellere file
+#define DISCARD_VICTIMS 0x100                       // Il client non salva i file espulsi, che sono restituiti senza contenuto
+// Definizione flags per le risposte
+#define MORE_FRAMES 0x200                           // La risposta a READNFILE contiene solo una parte dei file letti, segue un'altra risposta con lo stesso request_id
+
+// Numero massimo di richieste di una connessione ricevute dal server e non ancora soddisfatte, un client non deve inviarne di più senza attendere le risposte
+#define PIPELINE_DEPTH 32
+
+/*
+ * Intestazione di dimensione fissa di ogni messaggio scambiato tra client e server
+ * Il messaggio è composto dall'intestazione seguita da name_len byte di filename, senza terminatore, e da payload_len byte di payload
+ * I file contenuti in una risposta (file letti o espulsi) sono codificati nel payload come una sequenza di frame, uno per file, con opcode SUCCESS
+ * Se la richiesta ha il flag DISCARD_VICTIMS i frame dei file espulsi hanno lo stesso flag, payload_len è la dimensione del file ma il contenuto non segue il filename
+ * La risposta a READNFILE è divisa in più risposte, ognuna con i file letti da una parte dello storage, tutte tranne l'ultima hanno il flag MORE_FRAMES
+ * Il client può inviare più richieste senza attendere le risposte, ogni risposta riporta il request_id della richiesta a cui si riferisce
+ * Le risposte a richieste su file diversi possono arrivare in un ordine diverso da quello di invio, le richieste sullo stesso file sono eseguite in ordine
+ * Client e server comunicano su un socket AF_UNIX, quindi i campi sono nell'ordine dei byte della macchina
+ */
+struct frame_header {
+    uint8_t version;                                // Versione del protocollo, deve essere PROTOCOL_VERSION
+    uint8_t opcode;                                 // Codice della richiesta oppure codice della risposta
+    uint16_t flags;                                 // Flag dell'operazione, per openFile i flag di apertura
+    uint32_t name_len;                              // Lunghezza in byte del filename che segue l'intestazione
+    uint64_t payload_len;                           // Lunghezza in byte del payload che segue il filename
+    uint64_t request_id;                            // Identificativo scelto dal client, ripetuto nella risposta, 0 nei frame dei file contenuti in una risposta
+};
+
+/*
+ * Intervallo di byte di un file, all'inizio del payload delle richieste READRANGE e WRITEAT
+ * Per WRITEAT length è il numero di byte che seguono nel payload
+ */
+struct file_range {
+    uint64_t offset;                                // Posizione del primo byte dell'intervallo
+    uint64_t length;                                // Numero di byte dell'intervallo
+};
+
+typedef struct frame_header frame_header;
+typedef struct file_range file_range;
+
+#endif
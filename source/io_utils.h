@@ -0,0 +1,183 @@
+#ifndef IO_UTILS_H
+#define IO_UTILS_H
+
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024                        // Numero massimo di buffer per ogni writev su Linux, definito da limits.h solo con _XOPEN_SOURCE
+#endif
+
+/*
+ * Legge esattamente n byte dal descrittore, ripetendo la read in caso di letture parziali o di interruzioni da segnale
+ * Parametri:
+ *      fd: il descrittore da cui leggere
+ *      buf: il buffer in cui memorizzare i byte letti
+ *      n: il numero di byte da leggere
+ * Errno:
+ *      vedi man read per gli errno impostati da read
+ * Ritorna: n in caso di successo, il numero di byte letti prima della chiusura se il descrittore è stato chiuso, -1 in caso di errore
+ */
+ssize_t readn(int fd, void *buf, size_t n);
+
+/*
+ * Scrive esattamente n byte sul descrittore, ripetendo la write in caso di scritture parziali o di interruzioni da segnale
+ * Parametri:
+ *      fd: il descrittore su cui scrivere
+ *      buf: il buffer che contiene i byte da scrivere
+ *      n: il numero di byte da scrivere
+ * Errno:
+ *      vedi man write per gli errno impostati da write
+ * Ritorna: n in caso di successo, -1 in caso di errore
+ */
+ssize_t writen(int fd, const void *buf, size_t n);
+
+/*
+ * Legge sul descrittore tutti i byte descritti dai buffer di iov, con il minor numero possibile di chiamate a readv
+ * Gli elementi di iov vengono modificati per tenere traccia dei byte già letti
+ * Parametri:
+ *      fd: il descrittore da cui leggere
+ *      iov: l'array di buffer in cui memorizzare i byte letti
+ *      iovcnt: il numero di elementi di iov
+ * Errno:
+ *      vedi man readv per gli errno impostati da readv
+ * Ritorna: il numero totale di byte letti, minore della dimensione totale dei buffer se il descrittore è stato chiuso, -1 in caso di errore
+ */
+ssize_t readvn(int fd, struct iovec *iov, int iovcnt);
+
+/*
+ * Scrive sul descrittore tutti i byte descritti dai buffer di iov, con il minor numero possibile di chiamate a writev
+ * Ogni writev riceve al più IOV_MAX buffer, quindi iovcnt può superare il limite del sistema
+ * Gli elementi di iov vengono modificati per tenere traccia dei byte già scritti
+ * Parametri:
+ *      fd: il descrittore su cui scrivere
+ *      iov: l'array di buffer da scrivere
+ *      iovcnt: il numero di elementi di iov
+ * Errno:
+ *      vedi man writev per gli errno impostati da writev
+ * Ritorna: il numero totale di byte scritti in caso di successo, -1 in caso di errore
+ */
+ssize_t writevn(int fd, struct iovec *iov, int iovcnt);
+
+/*
+ * Avanza iov di n byte, saltando i buffer già completati
+ * Parametri:
+ *      iov: il puntatore all'array di buffer
+ *      iovcnt: il puntatore al numero di elementi di iov
+ *      n: il numero di byte completati
+ * Ritorna: none
+ */
+void iov_advance(struct iovec **iov, int *iovcnt, size_t n);
+
+ssize_t readn(int fd, void *buf, size_t n) {
+    size_t left = n;
+    ssize_t r;
+
+    while(left > 0) {
+        if((r = read(fd, (char *)buf + (n - left), left)) == -1) {
+            if(errno == EINTR) {
+                continue;
+            }
+
+            return -1;
+        }
+
+        if(r == 0) {
+            // Il descrittore è stato chiuso
+            break;
+        }
+
+        left -= r;
+    }
+
+    return n - left;
+}
+
+ssize_t writen(int fd, const void *buf, size_t n) {
+    size_t left = n;
+    ssize_t r;
+
+    while(left > 0) {
+        if((r = write(fd, (const char *)buf + (n - left), left)) == -1) {
+            if(errno == EINTR) {
+                continue;
+            }
+
+            return -1;
+        }
+
+        left -= r;
+    }
+
+    return n;
+}
+
+ssize_t readvn(int fd, struct iovec *iov, int iovcnt) {
+    ssize_t total = 0;
+    ssize_t r;
+
+    // Salta i buffer vuoti
+    iov_advance(&iov, &iovcnt, 0);
+
+    while(iovcnt > 0) {
+        if((r = readv(fd, iov, iovcnt)) == -1) {
+            if(errno == EINTR) {
+                continue;
+            }
+
+            return -1;
+        }
+
+        if(r == 0) {
+            // Il descrittore è stato chiuso
+            break;
+        }
+
+        total += r;
+        iov_advance(&iov, &iovcnt, r);
+    }
+
+    return total;
+}
+
+ssize_t writevn(int fd, struct iovec *iov, int iovcnt) {
+    ssize_t total = 0;
+    ssize_t r;
+
+    // Salta i buffer vuoti
+    iov_advance(&iov, &iovcnt, 0);
+
+    while(iovcnt > 0) {
+        if((r = writev(fd, iov, iovcnt < IOV_MAX ? iovcnt : IOV_MAX)) == -1) {
+            if(errno == EINTR) {
+                continue;
+            }
+
+            return -1;
+        }
+
+        total += r;
+        iov_advance(&iov, &iovcnt, r);
+    }
+
+    return total;
+}
+
+void iov_advance(struct iovec **iov, int *iovcnt, size_t n) {
+    while(*iovcnt > 0 && n >= (*iov)->iov_len) {
+        n -= (*iov)->iov_len;
+
+        (*iov)++;
+        (*iovcnt)--;
+    }
+
+    if(*iovcnt > 0) {
+        // Il buffer corrente è stato completato solo in parte
+        (*iov)->iov_base = (char *)(*iov)->iov_base + n;
+        (*iov)->iov_len -= n;
+    }
+}
+
+#endif
@@ -0,0 +1,1277 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+#include "request_queue.h"
+#include "response_queue.h"
+
+#define CONN_LISTENER UINT32_MAX                            // Identificativo associato al socket di ascolto negli eventi di epoll
+#define CONN_NOTIFY (UINT32_MAX - 1)                        // Identificativo associato al descrittore di notifica dei worker negli eventi di epoll
+#define CONN_WHEEL_SIZE 64                                  // Numero di celle della timer wheel, ogni cella corrisponde ad un secondo, deve essere una potenza di 2
+#define CONN_DISCARD_SIZE 4096                              // Dimensione del buffer in cui sono ricevuti e scartati i byte delle richieste rifiutate
+
+struct conn {
+    int fd;                                                 // Il file descriptor della connessione, -1 se lo slot è libero
+    int busy;                                               // 1 se almeno una richiesta della connessione è in carico ad un worker, in tal caso il timeout non è attivo
+    time_t expire;                                          // Il momento in cui la connessione viene chiusa per inattività
+    int hash_next;                                          // Lo slot successivo nella lista di trabocco della tabella fd -> slot, -1 se non esiste
+    int timer_next;                                         // Lo slot successivo nella cella della timer wheel, -1 se non esiste
+    int timer_prev;                                         // Lo slot precedente nella cella della timer wheel, -1 se è il primo
+
+    frame_header header;                                    // L'intestazione della richiesta in corso di ricezione
+    size_t received;                                        // Byte ricevuti della richiesta in corso, inclusa l'intestazione
+    struct request *request;                                // La richiesta in corso di ricezione, NULL finchè l'intestazione non è completa
+    uint64_t discard;                                       // Byte del corpo di una richiesta rifiutata ancora da ricevere e scartare
+    int stalled;                                            // 1 se l'intestazione della richiesta in corso è completa ma il suo corpo attende che si liberi il budget di ricezione
+    int charged;                                            // 1 se il corpo della richiesta in corso è già addebitato al budget di ricezione, ma la richiesta non è ancora allocata
+    int stall_next;                                         // La connessione successiva in attesa del budget di ricezione, -1 se non esiste
+    int stall_prev;                                         // La connessione precedente in attesa del budget di ricezione, -1 se è la prima
+
+    uint64_t keys[PIPELINE_DEPTH];                          // Le chiavi delle richieste in carico ai worker
+    int inflight;                                           // Numero di richieste in carico ai worker
+    int barrier;                                            // 1 se è in carico ai worker una richiesta che deve essere eseguita da sola
+    struct request *waiting;                                // Le richieste ricevute che attendono il termine di una richiesta precedente, in ordine di arrivo
+    struct request *waiting_tail;                           // L'ultima richiesta in attesa
+    int n_waiting;                                          // Numero di richieste in attesa
+    struct request *resume;                                 // La lettura di n file da riprendere dopo l'invio per intero delle risposte in coda, NULL se non esiste
+
+    struct response_queue out;                              // Le risposte elaborate dai worker e non ancora inviate per intero
+    int closing;                                            // 1 se non vengono ricevute altre richieste, la connessione è chiusa dopo aver soddisfatto quelle ricevute
+    int broken;                                             // 1 se la connessione non è più utilizzabile, le risposte sono scartate
+};
+
+struct conn_manager {
+    int epoll_fd;                                           // Il file descriptor dell'istanza di epoll
+    int listen_fd;                                          // Il socket di ascolto, -1 se non è più registrato
+    int listening;                                          // 1 se epoll notifica le nuove connessioni sul socket di ascolto
+    int timeout;                                            // Il timeout di inattività delle connessioni in secondi
+
+    struct conn *conns;                                     // Array degli slot delle connessioni
+    int max;                                                // Numero di slot, pari al numero massimo di connessioni attive
+    int *free_slots;                                        // Pila degli slot liberi
+    int n_free;                                             // Numero di slot liberi
+
+    int *buckets;                                           // Tabella hash fd -> slot, ogni cella contiene il primo slot della lista di trabocco
+    int n_buckets;                                          // Numero di celle della tabella, potenza di 2
+
+    int wheel[CONN_WHEEL_SIZE];                             // Timer wheel, la cella expire & (CONN_WHEEL_SIZE - 1) contiene le connessioni che scadono in expire
+    time_t wheel_time;                                      // Il secondo fino a cui la timer wheel è stata elaborata
+
+    struct epoll_event *events;                             // Buffer in cui epoll_wait restituisce gli eventi pronti
+
+    atomic_long receiving;                                  // Byte dei filename e dei payload delle richieste allocate dal manager e non ancora deallocate, non superano la capacità dello storage
+    int stalled;                                            // La prima connessione in attesa del budget di ricezione, -1 se non esiste
+    int stalled_tail;                                       // L'ultima connessione in attesa del budget di ricezione, -1 se non esiste
+
+    struct storage *storage;                                // Lo storage in cui sono allocati i payload ricevuti direttamente nel contenuto dei file
+};
+
+typedef struct conn conn;
+typedef struct conn_manager conn_manager;
+
+/*
+ * Crea l'istanza di epoll e registra il socket di ascolto, alloca gli slot e le strutture per la ricerca e il timeout delle connessioni
+ * Parametri:
+ *      cm: il gestore delle connessioni da inizializzare
+ *      listen_fd: il socket di ascolto
+ *      max: il numero massimo di connessioni attive contemporaneamente
+ *      timeout: il timeout di inattività delle connessioni in secondi
+ *      storage: lo storage in cui allocare i payload delle scritture, può non essere ancora inizializzato
+ * Errno:
+ *      EINVAL: se cm == NULL oppure listen_fd < 0 oppure max <= 0 oppure storage == NULL
+ *      vedi man epoll_create1 e man epoll_ctl per altri errno
+ * Ritorna: 0 in caso di successo, -1 in caso di errore
+ */
+int init_conn_manager(conn_manager *cm, int listen_fd, int max, int timeout, storage *storage);
+
+/*
+ * Chiude l'istanza di epoll e dealloca il gestore, le richieste ricevute solo in parte e le risposte non inviate, le connessioni ancora attive non vengono chiuse
+ * Le risposte possono fare riferimento allo storage, che deve essere deallocato dopo il gestore
+ * Parametri:
+ *      cm: il gestore delle connessioni da deallocare
+ * Ritorna: none
+ */
+void free_conn_manager(conn_manager *cm);
+
+/*
+ * Attende gli eventi sul socket di ascolto e sulle connessioni registrate
+ * Parametri:
+ *      cm: il gestore delle connessioni
+ *      timeout: il timeout di attesa in millisecondi
+ * Errno:
+ *      vedi man epoll_wait
+ * Ritorna: il numero di eventi in cm->events, -1 in caso di errore
+ */
+int conn_wait(conn_manager *cm, int timeout);
+
+/*
+ * Abilita o disabilita la notifica delle nuove connessioni sul socket di ascolto
+ * Parametri:
+ *      cm: il gestore delle connessioni
+ *      enable: 1 per abilitare la notifica, 0 per disabilitarla
+ * Ritorna: 0 in caso di successo, -1 in caso di errore
+ */
+int conn_listen(conn_manager *cm, int enable);
+
+/*
+ * Rimuove il socket di ascolto dall'istanza di epoll, deve essere eseguita prima della chiusura del socket
+ * Parametri:
+ *      cm: il gestore delle connessioni
+ * Ritorna: none
+ */
+void conn_unlisten(conn_manager *cm);
+
+/*
+ * Registra il descrittore con cui i worker segnalano al manager le richieste elaborate
+ * Parametri:
+ *      cm: il gestore delle connessioni
+ *      fd: il descrittore di notifica
+ * Errno:
+ *      vedi man epoll_ctl
+ * Ritorna: 0 in caso di successo, -1 in caso di errore
+ */
+int conn_notify(conn_manager *cm, int fd);
+
+/*
+ * Registra una nuova connessione, che viene notificata una sola volta fino al successivo conn_rearm, e ne avvia il timeout
+ * Parametri:
+ *      cm: il gestore delle connessioni
+ *      fd: il file descriptor della connessione
+ * Errno:
+ *      EINVAL: se fd < 0
+ *      EMFILE: se tutti gli slot sono occupati
+ *      vedi man epoll_ctl per altri errno
+ * Ritorna: lo slot assegnato alla connessione in caso di successo, -1 in caso di errore
+ */
+int conn_add(conn_manager *cm, int fd);
+
+/*
+ * Restituisce lo slot di una connessione, in tempo costante atteso
+ * Parametri:
+ *      cm: il gestore delle connessioni
+ *      fd: il file descriptor della connessione
+ * Ritorna: lo slot della connessione, -1 se la connessione non è registrata
+ */
+int conn_find(conn_manager *cm, int fd);
+
+/*
+ * Riceve senza bloccarsi i byte già disponibili della richiesta in corso sulla connessione di uno slot notificato da epoll
+ * Non legge mai oltre la fine della richiesta, quindi le richieste successive restano nel socket; ogni ricezione rinnova il timeout
+ * Il payload di WRITEFILE e PUTFILE è ricevuto direttamente in un buffer dello storage, vedi request.data
+ * Il filename e il payload di tutte le richieste allocate e non ancora deallocate non superano la capacità dello storage, una richiesta che non rientra nel budget
+ * di ricezione lascia il corpo nel socket e la connessione non riceve finchè non è restituita da conn_next_unstalled
+ * Parametri:
+ *      cm: il gestore delle connessioni
+ *      slot: lo slot della connessione
+ *      req: il puntatore in cui memorizzare la richiesta quando è stata ricevuta per intero, la richiesta passa al chiamante
+ * Errno:
+ *      ECONNRESET: se il client ha chiuso la connessione
+ *      EPROTO: se la versione del protocollo della richiesta non è supportata
+ *      ENOMEM: se non è possibile allocare la richiesta
+ *      vedi man recvmsg per altri errno
+ * Ritorna: 1 se la richiesta è completa, 0 se mancano ancora dei byte oppure la richiesta è stata rifiutata, vedi conn_reject, -1 in caso di errore, in tal caso la connessione deve essere chiusa
+ */
+int conn_read(conn_manager *cm, int slot, request **req);
+
+/*
+ * Verifica se la connessione di uno slot può ricevere un'altra richiesta
+ * Una connessione riceve al più PIPELINE_DEPTH richieste non ancora soddisfatte, contando anche quelle la cui risposta non è stata inviata per intero
+ * Una connessione in attesa del budget di ricezione non può ricevere
+ * Parametri:
+ *      cm: il gestore delle connessioni
+ *      slot: lo slot della connessione
+ * Ritorna: 1 se la connessione può ricevere, 0 altrimenti
+ */
+int conn_readable(conn_manager *cm, int slot);
+
+/*
+ * Invia senza bloccarsi le risposte in coda sulla connessione di uno slot, ogni invio rinnova il timeout
+ * Parametri:
+ *      cm: il gestore delle connessioni
+ *      slot: lo slot della connessione
+ * Errno:
+ *      vedi man sendmsg
+ * Ritorna: 1 se tutte le risposte sono state inviate, 0 se il socket non accetta altri byte, -1 in caso di errore, in tal caso la connessione deve essere chiusa
+ */
+int conn_write(conn_manager *cm, int slot);
+
+/*
+ * Decide se una richiesta ricevuta per intero può essere assegnata subito ad un worker, altrimenti la inserisce tra le richieste in attesa della connessione
+ * Le richieste su file diversi sono eseguite in parallelo, una richiesta su un file in carico ai worker attende il termine della precedente
+ * Le richieste senza filename sono eseguite da sole, dopo il termine delle precedenti e prima dell'inizio delle successive
+ * Il timeout della connessione è sospeso finchè almeno una sua richiesta è in carico ai worker
+ * Parametri:
+ *      cm: il gestore delle connessioni
+ *      slot: lo slot della connessione
+ *      req: la richiesta ricevuta
+ * Ritorna: 1 se la richiesta deve essere assegnata ad un worker, 0 se la richiesta è in attesa e passa alla connessione
+ */
+int conn_dispatch(conn_manager *cm, int slot, request *req);
+
+/*
+ * Estrae la prima richiesta in attesa della connessione di uno slot se può essere assegnata ad un worker
+ * Una lettura di n file non terminata precede le richieste in attesa ed è restituita solo dopo l'invio per intero delle risposte in coda
+ * Parametri:
+ *      cm: il gestore delle connessioni
+ *      slot: lo slot della connessione
+ * Ritorna: la richiesta da assegnare ad un worker, NULL se non esistono richieste pronte
+ */
+request *conn_next_ready(conn_manager *cm, int slot);
+
+/*
+ * Registra il termine di una richiesta della connessione di uno slot e ne inserisce la risposta in coda, la risposta passa alla connessione
+ * Se la risposta contiene un passo di una lettura di n file non terminata la richiesta passa alla connessione, vedi conn_next_ready
+ * Parametri:
+ *      cm: il gestore delle connessioni
+ *      slot: lo slot della connessione
+ *      resp: la risposta elaborata dal worker, NULL se non è stato possibile generarla, in tal caso la connessione non è più utilizzabile
+ *      close: 1 se la connessione deve essere chiusa dopo l'invio delle risposte in coda, 0 altrimenti
+ * Ritorna: none
+ */
+void conn_resolve(conn_manager *cm, int slot, response *resp, int close);
+
+/*
+ * Segna come non più utilizzabile la connessione di uno slot, scartando le richieste in attesa e le risposte non inviate
+ * Parametri:
+ *      cm: il gestore delle connessioni
+ *      slot: lo slot della connessione
+ * Ritorna: none
+ */
+void conn_fail(conn_manager *cm, int slot);
+
+/*
+ * Verifica se la connessione di uno slot può essere chiusa, le connessioni con richieste in carico ai worker non sono mai chiuse
+ * Parametri:
+ *      cm: il gestore delle connessioni
+ *      slot: lo slot della connessione
+ * Ritorna: 1 se la connessione deve essere chiusa, 0 altrimenti
+ */
+int conn_done(conn_manager *cm, int slot);
+
+/*
+ * Riattiva la notifica di una connessione dopo un evento o dopo il termine di una sua richiesta
+ * La connessione è notificata quando il socket accetta altri byte se esistono risposte in coda e quando arrivano nuovi byte se può ricevere un'altra richiesta
+ * Se nessuna delle due condizioni è vera la connessione resta disattivata finchè un worker non termina una sua richiesta
+ * Parametri:
+ *      cm: il gestore delle connessioni
+ *      fd: il file descriptor della connessione
+ * Errno:
+ *      ENOENT: se la connessione non è registrata
+ *      vedi man epoll_ctl per altri errno
+ * Ritorna: 0 in caso di successo, -1 in caso di errore
+ */
+int conn_rearm(conn_manager *cm, int fd);
+
+/*
+ * Rimuove una connessione dal gestore, deve essere eseguita prima della chiusura del file descriptor
+ * Parametri:
+ *      cm: il gestore delle connessioni
+ *      fd: il file descriptor della connessione
+ * Errno:
+ *      ENOENT: se la connessione non è registrata
+ * Ritorna: 0 in caso di successo, -1 in caso di errore
+ */
+int conn_remove(conn_manager *cm, int fd);
+
+/*
+ * Avanza la timer wheel fino a now e restituisce una connessione scaduta, il costo dipende solo dalle connessioni presenti nelle celle elaborate
+ * La connessione restituita non viene rimossa, il chiamante deve eseguire conn_remove prima di invocare nuovamente la funzione
+ * Parametri:
+ *      cm: il gestore delle connessioni
+ *      now: il momento attuale
+ * Ritorna: il file descriptor di una connessione scaduta, -1 se non esistono connessioni scadute
+ */
+int conn_next_expired(conn_manager *cm, time_t now);
+
+/*
+ * Restituisce la prima connessione in attesa del budget di ricezione se il corpo della sua richiesta può essere addebitato, vedi conn_read
+ * Il corpo viene addebitato subito, la connessione può di nuovo ricevere e deve essere riattivata con conn_rearm
+ * Parametri:
+ *      cm: il gestore delle connessioni
+ * Ritorna: il file descriptor della connessione, -1 se nessuna connessione in attesa può essere riattivata
+ */
+int conn_next_unstalled(conn_manager *cm);
+
+/*
+ * Verifica se una richiesta in attesa può essere assegnata ad un worker e in tal caso la segna come in carico
+ * Parametri:
+ *      cm: il gestore delle connessioni
+ *      slot: lo slot della connessione
+ *      req: la richiesta
+ * Ritorna: 1 se la richiesta è in carico ai worker, 0 altrimenti
+ */
+static int conn_start(conn_manager *cm, int slot, request *req);
+
+/*
+ * Dealloca le richieste in attesa della connessione di uno slot
+ * Parametri:
+ *      conn: la connessione
+ * Ritorna: none
+ */
+static void conn_drop_waiting(conn *conn);
+
+/*
+ * Verifica i campi dell'intestazione di una richiesta, scelti dal client, prima di allocare la richiesta
+ * Parametri:
+ *      cm: il gestore delle connessioni
+ *      header: l'intestazione ricevuta per intero
+ * Ritorna: SUCCESS se la richiesta può essere ricevuta, PAYLOAD_TOO_LARGE se il payload supera la capacità dello storage,
+ *          FILENAME_TOO_LONG se il filename supera UNIX_PATH_MAX, BAD_REQUEST se l'operazione richiede un filename che manca
+ */
+static int conn_check_header(conn_manager *cm, frame_header *header);
+
+/*
+ * Rifiuta la richiesta in corso di ricezione senza allocarla, accodando una risposta di errore
+ * Il corpo della richiesta viene ricevuto e scartato, quindi la connessione resta utilizzabile per le richieste successive
+ * Se il payload supera la capacità dello storage il corpo non viene ricevuto, la connessione non riceve altre richieste e viene chiusa dopo l'invio delle risposte già in coda
+ * Parametri:
+ *      cm: il gestore delle connessioni
+ *      slot: lo slot della connessione
+ *      code: il codice della risposta di errore
+ * Errno:
+ *      ENOMEM: se non è possibile allocare la risposta
+ * Ritorna: 0 in caso di successo, -1 in caso di errore
+ */
+static int conn_reject(conn_manager *cm, int slot, int code);
+
+/*
+ * Inserisce uno slot nella cella della timer wheel corrispondente al suo momento di scadenza
+ * Parametri:
+ *      cm: il gestore delle connessioni
+ *      slot: lo slot da inserire
+ * Ritorna: none
+ */
+static void timer_insert(conn_manager *cm, int slot);
+
+/*
+ * Rimuove uno slot dalla cella della timer wheel in cui è inserito
+ * Parametri:
+ *      cm: il gestore delle connessioni
+ *      slot: lo slot da rimuovere
+ * Ritorna: none
+ */
+static void timer_remove(conn_manager *cm, int slot);
+
+/*
+ * Verifica se il budget di ricezione può contenere il corpo di un'altra richiesta, una richiesta è sempre ricevuta se il budget è libero
+ * Parametri:
+ *      cm: il gestore delle connessioni
+ *      charge: i byte del filename e del payload della richiesta
+ * Ritorna: 1 se il corpo può essere addebitato, 0 altrimenti
+ */
+static int conn_budget(conn_manager *cm, long charge);
+
+/*
+ * Alloca la richiesta di cui è stata ricevuta l'intestazione, addebitandone il filename e il payload al budget di ricezione
+ * Se il budget non è sufficiente la richiesta non viene allocata e la connessione è inserita tra quelle in attesa del budget
+ * Parametri:
+ *      cm: il gestore delle connessioni
+ *      slot: lo slot della connessione
+ * Errno:
+ *      ENOMEM: se non è possibile allocare la richiesta
+ * Ritorna: 0 se la richiesta è allocata oppure la connessione è in attesa del budget, -1 in caso di errore
+ */
+static int conn_alloc(conn_manager *cm, int slot);
+
+/*
+ * Rimuove una connessione tra quelle in attesa del budget di ricezione e restituisce il corpo addebitato ad una richiesta non ancora allocata
+ * Parametri:
+ *      cm: il gestore delle connessioni
+ *      slot: lo slot della connessione
+ * Ritorna: none
+ */
+static void conn_uncharge(conn_manager *cm, int slot);
+
+/*
+ * Inserisce uno slot in fondo alla lista delle connessioni in attesa del budget di ricezione
+ * Parametri:
+ *      cm: il gestore delle connessioni
+ *      slot: lo slot da inserire
+ * Ritorna: none
+ */
+static void stall_insert(conn_manager *cm, int slot);
+
+/*
+ * Rimuove uno slot dalla lista delle connessioni in attesa del budget di ricezione
+ * Parametri:
+ *      cm: il gestore delle connessioni
+ *      slot: lo slot da rimuovere
+ * Ritorna: none
+ */
+static void stall_remove(conn_manager *cm, int slot);
+
+int init_conn_manager(conn_manager *cm, int listen_fd, int max, int timeout, storage *storage) {
+    struct epoll_event event;
+
+    int i;
+
+    if(cm == NULL || listen_fd < 0 || max <= 0 || storage == NULL) {
+        errno = EINVAL;
+
+        return -1;
+    }
+
+    if((cm->epoll_fd = epoll_create1(EPOLL_CLOEXEC)) == -1) {
+        return -1;
+    }
+
+    // Il socket di ascolto rimane sempre armato, le nuove connessioni sono accettate dal solo manager
+    event.events = EPOLLIN;
+    event.data.u32 = CONN_LISTENER;
+
+    if(epoll_ctl(cm->epoll_fd, EPOLL_CTL_ADD, listen_fd, &event) == -1) {
+        close(cm->epoll_fd);
+
+        return -1;
+    }
+
+    cm->listen_fd = listen_fd;
+    cm->listening = 1;
+    cm->timeout = timeout;
+    cm->storage = storage;
+
+    cm->max = max;
+    cm->conns = malloc(max * sizeof(conn));
+    cm->free_slots = malloc(max * sizeof(int));
+    cm->n_free = max;
+
+    // Gli slot liberi sono estratti a partire dallo slot 0
+    for(i = 0; i < max; i++) {
+        cm->conns[i].fd = -1;
+        cm->free_slots[i] = max - 1 - i;
+    }
+
+    // I file descriptor sono interi piccoli e consecutivi, quindi il modulo per una potenza di 2 li distribuisce uniformemente
+    cm->n_buckets = 1;
+    while(cm->n_buckets < max) {
+        cm->n_buckets <<= 1;
+    }
+
+    cm->buckets = malloc(cm->n_buckets * sizeof(int));
+
+    for(i = 0; i < cm->n_buckets; i++) {
+        cm->buckets[i] = -1;
+    }
+
+    for(i = 0; i < CONN_WHEEL_SIZE; i++) {
+        cm->wheel[i] = -1;
+    }
+
+    cm->wheel_time = time(NULL);
+
+    atomic_init(&cm->receiving, 0);
+    cm->stalled = -1;
+    cm->stalled_tail = -1;
+
+    cm->events = malloc((max + 2) * sizeof(struct epoll_event));
+
+    return 0;
+}
+
+void free_conn_manager(conn_manager *cm) {
+    int i;
+
+    for(i = 0; i < cm->max; i++) {
+        if(cm->conns[i].fd != -1) {
+            free_request(cm->conns[i].request);
+
+            conn_drop_waiting(&cm->conns[i]);
+            response_queue_free(&cm->conns[i].out);
+            free_request(cm->conns[i].resume);
+        }
+    }
+
+    close(cm->epoll_fd);
+
+    free(cm->conns);
+    free(cm->free_slots);
+    free(cm->buckets);
+    free(cm->events);
+}
+
+int conn_wait(conn_manager *cm, int timeout) {
+    return epoll_wait(cm->epoll_fd, cm->events, cm->max + 2, timeout);
+}
+
+int conn_listen(conn_manager *cm, int enable) {
+    struct epoll_event event;
+
+    if(cm->listen_fd == -1 || cm->listening == enable) {
+        return 0;
+    }
+
+    // Con il numero massimo di connessioni attive il socket di ascolto viene disattivato, altrimenti epoll lo notificherebbe ad ogni attesa
+    event.events = enable ? EPOLLIN : 0;
+    event.data.u32 = CONN_LISTENER;
+
+    if(epoll_ctl(cm->epoll_fd, EPOLL_CTL_MOD, cm->listen_fd, &event) == -1) {
+        return -1;
+    }
+
+    cm->listening = enable;
+
+    return 0;
+}
+
+void conn_unlisten(conn_manager *cm) {
+    if(cm->listen_fd != -1) {
+        epoll_ctl(cm->epoll_fd, EPOLL_CTL_DEL, cm->listen_fd, NULL);
+
+        cm->listen_fd = -1;
+        cm->listening = 0;
+    }
+}
+
+int conn_notify(conn_manager *cm, int fd) {
+    struct epoll_event event;
+
+    event.events = EPOLLIN;
+    event.data.u32 = CONN_NOTIFY;
+
+    return epoll_ctl(cm->epoll_fd, EPOLL_CTL_ADD, fd, &event);
+}
+
+int conn_add(conn_manager *cm, int fd) {
+    struct epoll_event event;
+
+    int slot;
+    int bucket;
+
+    if(fd < 0) {
+        errno = EINVAL;
+
+        return -1;
+    }
+
+    if(cm->n_free == 0) {
+        errno = EMFILE;
+
+        return -1;
+    }
+
+    slot = cm->free_slots[cm->n_free - 1];
+
+    // EPOLLONESHOT disattiva la connessione dopo la prima notifica, quindi la stessa connessione non è mai assegnata a due worker
+    event.events = EPOLLIN | EPOLLONESHOT;
+    event.data.u32 = slot;
+
+    if(epoll_ctl(cm->epoll_fd, EPOLL_CTL_ADD, fd, &event) == -1) {
+        return -1;
+    }
+
+    cm->n_free--;
+
+    cm->conns[slot].fd = fd;
+    cm->conns[slot].busy = 0;
+    cm->conns[slot].received = 0;
+    cm->conns[slot].request = NULL;
+    cm->conns[slot].discard = 0;
+    cm->conns[slot].stalled = 0;
+    cm->conns[slot].charged = 0;
+    cm->conns[slot].inflight = 0;
+    cm->conns[slot].barrier = 0;
+    cm->conns[slot].waiting = NULL;
+    cm->conns[slot].waiting_tail = NULL;
+    cm->conns[slot].n_waiting = 0;
+    cm->conns[slot].resume = NULL;
+    cm->conns[slot].closing = 0;
+    cm->conns[slot].broken = 0;
+    response_queue_init(&cm->conns[slot].out);
+
+    bucket = fd & (cm->n_buckets - 1);
+    cm->conns[slot].hash_next = cm->buckets[bucket];
+    cm->buckets[bucket] = slot;
+
+    cm->conns[slot].expire = time(NULL) + cm->timeout;
+    timer_insert(cm, slot);
+
+    return slot;
+}
+
+int conn_find(conn_manager *cm, int fd) {
+    int slot;
+
+    if(fd < 0) {
+        return -1;
+    }
+
+    slot = cm->buckets[fd & (cm->n_buckets - 1)];
+
+    while(slot != -1 && cm->conns[slot].fd != fd) {
+        slot = cm->conns[slot].hash_next;
+    }
+
+    return slot;
+}
+
+int conn_read(conn_manager *cm, int slot, request **req) {
+    conn *conn = &cm->conns[slot];
+    struct msghdr msg;
+    struct iovec iov[2];
+
+    char sink[CONN_DISCARD_SIZE];
+    char *payload;
+
+    size_t name_len;
+    size_t payload_len;
+    size_t got;
+    ssize_t r;
+
+    int code;
+    int progress = 0;
+    int result = 0;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+
+    while(1) {
+        if(conn->discard == 0 && conn->request == NULL && conn->received == sizeof(frame_header)) {
+            // L'intestazione è completa, il corpo viene ricevuto solo se il budget di ricezione può contenerlo
+            if(conn_alloc(cm, slot) == -1) {
+                return -1;
+            }
+
+            if(conn->request == NULL) {
+                break;
+            }
+        }
+
+        if(conn->discard > 0) {
+            // Riceve il corpo della richiesta rifiutata, i cui byte non sono memorizzati
+            iov[0].iov_base = sink;
+            iov[0].iov_len = conn->discard < sizeof(sink) ? conn->discard : sizeof(sink);
+            msg.msg_iovlen = 1;
+        } else if(conn->request == NULL) {
+            // Riceve la parte mancante dell'intestazione
+            iov[0].iov_base = (char *)&conn->header + conn->received;
+            iov[0].iov_len = sizeof(frame_header) - conn->received;
+            msg.msg_iovlen = 1;
+        } else {
+            name_len = conn->header.name_len;
+            payload_len = conn->header.payload_len;
+            got = conn->received - sizeof(frame_header);
+
+            if(got == name_len + payload_len) {
+                // La richiesta è completa
+                result = 1;
+
+                break;
+            }
+
+            // Il payload segue il terminatore del filename nel corpo della richiesta, oppure è ricevuto nel buffer del contenuto del file
+            payload = conn->request->data != NULL ? conn->request->data->base : conn->request->body + name_len + 1;
+
+            // Il filename e il payload sono ricevuti direttamente nella loro destinazione
+            if(got < name_len) {
+                iov[0].iov_base = conn->request->body + got;
+                iov[0].iov_len = name_len - got;
+                iov[1].iov_base = payload;
+                iov[1].iov_len = payload_len;
+                msg.msg_iovlen = 2;
+            } else {
+                iov[0].iov_base = payload + (got - name_len);
+                iov[0].iov_len = name_len + payload_len - got;
+                msg.msg_iovlen = 1;
+            }
+        }
+
+        if((r = recvmsg(conn->fd, &msg, MSG_DONTWAIT)) == -1) {
+            if(errno == EINTR) {
+                continue;
+            }
+
+            if(errno == EAGAIN || errno == EWOULDBLOCK) {
+                // I byte disponibili sono terminati, il resto della richiesta arriverà con una notifica successiva
+                break;
+            }
+
+            return -1;
+        }
+
+        if(r == 0) {
+            errno = ECONNRESET;
+
+            return -1;
+        }
+
+        progress = 1;
+
+        if(conn->discard > 0) {
+            conn->discard -= r;
+
+            continue;
+        }
+
+        conn->received += r;
+
+        if(conn->request == NULL && conn->received == sizeof(frame_header)) {
+            if(conn->header.version != PROTOCOL_VERSION) {
+                errno = EPROTO;
+
+                return -1;
+            }
+
+            // Una richiesta con dimensioni non valide viene rifiutata senza allocarla, il payload di una sola richiesta non supera la capacità dello storage
+            // Le richieste di tutte le connessioni sono allocate solo finchè il budget di ricezione lo consente, vedi conn_alloc
+            if((code = conn_check_header(cm, &conn->header)) != SUCCESS) {
+                if(conn_reject(cm, slot, code) == -1) {
+                    return -1;
+                }
+
+                break;
+            }
+        }
+    }
+
+    if(progress && !conn->busy) {
+        // Un client lento ma attivo non viene chiuso per inattività
+        timer_remove(cm, slot);
+
+        conn->expire = time(NULL) + cm->timeout;
+        timer_insert(cm, slot);
+    }
+
+    if(result == 1) {
+        conn->request->body[name_len] = '\0';
+        conn->request->body[name_len + 1 + (conn->request->data != NULL ? 0 : payload_len)] = '\0';
+
+        *req = conn->request;
+
+        conn->request = NULL;
+        conn->received = 0;
+    }
+
+    return result;
+}
+
+int conn_write(conn_manager *cm, int slot) {
+    conn *conn = &cm->conns[slot];
+
+    int result;
+    int sent;
+
+    result = response_queue_flush(&conn->out, conn->fd, &sent);
+
+    if(sent && !conn->busy) {
+        // Un client lento ma attivo nel ricevere le risposte non viene chiuso per inattività
+        timer_remove(cm, slot);
+
+        conn->expire = time(NULL) + cm->timeout;
+        timer_insert(cm, slot);
+    }
+
+    return result;
+}
+
+int conn_readable(conn_manager *cm, int slot) {
+    conn *conn = &cm->conns[slot];
+
+    return !conn->closing && !conn->stalled && conn->inflight + conn->n_waiting + (conn->resume != NULL) + conn->out.count < PIPELINE_DEPTH;
+}
+
+int conn_dispatch(conn_manager *cm, int slot, request *req) {
+    conn *conn = &cm->conns[slot];
+
+    // Le richieste senza filename riguardano l'intero storage o la connessione, la chiave 0 le identifica
+    req->key = req->header.name_len > 0 ? hash_filename(req->body) : 0;
+    req->next = NULL;
+
+    if(req->header.opcode == CLOSECONN) {
+        // Le richieste successive alla chiusura non sono ricevute
+        conn->closing = 1;
+    }
+
+    // Una richiesta non supera mai quelle ricevute prima e ancora in attesa
+    if(conn->waiting == NULL && conn_start(cm, slot, req)) {
+        return 1;
+    }
+
+    if(conn->waiting_tail == NULL) {
+        conn->waiting = req;
+    } else {
+        conn->waiting_tail->next = req;
+    }
+
+    conn->waiting_tail = req;
+    conn->n_waiting++;
+
+    return 0;
+}
+
+request *conn_next_ready(conn_manager *cm, int slot) {
+    conn *conn = &cm->conns[slot];
+    request *req = conn->waiting;
+
+    if(conn->resume != NULL) {
+        // Il passo successivo della lettura di n file fissa altri file solo quando le risposte precedenti sono state inviate
+        if(conn->out.head != NULL) {
+            return NULL;
+        }
+
+        // Nessun'altra richiesta è in carico ai worker mentre la lettura è sospesa, quindi la richiesta è sempre avviata
+        req = conn->resume;
+        conn->resume = NULL;
+
+        conn_start(cm, slot, req);
+
+        return req;
+    }
+
+    if(req == NULL || !conn_start(cm, slot, req)) {
+        return NULL;
+    }
+
+    conn->waiting = req->next;
+
+    if(conn->waiting == NULL) {
+        conn->waiting_tail = NULL;
+    }
+
+    conn->n_waiting--;
+
+    return req;
+}
+
+void conn_resolve(conn_manager *cm, int slot, response *resp, int close) {
+    conn *conn = &cm->conns[slot];
+
+    int i;
+
+    // Rimuove la chiave della richiesta terminata, se la risposta non esiste la connessione sarà chiusa e la chiave è irrilevante
+    for(i = 0; i < conn->inflight - 1 && (resp == NULL || conn->keys[i] != resp->key); i++);
+
+    conn->keys[i] = conn->keys[conn->inflight - 1];
+    conn->inflight--;
+
+    // Una richiesta eseguita da sola è l'unica in carico ai worker
+    conn->barrier = 0;
+
+    if(conn->inflight == 0) {
+        conn->busy = 0;
+        conn->expire = time(NULL) + cm->timeout;
+
+        timer_insert(cm, slot);
+    }
+
+    if(resp == NULL) {
+        conn_fail(cm, slot);
+    } else if(conn->broken) {
+        response_free(resp);
+    } else {
+        // La lettura di n file non è terminata, le richieste successive attendono il suo ultimo passo
+        conn->resume = resp->resume;
+        resp->resume = NULL;
+
+        response_queue_push(&conn->out, resp);
+
+        if(close) {
+            conn->closing = 1;
+        }
+    }
+}
+
+void conn_fail(conn_manager *cm, int slot) {
+    conn *conn = &cm->conns[slot];
+
+    conn->broken = 1;
+    conn->closing = 1;
+
+    conn_uncharge(cm, slot);
+
+    free_request(conn->request);
+    conn->request = NULL;
+
+    conn_drop_waiting(conn);
+    response_queue_free(&conn->out);
+
+    free_request(conn->resume);
+    conn->resume = NULL;
+}
+
+int conn_done(conn_manager *cm, int slot) {
+    conn *conn = &cm->conns[slot];
+
+    // Finchè un worker elabora una richiesta lo stato della connessione nello storage non può essere ripristinato
+    if(!conn->closing || conn->inflight > 0) {
+        return 0;
+    }
+
+    return conn->broken || (conn->waiting == NULL && conn->resume == NULL && conn->out.head == NULL);
+}
+
+int conn_rearm(conn_manager *cm, int fd) {
+    struct epoll_event event;
+
+    int slot;
+
+    if((slot = conn_find(cm, fd)) == -1) {
+        errno = ENOENT;
+
+        return -1;
+    }
+
+    event.events = 0;
+
+    if(cm->conns[slot].out.head != NULL) {
+        event.events |= EPOLLOUT;
+    }
+
+    if(conn_readable(cm, slot)) {
+        event.events |= EPOLLIN;
+    }
+
+    if(event.events == 0) {
+        // epoll notificherebbe comunque EPOLLHUP, la connessione resta disattivata da EPOLLONESHOT
+        return 0;
+    }
+
+    event.events |= EPOLLONESHOT;
+    event.data.u32 = slot;
+
+    return epoll_ctl(cm->epoll_fd, EPOLL_CTL_MOD, fd, &event);
+}
+
+int conn_remove(conn_manager *cm, int fd) {
+    int slot;
+    int *prev;
+
+    if((slot = conn_find(cm, fd)) == -1) {
+        errno = ENOENT;
+
+        return -1;
+    }
+
+    epoll_ctl(cm->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+
+    // La richiesta ricevuta solo in parte non sarà mai completata
+    free_request(cm->conns[slot].request);
+    cm->conns[slot].request = NULL;
+
+    // Le richieste in attesa e le risposte non ancora inviate non possono più essere consegnate
+    conn_drop_waiting(&cm->conns[slot]);
+    response_queue_free(&cm->conns[slot].out);
+
+    free_request(cm->conns[slot].resume);
+    cm->conns[slot].resume = NULL;
+
+    if(!cm->conns[slot].busy) {
+        timer_remove(cm, slot);
+    }
+
+    conn_uncharge(cm, slot);
+
+    // Rimuove lo slot dalla lista di trabocco della tabella
+    prev = &cm->buckets[fd & (cm->n_buckets - 1)];
+    while(*prev != slot) {
+        prev = &cm->conns[*prev].hash_next;
+    }
+    *prev = cm->conns[slot].hash_next;
+
+    cm->conns[slot].fd = -1;
+    cm->free_slots[cm->n_free] = slot;
+    cm->n_free++;
+
+    return 0;
+}
+
+int conn_next_expired(conn_manager *cm, time_t now) {
+    int slot;
+
+    // Dopo un'attesa più lunga di un giro della timer wheel è sufficiente elaborare ogni cella una sola volta
+    if(now - cm->wheel_time >= CONN_WHEEL_SIZE) {
+        cm->wheel_time = now - CONN_WHEEL_SIZE + 1;
+    }
+
+    while(1) {
+        slot = cm->wheel[cm->wheel_time & (CONN_WHEEL_SIZE - 1)];
+
+        // Una cella può contenere connessioni che scadono nei giri successivi della timer wheel
+        while(slot != -1 && cm->conns[slot].expire > now) {
+            slot = cm->conns[slot].timer_next;
+        }
+
+        if(slot != -1) {
+            return cm->conns[slot].fd;
+        }
+
+        if(cm->wheel_time >= now) {
+            // La cella corrente viene elaborata di nuovo alla chiamata successiva
+            return -1;
+        }
+
+        cm->wheel_time++;
+    }
+}
+
+int conn_next_unstalled(conn_manager *cm) {
+    int slot = cm->stalled;
+
+    long charge;
+
+    if(slot == -1) {
+        return -1;
+    }
+
+    charge = cm->conns[slot].header.name_len + cm->conns[slot].header.payload_len;
+
+    // Le connessioni sono riattivate nell'ordine in cui si sono fermate, il corpo è addebitato subito in modo che le successive vedano il budget rimasto
+    if(!conn_budget(cm, charge)) {
+        return -1;
+    }
+
+    atomic_fetch_add(&cm->receiving, charge);
+
+    stall_remove(cm, slot);
+
+    cm->conns[slot].stalled = 0;
+    cm->conns[slot].charged = 1;
+
+    return cm->conns[slot].fd;
+}
+
+static int conn_start(conn_manager *cm, int slot, request *req) {
+    conn *conn = &cm->conns[slot];
+
+    int i;
+
+    if(conn->barrier || conn->resume != NULL || (req->key == 0 && conn->inflight > 0)) {
+        return 0;
+    }
+
+    for(i = 0; i < conn->inflight; i++) {
+        if(conn->keys[i] == req->key) {
+            return 0;
+        }
+    }
+
+    // Il timeout è sospeso in modo che il manager non chiuda una connessione in uso da un worker
+    if(conn->inflight == 0) {
+        timer_remove(cm, slot);
+
+        conn->busy = 1;
+    }
+
+    conn->keys[conn->inflight++] = req->key;
+
+    if(req->key == 0) {
+        conn->barrier = 1;
+    }
+
+    return 1;
+}
+
+static int conn_check_header(conn_manager *cm, frame_header *header) {
+    // Solo la chiusura della connessione, la lettura di n file e la registrazione delle scritture senza contenuto non riguardano un file
+    int no_path = header->opcode == CLOSECONN || header->opcode == READNFILE || header->opcode == WRITE_NO_CONTENT;
+
+    if(header->payload_len > (uint64_t)cm->storage->size.size_bytes) {
+        return PAYLOAD_TOO_LARGE;
+    }
+
+    if(header->name_len > UNIX_PATH_MAX) {
+        return FILENAME_TOO_LONG;
+    }
+
+    if(!no_path && header->name_len == 0) {
+        return BAD_REQUEST;
+    }
+
+    return SUCCESS;
+}
+
+static int conn_reject(conn_manager *cm, int slot, int code) {
+    conn *conn = &cm->conns[slot];
+    response *resp;
+
+    if((resp = malloc(sizeof(response))) == NULL) {
+        errno = ENOMEM;
+
+        return -1;
+    }
+
+    resp->header.version = PROTOCOL_VERSION;
+    resp->header.opcode = code;
+    resp->header.flags = 0;
+    resp->header.name_len = 0;
+    resp->header.payload_len = 0;
+    resp->header.request_id = conn->header.request_id;
+
+    // La risposta è composta dalla sola intestazione
+    resp->iov = resp->inline_iov;
+    resp->iovcnt = 1;
+    resp->iov[0].iov_base = &resp->header;
+    resp->iov[0].iov_len = sizeof(frame_header);
+    resp->iov_alloc = NULL;
+    resp->src = NULL;
+
+    resp->payload = NULL;
+    resp->data = NULL;
+    resp->victims = NULL;
+    resp->victims_h = NULL;
+    resp->storage = cm->storage;
+    resp->key = 0;
+    resp->resume = NULL;
+
+    response_queue_push(&conn->out, resp);
+
+    // Il corpo di un payload troppo grande non viene ricevuto, gli altri sono limitati dalla capacità dello storage e vengono scartati
+    if(code == PAYLOAD_TOO_LARGE) {
+        conn->closing = 1;
+    } else {
+        conn->discard = conn->header.name_len + conn->header.payload_len;
+    }
+
+    conn->received = 0;
+
+    return 0;
+}
+
+static void conn_drop_waiting(conn *conn) {
+    request *req;
+
+    while((req = conn->waiting) != NULL) {
+        conn->waiting = req->next;
+
+        free_request(req);
+    }
+
+    conn->waiting_tail = NULL;
+    conn->n_waiting = 0;
+}
+
+static void timer_insert(conn_manager *cm, int slot) {
+    int *head = &cm->wheel[cm->conns[slot].expire & (CONN_WHEEL_SIZE - 1)];
+
+    cm->conns[slot].timer_prev = -1;
+    cm->conns[slot].timer_next = *head;
+
+    if(*head != -1) {
+        cm->conns[*head].timer_prev = slot;
+    }
+
+    *head = slot;
+}
+
+static void timer_remove(conn_manager *cm, int slot) {
+    conn *conn = &cm->conns[slot];
+
+    if(conn->timer_prev != -1) {
+        cm->conns[conn->timer_prev].timer_next = conn->timer_next;
+    } else {
+        cm->wheel[conn->expire & (CONN_WHEEL_SIZE - 1)] = conn->timer_next;
+    }
+
+    if(conn->timer_next != -1) {
+        cm->conns[conn->timer_next].timer_prev = conn->timer_prev;
+    }
+}
+
+static int conn_budget(conn_manager *cm, long charge) {
+    long receiving = atomic_load(&cm->receiving);
+
+    // Solo il manager addebita il budget, i worker possono solo liberarlo, quindi la verifica resta valida fino all'addebito
+    return receiving == 0 || receiving + charge <= cm->storage->size.size_bytes;
+}
+
+static int conn_alloc(conn_manager *cm, int slot) {
+    conn *conn = &cm->conns[slot];
+
+    long charge = conn->header.name_len + conn->header.payload_len;
+    int direct;
+
+    if(!conn->charged) {
+        if(!conn_budget(cm, charge)) {
+            // Il corpo resta nel socket e la connessione non è notificata per la ricezione finchè i worker non rilasciano abbastanza richieste
+            conn->stalled = 1;
+            stall_insert(cm, slot);
+
+            return 0;
+        }
+
+        atomic_fetch_add(&cm->receiving, charge);
+    }
+
+    // L'addebito passa alla richiesta, che lo restituisce quando viene deallocata
+    conn->charged = 0;
+
+    // Il payload di una scrittura è ricevuto nel buffer che diventerà il contenuto del file, che il worker passa allo storage senza copiarlo
+    // Il buffer è allocato solo per un contenuto che può essere memorizzato nello storage e la cui dimensione è rappresentabile in un f_data
+    direct = (conn->header.opcode == WRITEFILE || conn->header.opcode == PUTFILE) && conn->header.payload_len > 0 &&
+             conn->header.payload_len <= (uint64_t)cm->storage->size.size_bytes && conn->header.payload_len <= INT_MAX;
+
+    if((conn->request = malloc(sizeof(request) + conn->header.name_len + (direct ? 0 : conn->header.payload_len) + 2)) == NULL) {
+        atomic_fetch_sub(&cm->receiving, charge);
+
+        errno = ENOMEM;
+
+        return -1;
+    }
+
+    conn->request->fd = conn->fd;
+    conn->request->header = conn->header;
+    conn->request->data = NULL;
+    conn->request->arena = &cm->storage->arena;
+    conn->request->budget = &cm->receiving;
+    conn->request->charge = charge;
+
+    // Il flag MORE_FRAMES identifica le letture riprese dal manager, un client non può far riprendere un cursore che non esiste
+    conn->request->header.flags &= ~MORE_FRAMES;
+
+    if(direct && (conn->request->data = alloc_content(cm->storage, conn->header.payload_len)) == NULL) {
+        errno = ENOMEM;
+
+        return -1;
+    }
+
+    return 0;
+}
+
+static void conn_uncharge(conn_manager *cm, int slot) {
+    conn *conn = &cm->conns[slot];
+
+    if(conn->stalled) {
+        stall_remove(cm, slot);
+
+        conn->stalled = 0;
+    }
+
+    if(conn->charged) {
+        atomic_fetch_sub(&cm->receiving, conn->header.name_len + conn->header.payload_len);
+
+        conn->charged = 0;
+    }
+}
+
+static void stall_insert(conn_manager *cm, int slot) {
+    cm->conns[slot].stall_next = -1;
+    cm->conns[slot].stall_prev = cm->stalled_tail;
+
+    if(cm->stalled_tail != -1) {
+        cm->conns[cm->stalled_tail].stall_next = slot;
+    } else {
+        cm->stalled = slot;
+    }
+
+    cm->stalled_tail = slot;
+}
+
+static void stall_remove(conn_manager *cm, int slot) {
+    conn *conn = &cm->conns[slot];
+
+    if(conn->stall_prev != -1) {
+        cm->conns[conn->stall_prev].stall_next = conn->stall_next;
+    } else {
+        cm->stalled = conn->stall_next;
+    }
+
+    if(conn->stall_next != -1) {
+        cm->conns[conn->stall_next].stall_prev = conn->stall_prev;
+    } else {
+        cm->stalled_tail = conn->stall_prev;
+    }
+}
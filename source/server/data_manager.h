@@ -0,0 +1,644 @@
+#ifndef DATA_MANAGER_H
+#define DATA_MANAGER_H
+
+#include <unistd.h>
+#include <stdatomic.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+
+#include "slab_manager.h"
+
+#define DATA_CHUNK_MIN (4 * 1024)                   // Dimensione minima del contenuto di un chunk aggiunto da una concatenazione
+#define DATA_MEMFD_MIN (64 * 1024)                  // Dimensione minima di un contenuto memorizzato in un memfd, i contenuti più piccoli restano nell'arena
+
+struct f_chunk {
+    struct f_chunk *next;                   // Il chunk successivo, NULL se è l'ultimo
+    int capacity;                           // Dimensione del contenuto del chunk, determinata dalla classe del blocco
+    char content[];                         // Contenuto del chunk, pieno in tutti i chunk tranne l'ultimo
+};
+
+struct f_data {
+    atomic_int refs;                        // Numero di riferimenti al buffer ancora in uso, il buffer è deallocato quando raggiunge 0
+    atomic_int size;                        // Dimensione in byte del contenuto, aggiornata dopo la scrittura dei byte concatenati
+    int capacity;                           // Dimensione del primo chunk, determinata dalla classe del blocco
+    struct f_chunk *next;                   // Il primo dei chunk aggiunti dalle concatenazioni, NULL se il contenuto occupa solo il primo chunk
+    struct f_chunk *tail;                   // L'ultimo chunk aggiunto, NULL se il contenuto occupa solo il primo chunk
+    int tail_start;                         // Posizione nel contenuto del primo byte dell'ultimo chunk, 0 se il contenuto occupa solo il primo chunk
+    int fd;                                 // memfd che contiene il primo chunk, -1 se il primo chunk è allocato nello stesso blocco del buffer
+    char *base;                             // Il primo chunk del contenuto, content oppure la mappatura del memfd
+    char content[];                         // Il primo chunk del contenuto, se non è memorizzato in un memfd
+};
+
+struct data_source {
+    int fd;                                 // memfd da cui inviare il buffer con sendfile, -1 se il buffer deve essere inviato dalla memoria
+    char *map;                              // Indirizzo a cui è mappato l'inizio del memfd
+};
+
+typedef struct f_chunk f_chunk;
+typedef struct f_data f_data;
+typedef struct data_source data_source;
+
+/*
+ * Alloca un nuovo buffer con un solo riferimento, posseduto dal chiamante
+ * Il buffer occupa un blocco dell'arena, lo spazio che avanza nel blocco resta disponibile in capacity
+ * Parametri:
+ *      arena: l'arena da cui allocare il buffer
+ *      size: la dimensione in byte del contenuto che dovrà essere memorizzato nel buffer
+ * Errno:
+ *      EINVAL: se size < 0
+ *      ENOMEM: se non è possibile allocare il buffer
+ * Ritorna: il puntatore al buffer con il contenuto vuoto, NULL in caso di errore
+ */
+f_data *data_alloc(slab_arena *arena, int size);
+
+/*
+ * Alloca un nuovo buffer con un solo riferimento e vi copia il contenuto
+ * Parametri:
+ *      arena: l'arena da cui allocare il buffer
+ *      content: il contenuto da copiare nel buffer
+ *      size: la dimensione in byte di content
+ * Errno:
+ *      EINVAL: se content è NULL oppure size < 0
+ *      ENOMEM: se non è possibile allocare il buffer
+ * Ritorna: il puntatore al buffer, NULL in caso di errore
+ */
+f_data *data_create(slab_arena *arena, const char *content, int size);
+
+/*
+ * Alloca un nuovo buffer con un solo riferimento, il primo chunk è memorizzato in un memfd mappato in memoria
+ * Il memfd è esteso fino alla pagina successiva, lo spazio che avanza resta disponibile in capacity
+ * Parametri:
+ *      arena: l'arena da cui allocare il buffer
+ *      size: la dimensione in byte del contenuto che dovrà essere memorizzato nel buffer
+ * Errno:
+ *      EINVAL: se size <= 0
+ *      ENOMEM: se non è possibile allocare il buffer
+ *      errno di memfd_create, ftruncate, mmap: se non è possibile creare il memfd
+ * Ritorna: il puntatore al buffer con il contenuto vuoto, NULL in caso di errore
+ */
+f_data *data_alloc_memfd(slab_arena *arena, int size);
+
+/*
+ * Alloca un nuovo buffer con un solo riferimento e vi copia il contenuto, il primo chunk è memorizzato in un memfd
+ * Il contenuto può così essere inviato con sendfile dalle pagine del memfd, senza passare per un buffer in memoria utente
+ * Parametri:
+ *      arena: l'arena da cui allocare il buffer
+ *      content: il contenuto da copiare nel buffer
+ *      size: la dimensione in byte di content
+ * Errno:
+ *      EINVAL: se content è NULL oppure size <= 0
+ *      ENOMEM: se non è possibile allocare il buffer
+ *      errno di memfd_create, ftruncate, mmap: se non è possibile creare il memfd, in tal caso il chiamante può usare data_create
+ * Ritorna: il puntatore al buffer, NULL in caso di errore
+ */
+f_data *data_create_memfd(slab_arena *arena, const char *content, int size);
+
+/*
+ * Concatena content al contenuto del buffer senza copiare i byte già presenti
+ * I byte sono scritti nello spazio libero dell'ultimo chunk e, se non è sufficiente, in un nuovo chunk
+ * I lettori che possiedono un riferimento continuano a leggere il prefisso di dimensione data_size, che non viene modificato
+ * Deve essere eseguita da un solo thread alla volta per ogni buffer
+ * Parametri:
+ *      arena: l'arena da cui allocare i nuovi chunk
+ *      data: il buffer a cui concatenare il contenuto
+ *      content: il contenuto da concatenare
+ *      size: la dimensione in byte di content
+ * Errno:
+ *      EINVAL: se data è NULL oppure content è NULL oppure size < 0
+ *      ENOMEM: se non è possibile allocare un nuovo chunk, in tal caso il contenuto del buffer non viene modificato
+ * Ritorna: 0 in caso di successo, -1 in caso di errore
+ */
+int data_append(slab_arena *arena, f_data *data, const char *content, int size);
+
+/*
+ * Sovrascrive i byte del contenuto a partire da offset, i byte oltre la fine del contenuto sono concatenati con data_append
+ * Solo i chunk che contengono l'intervallo sono modificati, quindi il chiamante deve possedere l'unico riferimento al buffer, vedi data_shared
+ * Parametri:
+ *      arena: l'arena da cui allocare i nuovi chunk
+ *      data: il buffer da modificare
+ *      offset: la posizione del primo byte da scrivere, al più data_size(data)
+ *      content: i byte da scrivere
+ *      size: la dimensione in byte di content
+ * Errno:
+ *      EINVAL: se data è NULL oppure content è NULL oppure size < 0 oppure offset non è compreso nel contenuto
+ *      ENOMEM: se non è possibile allocare un nuovo chunk, in tal caso il contenuto del buffer non viene modificato
+ * Ritorna: 0 in caso di successo, -1 in caso di errore
+ */
+int data_write(slab_arena *arena, f_data *data, int offset, const char *content, int size);
+
+/*
+ * Alloca un nuovo buffer con un solo riferimento e vi copia il contenuto di data in un solo chunk
+ * Se data è memorizzato in un memfd anche la copia lo è, se la creazione del memfd fallisce la copia è allocata nell'arena
+ * Parametri:
+ *      arena: l'arena da cui allocare il buffer
+ *      data: il buffer da copiare
+ *      capacity: la dimensione minima del primo chunk della copia, se è maggiore di data_size(data) i byte concatenati in seguito non richiedono nuovi chunk
+ * Errno:
+ *      ENOMEM: se non è possibile allocare il buffer
+ * Ritorna: il puntatore al nuovo buffer, NULL in caso di errore
+ */
+f_data *data_clone(slab_arena *arena, f_data *data, int capacity);
+
+/*
+ * Verifica se il buffer è referenziato anche da altri, ad esempio da una risposta in corso di invio
+ * Un buffer memorizzato in un memfd è sempre condiviso: le pagine inviate con sendfile possono restare nel socket anche dopo il rilascio della risposta
+ * Il risultato è affidabile solo se il chiamante impedisce l'acquisizione di nuovi riferimenti, ad esempio possedendo in modo esclusivo la partizione del file
+ * Parametri:
+ *      data: il buffer
+ * Ritorna: 1 se esistono altri riferimenti oppure il buffer è memorizzato in un memfd, 0 altrimenti
+ */
+int data_shared(f_data *data);
+
+/*
+ * Restituisce la dimensione del contenuto, tutti i byte del prefisso restituito sono già stati scritti
+ * Parametri:
+ *      data: il buffer
+ * Ritorna: la dimensione in byte del contenuto
+ */
+int data_size(f_data *data);
+
+/*
+ * Descrive size byte del contenuto a partire da offset come sequenza di buffer, uno per ogni chunk, senza copiarli
+ * Parametri:
+ *      data: il buffer
+ *      offset: la posizione del primo byte da descrivere
+ *      size: il numero di byte da descrivere, offset + size deve essere al più il valore restituito da data_size
+ *      iov: l'array in cui scrivere i buffer, se è NULL i buffer sono solo contati
+ *      src: l'array in cui scrivere l'origine di ogni buffer, il memfd da cui può essere inviato oppure -1, può essere NULL
+ * Ritorna: il numero di buffer necessari, 0 se size == 0
+ */
+int data_iov(f_data *data, int offset, int size, struct iovec *iov, data_source *src);
+
+/*
+ * Restituisce la memoria occupata dal buffer: il blocco dell'arena, oppure le pagine del memfd e il blocco del buffer, e i blocchi dei chunk aggiunti
+ * Deve essere eseguita dal solo thread che modifica il buffer
+ * Parametri:
+ *      arena: l'arena da cui il buffer è stato allocato
+ *      data: il buffer, se è NULL la memoria occupata è 0
+ * Ritorna: la memoria occupata in byte
+ */
+long data_footprint(slab_arena *arena, f_data *data);
+
+/*
+ * Restituisce la memoria occupata da un buffer allocato con data_alloc oppure con data_alloc_memfd
+ * Parametri:
+ *      arena: l'arena da cui il buffer verrebbe allocato
+ *      size: la dimensione in byte del contenuto
+ *      memfd: 1 se il buffer è allocato con data_alloc_memfd, 0 altrimenti
+ * Ritorna: la memoria occupata in byte
+ */
+long data_alloc_footprint(slab_arena *arena, int size, int memfd);
+
+/*
+ * Restituisce la memoria che data_append allocherebbe per concatenare size byte al buffer, 0 se lo spazio libero dell'ultimo chunk è sufficiente
+ * Deve essere eseguita dal solo thread che modifica il buffer, prima della concatenazione
+ * Parametri:
+ *      arena: l'arena da cui allocare i nuovi chunk
+ *      data: il buffer
+ *      size: il numero di byte da concatenare
+ * Ritorna: la memoria in byte del nuovo chunk
+ */
+long data_append_footprint(slab_arena *arena, f_data *data, int size);
+
+/*
+ * Restituisce lo spazio libero nell'ultimo chunk del buffer
+ * Parametri:
+ *      data: il buffer
+ *      size: la dimensione attuale del contenuto
+ * Ritorna: il numero di byte che possono essere concatenati senza un nuovo chunk
+ */
+static int data_tail_space(f_data *data, int size);
+
+/*
+ * Calcola la dimensione del blocco del nuovo chunk necessario per concatenare size byte, il chunk cresce con il contenuto per limitare il numero di chunk
+ * Parametri:
+ *      arena: l'arena da cui allocare il chunk
+ *      old_size: la dimensione attuale del contenuto
+ *      space: lo spazio libero nell'ultimo chunk
+ *      size: il numero di byte da concatenare
+ * Ritorna: la dimensione del blocco del nuovo chunk, 0 se lo spazio libero è sufficiente
+ */
+static size_t data_chunk_usable(slab_arena *arena, int old_size, int space, int size);
+
+/*
+ * Acquisisce un nuovo riferimento al buffer, che resta valido fino al rilascio corrispondente
+ * Parametri:
+ *      data: il buffer di cui acquisire un riferimento
+ * Ritorna: data
+ */
+f_data *data_acquire(f_data *data);
+
+/*
+ * Rilascia un riferimento al buffer e lo restituisce all'arena, insieme ai suoi chunk, se era l'ultimo
+ * Parametri:
+ *      arena: l'arena da cui il buffer è stato allocato
+ *      data: il buffer di cui rilasciare il riferimento, se è NULL non viene eseguita alcuna operazione
+ * Ritorna: none
+ */
+void data_release(slab_arena *arena, f_data *data);
+
+f_data *data_alloc(slab_arena *arena, int size) {
+    f_data *data;
+
+    size_t usable;
+
+    if(size < 0) {
+        errno = EINVAL;
+
+        return NULL;
+    }
+
+    usable = slab_usable(arena, sizeof(f_data) + size * sizeof(char));
+
+    if((data = slab_alloc(arena, usable)) == NULL) {
+        return NULL;
+    }
+
+    atomic_init(&data->refs, 1);
+    atomic_init(&data->size, size);
+    data->capacity = usable - sizeof(f_data);
+    data->next = NULL;
+    data->tail = NULL;
+    data->tail_start = 0;
+    data->fd = -1;
+    data->base = data->content;
+
+    return data;
+}
+
+f_data *data_create(slab_arena *arena, const char *content, int size) {
+    f_data *data;
+
+    if(content == NULL || size < 0) {
+        errno = EINVAL;
+
+        return NULL;
+    }
+
+    if((data = data_alloc(arena, size)) == NULL) {
+        return NULL;
+    }
+
+    memcpy(data->base, content, size);
+
+    return data;
+}
+
+f_data *data_alloc_memfd(slab_arena *arena, int size) {
+    f_data *data;
+
+    size_t capacity;
+    int err;
+
+    if(size <= 0) {
+        errno = EINVAL;
+
+        return NULL;
+    }
+
+    // Il blocco dell'arena contiene solo il buffer, il contenuto è nel memfd
+    if((data = slab_alloc(arena, sizeof(f_data))) == NULL) {
+        return NULL;
+    }
+
+    // Il memfd è esteso fino alla pagina successiva, lo spazio che avanza resta disponibile alle concatenazioni
+    capacity = (size + SLAB_PAGE_SIZE - 1) / SLAB_PAGE_SIZE * SLAB_PAGE_SIZE;
+
+    if((data->fd = memfd_create("filestorage", MFD_CLOEXEC)) == -1) {
+        err = errno;
+        slab_free(arena, data, sizeof(f_data));
+        errno = err;
+
+        return NULL;
+    }
+
+    if(ftruncate(data->fd, capacity) == -1 ||
+       (data->base = mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, data->fd, 0)) == MAP_FAILED) {
+        err = errno;
+        close(data->fd);
+        slab_free(arena, data, sizeof(f_data));
+        errno = err;
+
+        return NULL;
+    }
+
+    atomic_init(&data->refs, 1);
+    atomic_init(&data->size, size);
+    data->capacity = capacity;
+    data->next = NULL;
+    data->tail = NULL;
+    data->tail_start = 0;
+
+    return data;
+}
+
+f_data *data_create_memfd(slab_arena *arena, const char *content, int size) {
+    f_data *data;
+
+    if(content == NULL || size <= 0) {
+        errno = EINVAL;
+
+        return NULL;
+    }
+
+    if((data = data_alloc_memfd(arena, size)) == NULL) {
+        return NULL;
+    }
+
+    memcpy(data->base, content, size);
+
+    return data;
+}
+
+int data_append(slab_arena *arena, f_data *data, const char *content, int size) {
+    f_chunk *chunk;
+    char *tail_content;
+
+    size_t usable;
+    int tail_capacity;
+    int old_size;
+    int used;
+    int space;
+
+    if(data == NULL || content == NULL || size < 0) {
+        errno = EINVAL;
+
+        return -1;
+    }
+
+    // Solo questo thread modifica la dimensione, quindi non è necessario alcun ordinamento
+    old_size = atomic_load_explicit(&data->size, memory_order_relaxed);
+
+    // I chunk precedenti all'ultimo sono pieni, quindi lo spazio libero è solo in coda
+    if(data->tail == NULL) {
+        tail_content = data->base;
+        tail_capacity = data->capacity;
+    } else {
+        tail_content = data->tail->content;
+        tail_capacity = data->tail->capacity;
+    }
+
+    used = old_size - data->tail_start;
+    space = data_tail_space(data, old_size);
+
+    if((usable = data_chunk_usable(arena, old_size, space, size)) == 0) {
+        memcpy(tail_content + used, content, size);
+    } else {
+        if((chunk = slab_alloc(arena, usable)) == NULL) {
+            return -1;
+        }
+
+        chunk->next = NULL;
+        chunk->capacity = usable - sizeof(f_chunk);
+
+        memcpy(tail_content + used, content, space);
+        memcpy(chunk->content, content + space, size - space);
+
+        if(data->tail == NULL) {
+            data->next = chunk;
+        } else {
+            data->tail->next = chunk;
+        }
+
+        data->tail = chunk;
+        data->tail_start += tail_capacity;
+    }
+
+    // I lettori che osservano la nuova dimensione vedono anche i byte e i chunk scritti prima
+    atomic_store_explicit(&data->size, old_size + size, memory_order_release);
+
+    return 0;
+}
+
+int data_write(slab_arena *arena, f_data *data, int offset, const char *content, int size) {
+    f_chunk *chunk;
+    char *chunk_content;
+
+    int old_size;
+    int overlap;
+    int start = 0;
+    int capacity;
+    int len;
+
+    if(data == NULL || content == NULL || size < 0 || offset < 0 || offset > (old_size = data_size(data))) {
+        errno = EINVAL;
+
+        return -1;
+    }
+
+    overlap = old_size - offset < size ? old_size - offset : size;
+
+    // I byte oltre la fine sono concatenati per primi, in modo che un errore di allocazione non lasci il contenuto modificato
+    if(overlap < size && data_append(arena, data, content + overlap, size - overlap) == -1) {
+        return -1;
+    }
+
+    chunk = NULL;
+    chunk_content = data->base;
+    capacity = data->capacity;
+
+    // Visita solo i chunk che contengono l'intervallo sovrascritto
+    while(overlap > 0) {
+        if(offset < start + capacity) {
+            len = start + capacity - offset < overlap ? start + capacity - offset : overlap;
+
+            memcpy(chunk_content + (offset - start), content, len);
+
+            content += len;
+            offset += len;
+            overlap -= len;
+        }
+
+        start += capacity;
+        chunk = chunk == NULL ? data->next : chunk->next;
+
+        if(chunk != NULL) {
+            chunk_content = chunk->content;
+            capacity = chunk->capacity;
+        }
+    }
+
+    return 0;
+}
+
+f_data *data_clone(slab_arena *arena, f_data *data, int capacity) {
+    f_data *clone;
+    f_chunk *chunk;
+
+    int size;
+    int copied;
+    int len;
+
+    size = data_size(data);
+    capacity = capacity < size ? size : capacity;
+    clone = data->fd != -1 ? data_alloc_memfd(arena, capacity) : NULL;
+
+    if(clone == NULL && (clone = data_alloc(arena, capacity)) == NULL) {
+        return NULL;
+    }
+
+    // Il buffer non è ancora visibile ad altri thread, lo spazio in più resta disponibile alle concatenazioni
+    atomic_store_explicit(&clone->size, size, memory_order_relaxed);
+
+    copied = size < data->capacity ? size : data->capacity;
+    memcpy(clone->base, data->base, copied);
+
+    for(chunk = data->next; copied < size && chunk != NULL; chunk = chunk->next) {
+        len = size - copied < chunk->capacity ? size - copied : chunk->capacity;
+
+        memcpy(clone->base + copied, chunk->content, len);
+
+        copied += len;
+    }
+
+    return clone;
+}
+
+int data_shared(f_data *data) {
+    return data->fd != -1 || atomic_load_explicit(&data->refs, memory_order_acquire) > 1;
+}
+
+int data_size(f_data *data) {
+    return atomic_load_explicit(&data->size, memory_order_acquire);
+}
+
+int data_iov(f_data *data, int offset, int size, struct iovec *iov, data_source *src) {
+    f_chunk *chunk = NULL;
+    char *chunk_content = data->base;
+
+    int capacity = data->capacity;
+    int start = 0;
+    int n = 0;
+    int len;
+
+    // Sono visitati solo i chunk che precedono o contengono byte dell'intervallo, i loro collegamenti sono già visibili
+    while(size > 0) {
+        if(offset < start + capacity) {
+            len = start + capacity - offset < size ? start + capacity - offset : size;
+
+            if(iov != NULL) {
+                iov[n].iov_base = chunk_content + (offset - start);
+                iov[n].iov_len = len;
+            }
+
+            // Solo il primo chunk può essere memorizzato in un memfd
+            if(src != NULL) {
+                src[n].fd = chunk == NULL ? data->fd : -1;
+                src[n].map = chunk == NULL ? data->base : NULL;
+            }
+
+            offset += len;
+            size -= len;
+            n++;
+        }
+
+        start += capacity;
+        chunk = chunk == NULL ? data->next : chunk->next;
+
+        if(chunk == NULL) {
+            break;
+        }
+
+        chunk_content = chunk->content;
+        capacity = chunk->capacity;
+    }
+
+    return n;
+}
+
+long data_footprint(slab_arena *arena, f_data *data) {
+    f_chunk *chunk;
+
+    long footprint;
+
+    if(data == NULL) {
+        return 0;
+    }
+
+    // Il blocco di un buffer nell'arena contiene anche il primo chunk, capacity ne occupa tutto lo spazio che avanza
+    if(data->fd != -1) {
+        footprint = slab_usable(arena, sizeof(f_data)) + data->capacity;
+    } else {
+        footprint = sizeof(f_data) + data->capacity;
+    }
+
+    for(chunk = data->next; chunk != NULL; chunk = chunk->next) {
+        footprint += sizeof(f_chunk) + chunk->capacity;
+    }
+
+    return footprint;
+}
+
+long data_alloc_footprint(slab_arena *arena, int size, int memfd) {
+    if(memfd) {
+        return slab_usable(arena, sizeof(f_data)) + (size + SLAB_PAGE_SIZE - 1) / SLAB_PAGE_SIZE * SLAB_PAGE_SIZE;
+    }
+
+    return slab_usable(arena, sizeof(f_data) + size * sizeof(char));
+}
+
+long data_append_footprint(slab_arena *arena, f_data *data, int size) {
+    int old_size = atomic_load_explicit(&data->size, memory_order_relaxed);
+
+    return data_chunk_usable(arena, old_size, data_tail_space(data, old_size), size);
+}
+
+static int data_tail_space(f_data *data, int size) {
+    // I chunk precedenti all'ultimo sono pieni, quindi lo spazio libero è solo in coda
+    if(data->tail == NULL) {
+        return data->capacity - size;
+    }
+
+    return data->tail->capacity - (size - data->tail_start);
+}
+
+static size_t data_chunk_usable(slab_arena *arena, int old_size, int space, int size) {
+    int wanted;
+
+    if(space >= size) {
+        return 0;
+    }
+
+    // Il nuovo chunk cresce con il contenuto, fino alla classe più grande dell'arena, per limitare il numero di chunk
+    wanted = old_size < (int)(SLAB_MAX_SIZE - sizeof(f_chunk)) ? old_size : (int)(SLAB_MAX_SIZE - sizeof(f_chunk));
+    wanted = wanted < DATA_CHUNK_MIN ? DATA_CHUNK_MIN : wanted;
+    wanted = wanted < size - space ? size - space : wanted;
+
+    return slab_usable(arena, sizeof(f_chunk) + wanted * sizeof(char));
+}
+
+f_data *data_acquire(f_data *data) {
+    // L'incremento non deve ordinare altre operazioni, il chiamante possiede già un riferimento valido
+    atomic_fetch_add_explicit(&data->refs, 1, memory_order_relaxed);
+
+    return data;
+}
+
+void data_release(slab_arena *arena, f_data *data) {
+    f_chunk *chunk;
+    f_chunk *next;
+
+    if(data == NULL) {
+        return;
+    }
+
+    // Il rilascio deve rendere visibili le letture precedenti al thread che dealloca il buffer
+    if(atomic_fetch_sub_explicit(&data->refs, 1, memory_order_acq_rel) == 1) {
+        for(chunk = data->next; chunk != NULL; chunk = next) {
+            next = chunk->next;
+
+            slab_free(arena, chunk, sizeof(f_chunk) + chunk->capacity);
+        }
+
+        if(data->fd != -1) {
+            munmap(data->base, data->capacity);
+            close(data->fd);
+
+            slab_free(arena, data, sizeof(f_data));
+        } else {
+            slab_free(arena, data, sizeof(f_data) + data->capacity);
+        }
+    }
+}
+
+#endif
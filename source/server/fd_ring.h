@@ -0,0 +1,262 @@
+#ifndef FD_RING_H
+#define FD_RING_H
+
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+#define RING_CACHE_LINE 64                                  // Dimensione di una linea di cache, separa gli indici scritti da thread diversi
+
+struct ring_el {
+    int fd;                                                 // Il file descriptor
+    int close;                                              // 1 se la connessione deve essere chiusa, 0 altrimenti
+    void *data;                                             // Dati associati all'elemento, il ring non ne acquisisce la proprietà
+};
+
+struct ring_cell {
+    atomic_size_t seq;                                      // Numero di sequenza della cella, indica se la cella è libera o contiene un elemento per la posizione corrente
+    struct ring_el el;                                      // L'elemento memorizzato nella cella
+};
+
+struct fd_ring {
+    struct ring_cell *cells;                                // Array circolare delle celle, preallocato
+    size_t mask;                                            // Numero di celle meno 1, il numero di celle è una potenza di 2
+
+    alignas(RING_CACHE_LINE) atomic_size_t enqueue_pos;     // Prossima posizione in cui inserire, condivisa dai produttori
+    alignas(RING_CACHE_LINE) atomic_size_t dequeue_pos;     // Prossima posizione da cui estrarre, condivisa dai consumatori
+
+    alignas(RING_CACHE_LINE) atomic_int futex;              // Contatore degli inserimenti, su cui i consumatori attendono con futex quando il ring è vuoto
+    atomic_int waiters;                                     // Numero di consumatori in attesa sul futex
+    atomic_int closed;                                      // 1 se il ring è stato chiuso, i consumatori in attesa vengono risvegliati
+};
+
+typedef struct ring_el ring_el;
+typedef struct ring_cell ring_cell;
+typedef struct fd_ring fd_ring;
+
+/*
+ * Alloca le celle del ring, la capacità è arrotondata alla potenza di 2 successiva
+ * Parametri:
+ *      ring: il ring da inizializzare
+ *      capacity: il numero minimo di elementi che il ring deve poter contenere
+ * Errno:
+ *      EINVAL: se ring == NULL oppure capacity <= 0
+ *      ENOMEM: se non è possibile allocare le celle
+ * Ritorna: 0 in caso di successo, -1 in caso di errore
+ */
+int init_ring(fd_ring *ring, long capacity);
+
+/*
+ * Dealloca le celle del ring
+ * Parametri:
+ *      ring: il ring da deallocare
+ * Ritorna: none
+ */
+void free_ring(fd_ring *ring);
+
+/*
+ * Inserisce un elemento nel ring senza acquisire alcuna lock, può essere eseguita da più produttori contemporaneamente
+ * Se esistono consumatori in attesa ne risveglia uno
+ * Parametri:
+ *      ring: il ring in cui inserire
+ *      fd: il file descriptor da inserire
+ *      close: l'indicazione sulla chiusura della connessione
+ *      data: i dati da associare all'elemento, può essere NULL
+ * Errno:
+ *      EAGAIN: se il ring è pieno
+ * Ritorna: 0 in caso di successo, -1 in caso di errore
+ */
+int ring_push(fd_ring *ring, int fd, int close, void *data);
+
+/*
+ * Estrae fino a max elementi dal ring senza acquisire alcuna lock, può essere eseguita da più consumatori contemporaneamente
+ * Parametri:
+ *      ring: il ring da cui estrarre
+ *      els: l'array in cui memorizzare gli elementi estratti
+ *      max: il numero massimo di elementi da estrarre
+ *      wait: se 1 e il ring è vuoto il chiamante attende sul futex fino al prossimo inserimento, se 0 ritorna subito
+ * Errno:
+ *      ESHUTDOWN: se il ring è stato chiuso
+ * Ritorna: il numero di elementi estratti, 0 se wait == 0 e il ring è vuoto, -1 in caso di errore
+ */
+int ring_pop(fd_ring *ring, ring_el *els, int max, int wait);
+
+/*
+ * Chiude il ring e risveglia tutti i consumatori in attesa, le estrazioni successive falliscono con ESHUTDOWN
+ * Parametri:
+ *      ring: il ring da chiudere
+ * Ritorna: none
+ */
+void ring_close(fd_ring *ring);
+
+/*
+ * Estrae un elemento dal ring se presente
+ * Parametri:
+ *      ring: il ring da cui estrarre
+ *      el: il puntatore in cui memorizzare l'elemento estratto
+ * Ritorna: 1 se un elemento è stato estratto, 0 se il ring è vuoto
+ */
+static int ring_try_pop(fd_ring *ring, ring_el *el);
+
+int init_ring(fd_ring *ring, long capacity) {
+    size_t size = 1;
+    size_t i;
+
+    if(ring == NULL || capacity <= 0) {
+        errno = EINVAL;
+
+        return -1;
+    }
+
+    while(size < (size_t)capacity) {
+        size <<= 1;
+    }
+
+    if((ring->cells = malloc(size * sizeof(ring_cell))) == NULL) {
+        errno = ENOMEM;
+
+        return -1;
+    }
+
+    // Ogni cella parte con il numero di sequenza della prima posizione che la utilizza, quindi è libera per il primo inserimento
+    for(i = 0; i < size; i++) {
+        atomic_init(&ring->cells[i].seq, i);
+    }
+
+    ring->mask = size - 1;
+
+    atomic_init(&ring->enqueue_pos, 0);
+    atomic_init(&ring->dequeue_pos, 0);
+    atomic_init(&ring->futex, 0);
+    atomic_init(&ring->waiters, 0);
+    atomic_init(&ring->closed, 0);
+
+    return 0;
+}
+
+void free_ring(fd_ring *ring) {
+    free(ring->cells);
+}
+
+int ring_push(fd_ring *ring, int fd, int close, void *data) {
+    ring_cell *cell;
+
+    size_t pos = atomic_load_explicit(&ring->enqueue_pos, memory_order_relaxed);
+    size_t seq;
+
+    while(1) {
+        cell = &ring->cells[pos & ring->mask];
+        seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+
+        if(seq == pos) {
+            // La cella è libera, la posizione viene prenotata solo se nessun altro produttore l'ha già presa
+            if(atomic_compare_exchange_weak_explicit(&ring->enqueue_pos, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if((long)(seq - pos) < 0) {
+            // La cella contiene ancora l'elemento del giro precedente, il ring è pieno
+            errno = EAGAIN;
+
+            return -1;
+        } else {
+            // Un altro produttore ha già preso la posizione
+            pos = atomic_load_explicit(&ring->enqueue_pos, memory_order_relaxed);
+        }
+    }
+
+    cell->el.fd = fd;
+    cell->el.close = close;
+    cell->el.data = data;
+
+    // L'elemento diventa visibile ai consumatori solo dopo essere stato scritto per intero
+    atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+
+    // L'incremento del contatore precede la lettura di waiters, quindi un consumatore che si è appena messo in attesa trova il futex modificato oppure l'elemento
+    atomic_fetch_add_explicit(&ring->futex, 1, memory_order_seq_cst);
+
+    if(atomic_load_explicit(&ring->waiters, memory_order_seq_cst) > 0) {
+        syscall(SYS_futex, &ring->futex, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+    }
+
+    return 0;
+}
+
+int ring_pop(fd_ring *ring, ring_el *els, int max, int wait) {
+    int n = 0;
+    int key;
+
+    while(1) {
+        if(n == 0 && atomic_load_explicit(&ring->closed, memory_order_acquire)) {
+            errno = ESHUTDOWN;
+
+            return -1;
+        }
+
+        while(n < max && ring_try_pop(ring, &els[n])) {
+            n++;
+        }
+
+        if(n > 0 || !wait) {
+            return n;
+        }
+
+        // Il ring è vuoto, il consumatore si registra come in attesa e verifica di nuovo prima di addormentarsi
+        key = atomic_load_explicit(&ring->futex, memory_order_seq_cst);
+        atomic_fetch_add_explicit(&ring->waiters, 1, memory_order_seq_cst);
+
+        if(ring_try_pop(ring, &els[n])) {
+            n++;
+        } else if(!atomic_load_explicit(&ring->closed, memory_order_acquire)) {
+            // Se il contatore è cambiato dopo la lettura di key la futex ritorna subito
+            syscall(SYS_futex, &ring->futex, FUTEX_WAIT_PRIVATE, key, NULL, NULL, 0);
+        }
+
+        atomic_fetch_sub_explicit(&ring->waiters, 1, memory_order_relaxed);
+    }
+}
+
+void ring_close(fd_ring *ring) {
+    atomic_store_explicit(&ring->closed, 1, memory_order_release);
+
+    atomic_fetch_add_explicit(&ring->futex, 1, memory_order_seq_cst);
+    syscall(SYS_futex, &ring->futex, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+
+static int ring_try_pop(fd_ring *ring, ring_el *el) {
+    ring_cell *cell;
+
+    size_t pos = atomic_load_explicit(&ring->dequeue_pos, memory_order_relaxed);
+    size_t seq;
+
+    while(1) {
+        cell = &ring->cells[pos & ring->mask];
+        seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+
+        if(seq == pos + 1) {
+            // La cella contiene un elemento, la posizione viene presa solo se nessun altro consumatore l'ha già presa
+            if(atomic_compare_exchange_weak_explicit(&ring->dequeue_pos, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if((long)(seq - (pos + 1)) < 0) {
+            // La cella non è ancora stata scritta, il ring è vuoto
+            return 0;
+        } else {
+            // Un altro consumatore ha già preso la posizione
+            pos = atomic_load_explicit(&ring->dequeue_pos, memory_order_relaxed);
+        }
+    }
+
+    *el = cell->el;
+
+    // La cella viene restituita ai produttori per il giro successivo
+    atomic_store_explicit(&cell->seq, pos + ring->mask + 1, memory_order_release);
+
+    return 1;
+}
+
+#endif
@@ -1,272 +1,396 @@
+#ifndef HT_MANAGER_H
+#define HT_MANAGER_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "data_manager.h"
+#include "open_set.h"
+
 #define UNIX_PATH_MAX 108
+#define HT_GROUP_WIDTH 16                   // Numero di celle il cui tag viene confrontato in una sola volta, 16 byte con SSE2
+#define HT_MIN_SIZE 16                      // Numero minimo di celle di una hash table, deve essere una potenza di 2 multipla di HT_GROUP_WIDTH
+#define HT_MAX_LOAD 8                       // La hash table viene ricostruita quando resta libera meno di una cella ogni HT_MAX_LOAD
+#define HT_MIN_LOAD 8                       // La hash table viene ridotta quando contiene meno di un file ogni HT_MIN_LOAD celle
+#define HT_REHASH_STEP 4                    // Numero di gruppi migrati ad ogni inserimento o rimozione durante il rehash
+
+#define HT_CTRL_EMPTY ((int8_t)-128)        // Tag di una cella mai occupata, interrompe la ricerca
+#define HT_CTRL_DELETED ((int8_t)-2)        // Tag di una cella liberata, la ricerca prosegue oltre
 
 struct metadata {
     char filename[UNIX_PATH_MAX];           // Filename usato come identificatore per il file
     int size;                               // Dimensione in byte del file
-    long long int last_used;                // Ultimo utilizzo del file specificato in nanosecondi a partire da epoch
+    long charged;                           // Byte addebitati allo storage per il file, la memoria occupata dai blocchi del contenuto
+    atomic_llong last_used;                 // Ultimo utilizzo del file specificato in nanosecondi a partire da epoch, aggiornato anche dai lettori senza lock esclusiva
+    long long int lru_stamp;                // Valore di last_used quando il file è stato spostato in coda alla lista LRU
     int acquired_by;                        // File descriptor del socket che possiede la lock sul file
     int lock_type;                          // 1 se il file è locked a seguito di una open con lock flag, 0 se il file è locked per richiesta del client se acquired_by è uguale a -1 questo valore non deve essere considerato 
-    int *opened;                            // Array che contiene i file descriptor dei socket che hanno aperto il file
-    int index;                              // Indice della hash table in cui è memorizzato il file
-    struct f_el *next_file;                 // File successivo contenuto nella stessa cella della hash table
-    struct f_el *prev_file;                 // File precedente contenuto nella stessa cella della hash table
+    uint64_t hash;                          // Hash del filename, calcolato una sola volta con hash_filename
+    int shard;                              // Indice della partizione dello storage che contiene il file
+    struct f_el *lru_next;                  // File usato più di recente rispetto a questo nella lista LRU
+    struct f_el *lru_prev;                  // File usato meno di recente rispetto a questo nella lista LRU
+    struct open_set owners;                 // Insieme delle connessioni che hanno aperto il file o ne possiedono la lock, indicizzato per descrittore
 };
 
 struct f_el {
     struct metadata metadata;               // Contiene i metadati necessari per la gestione dei file
-    char *data;                             // Contiene i dati del file
+    f_data *data;                           // Contiene i dati del file, NULL se il file è vuoto
+};
+
+struct lru_list {
+    struct f_el *head;                      // File usato meno di recente, primo candidato all'espulsione
+    struct f_el *tail;                      // File usato più di recente
+};
+
+struct ht_table {
+    int8_t *ctrl;                           // Un byte per cella: i 7 bit bassi dell'hash se la cella è piena, HT_CTRL_EMPTY o HT_CTRL_DELETED altrimenti
+    struct f_el **slots;                    // Il file contenuto in ogni cella, NULL se la cella non è piena
+    size_t size;                            // Numero di celle, potenza di 2 multipla di HT_GROUP_WIDTH
+    size_t used;                            // Numero di celle piene o cancellate, determina quando la tabella deve essere ricostruita
+};
+
+struct hash_table {
+    struct ht_table table;                  // La tabella in cui sono inseriti i nuovi file
+    struct ht_table old;                    // La tabella precedente durante un rehash, ctrl è NULL se nessun rehash è in corso
+    size_t rehash_index;                    // I gruppi di old con indice minore sono già stati migrati
+    size_t count;                           // Numero di file contenuti nella hash table, incluse entrambe le tabelle
+    struct slab_arena *arena;               // L'arena da cui sono allocati i file e i loro contenuti
+};
+
+struct ht_iter {
+    struct hash_table *ht;                  // La hash table visitata
+    int old;                                // 1 se l'iteratore sta visitando la tabella precedente
+    size_t index;                           // La prossima cella da visitare
 };
 
 typedef struct metadata metadata;
 typedef struct f_el f_el;
+typedef struct lru_list lru_list;
+typedef struct ht_table ht_table;
+typedef struct hash_table hash_table;
+typedef struct ht_iter ht_iter;
 
 /*
- * Calcola la dimensione della lista puntata da una cella della hash table
+ * Inizializza una hash table vuota
  * Parametri:
- *      list: il puntatore alla testa della lista
- * Ritorna: la dimensione della lista
+ *      ht: la hash table da inizializzare
+ *      size: il numero di file che la tabella deve poter contenere senza essere ricostruita
+ *      arena: l'arena a cui restituire i file rimossi dalla tabella
+ * Errno:
+ *      EINVAL: se ht == NULL
+ *      ENOMEM: se non è possibile allocare la tabella
+ * Ritorna: 0 in caso di successo, -1 in caso di errore
  */
-int list_size(f_el *list);
+int init_ht(hash_table *ht, size_t size, slab_arena *arena);
 
 /*
- * Inserisce un nuovo file nella hash table
+ * Calcola l'hash a 64 bit di un filename, calcolato una sola volta per richiesta e memorizzato nei metadati del file
+ * I 7 bit bassi formano il tag della cella, i bit successivi selezionano il primo gruppo da esaminare, i bit alti la partizione dello storage
  * Parametri:
- *      ht: l'array che rappresenta l'hash table
- *      size: la dimensione dell'array che rappresenta la hash table
+ *      filename: il filename su cui applicare la funzione hash
+ * Ritorna: l'hash del filename
+ */
+uint64_t hash_filename(const char *filename);
+
+/*
+ * Inserisce un nuovo file nella hash table, il campo hash dei metadati deve essere già impostato
+ * Se le celle libere scendono sotto la soglia HT_MAX_LOAD avvia la ricostruzione della tabella, che prosegue in modo incrementale con gli inserimenti e le rimozioni successive
+ * Parametri:
+ *      ht: la hash table
  *      n_file: il puntatore al nuovo file da inserire nella hash table
  * Errno:
  *      EINVAL: se ht oppure n_file sono uguali a NULL
  *      EEXIST: se esiste già un file t.c file->metadata.filename == n_file->metadata.filename
+ *      ENOMEM: se la tabella è piena e non è possibile allocarne una più grande
  * Ritorna: 0 in caso di successo, -1 in caso di errore
  */
-int insert(f_el **ht, size_t size, f_el *n_file);
+int insert(hash_table *ht, f_el *n_file);
 
 /*
- * Cerca un file nella lista t.c. list->metadata.filename == filename
+ * Cerca un file nella hash table per filename, solo le celle il cui tag coincide con l'hash accedono al file
+ * Non modifica la hash table, quindi può essere eseguita possedendo la partizione in modo condiviso
  * Parametri:
- *      list: il puntatore alla testa della lista
+ *      ht: la hash table
  *      filename: il filename del file da cercare
- * Ritorna: il puntatore al file di interesse, NULL se il file non è presente nella lista
+ *      hash: l'hash del filename, calcolato con hash_filename
+ * Errno:
+ *      EINVAL: se ht oppure filename sono uguali a NULL
+ *      ENOENT: se il file non è presente nella hash table
+ * Ritorna: il puntatore al file di interesse, NULL se il file non è presente nella hash table
  */
-f_el *list_lookup(f_el *list, char *filename);
+f_el *lookup(hash_table *ht, const char *filename, uint64_t hash);
 
 /*
- * Cerca un file nella hash table per filename
+ * Rimuove un file dalla hash table e lo dealloca
+ * Se il fattore di carico scende sotto HT_MIN_LOAD avvia la riduzione della tabella, che prosegue in modo incrementale
  * Parametri:
- *      ht: l'array che rappresenta l'hash table
- *      size: la dimensione dell'array che rappresenta la hash table
- *      filename: il filename del file da cercare
+ *      ht: la hash table
+ *      victim: il file da rimuovere
  * Errno:
- *      EINVAL: se ht oppure filename sono uguali a NULL
+ *      EINVAL: se ht oppure victim sono uguali a NULL
  *      ENOENT: se il file non è presente nella hash table
- * Ritorna: il puntatore al file di interesse, NULL se il file non è presente nella hash table
+ * Ritorna: 0 in caso di successo, -1 in caso di errore
  */
-f_el *lookup(f_el **ht, size_t size, char *filename);
+int delete(hash_table *ht, f_el *victim);
 
 /*
- * Rimuove il file nella hash table con filename uguale a quello specificato come parametro
+ * Rimuove un file dalla hash table senza deallocarlo, il file e il suo contenuto passano al chiamante
+ * Se il fattore di carico scende sotto HT_MIN_LOAD avvia la riduzione della tabella, che prosegue in modo incrementale
  * Parametri:
- *      ht: l'array che rappresenta l'hash table
- *      size: la dimensione dell'array che rappresenta la hash table
- *      filename: il filename del file da cercare
+ *      ht: la hash table
+ *      victim: il file da rimuovere
  * Errno:
- *      EINVAL: se ht oppure filename sono uguali a NULL
- *      ENOENT: se non esiste un file con filename uguale a quello specificato come parametro
+ *      EINVAL: se ht oppure victim sono uguali a NULL
+ *      ENOENT: se il file non è presente nella hash table
  * Ritorna: 0 in caso di successo, -1 in caso di errore
  */
-int delete(f_el **ht, size_t size, f_el *victim);
+int detach(hash_table *ht, f_el *victim);
 
 /*
- * Calcola il primo indice in cui inserire o ricercare il file
+ * Alloca le celle di una tabella, tutte vuote
  * Parametri:
- *      filename: il filename su cui applicare la funzione hash
- *      size: la dimensione dell'array che rappresenta la hash table
- * Ritorna: l'indice in cui inserire o cercare il file
+ *      table: la tabella da allocare
+ *      size: il numero di celle, potenza di 2 multipla di HT_GROUP_WIDTH
+ * Errno:
+ *      ENOMEM: se non è possibile allocare le celle
+ * Ritorna: 0 in caso di successo, -1 in caso di errore
  */
-int hash1(const char *filename, size_t size);
+static int ht_table_alloc(ht_table *table, size_t size);
 
 /*
- * Calcola il secondo indice in cui inserire o ricercare il file
+ * Confronta in una sola volta i tag delle HT_GROUP_WIDTH celle di un gruppo con il tag specificato, con SSE2 se disponibile
  * Parametri:
- *      filename: il filename su cui applicare la funzione hash
- *      size: la dimensione dell'array che rappresenta la hash table
- * Ritorna: l'indice in cui inserire o cercare il file
+ *      group: il primo byte di controllo del gruppo, allineato a HT_GROUP_WIDTH
+ *      tag: il tag da cercare
+ * Ritorna: una maschera con il bit i impostato se la cella i del gruppo ha il tag specificato
+ */
+static uint32_t ht_group_match(const int8_t *group, int8_t tag);
+
+/*
+ * Individua le celle vuote o cancellate di un gruppo, cioè quelle il cui byte di controllo ha il bit alto impostato
+ * Parametri:
+ *      group: il primo byte di controllo del gruppo, allineato a HT_GROUP_WIDTH
+ * Ritorna: una maschera con il bit i impostato se la cella i del gruppo può ricevere un file
  */
-int hash2(const char* filename, size_t size);
+static uint32_t ht_group_match_free(const int8_t *group);
 
 /*
- * Seleziona un file vittima da rimuovere nel caso di raggiungimento della dimensione massima dello storage, usa una politica LRU
+ * Cerca un file in una tabella, esaminando i gruppi in ordine di sondaggio fino al primo gruppo che contiene una cella vuota
  * Parametri:
- *      ht: l'array che rappresenta l'hash table
- *      size: la dimensione dell'array che rappresenta la hash table
- *      exonerated: il filename di un file esonerato dalla possibile espulsione, necessario nel caso di write in cui lo stesso file in cui scrivere potrebbe essere espulso
- * Ritorna: il puntatore al file scelto come vittima, NULL se lo storage è vuoto
+ *      table: la tabella
+ *      filename: il filename del file da cercare
+ *      hash: l'hash del filename
+ * Ritorna: l'indice della cella che contiene il file, -1 se il file non è presente nella tabella
+ */
+static long ht_table_find(ht_table *table, const char *filename, uint64_t hash);
+
+/*
+ * Inserisce un file nella prima cella vuota o cancellata del suo ordine di sondaggio, senza verificare la presenza di duplicati
+ * Parametri:
+ *      table: la tabella, deve contenere almeno una cella non piena
+ *      file: il file da inserire
+ * Ritorna: none
  */
-f_el *select_victim(f_el **ht, size_t size, char *exonerated);
+static void ht_table_place(ht_table *table, f_el *file);
 
 /*
- * Dealloca la memoria degli elementi presenti nella lista
+ * Libera una cella, che diventa vuota se il suo gruppo contiene già una cella vuota e quindi nessuna ricerca lo ha superato, cancellata altrimenti
  * Parametri:
- *      list: la lista di cui deallocare gli elementi
+ *      table: la tabella
+ *      index: l'indice della cella da liberare
  * Ritorna: none
  */
-void free_list(f_el* list);
+static void ht_table_erase(ht_table *table, size_t index);
 
 /*
- * Dealloca la memoria degli elementi presenti nella hash table
+ * Sposta nella nuova tabella i file contenuti in fino a steps gruppi della vecchia tabella, al termine del rehash dealloca la vecchia tabella
  * Parametri:
- *      list: la lista di cui deallocare gli elementi
+ *      ht: la hash table
+ *      steps: il numero massimo di gruppi da migrare
+ * Ritorna: none
+ */
+static void ht_rehash_step(hash_table *ht, size_t steps);
+
+/*
+ * Avvia la ricostruzione della hash table con un numero di celle pari almeno al doppio dei file contenuti, un eventuale rehash in corso viene prima completato
+ * Parametri:
+ *      ht: la hash table
  * Errno:
- *      EINVAL: se ht è NULL oppure se size < 0
- *      
- * Ritorna: 0 in caso di successo, -1 altrimenti
+ *      ENOMEM: se non è possibile allocare la nuova tabella, la hash table resta invariata
+ * Ritorna: 0 in caso di successo, -1 in caso di errore
  */
-int free_ht(f_el** ht, size_t size);
+static int ht_resize(hash_table *ht);
 
 /*
- * Visualizza sullo standard output il filename degli elementi nella lista
+ * Inizializza un iteratore su tutti i file della hash table, non modifica la hash table
  * Parametri:
- *      list: la lista di cui visualizzare gli elementi
+ *      it: l'iteratore da inizializzare
+ *      ht: la hash table da visitare
+ * Ritorna: none
  */
-void print_list(f_el *list);
+void ht_iter_init(ht_iter *it, hash_table *ht);
 
 /*
- * Visualizza sullo standard output il filename degli elementi nella hash table
+ * Restituisce il file successivo dell'iterazione
  * Parametri:
- *      ht: l'array che rappresenta l'hash table
- *      size: la dimensione dell'array che rappresenta la hash table
+ *      it: l'iteratore
+ * Ritorna: il file successivo, NULL se tutti i file sono stati visitati
  */
-void print_ht(f_el **ht, size_t size);
+f_el *ht_iter_next(ht_iter *it);
 
-/* Ripristina lock e file aperti dal client identificato da socket_fd, per i file contenuti nella lista
+/*
+ * Verifica se un file è contenuto nella lista LRU
  * Parametri:
- *      list: la lista di file da ripristinare
- *      socket_fd: il descrittore su cui basare il ripristino
- *      max: il numero massimo di connessioni contemporaneamente attive
+ *      lru: la lista LRU
+ *      file: il file su cui eseguire la verifica
+ * Ritorna: 1 se il file è contenuto nella lista, 0 altrimenti
  */
-void clean_list(f_el *list, int socket_fd, int max);
+int lru_contains(lru_list *lru, f_el *file);
 
-/* Ripristina lock e file aperti dal client identificato da socket_fd , per i file contenuti nella hash table
+/*
+ * Inserisce un file in coda alla lista LRU, come file usato più di recente
  * Parametri:
- *      ht: la hash table che contiene i file da ripristinare
- *      size: la dimensione dell'array che modella la hash table
- *      socket_fd: il descrittore su cui basare il ripristino
- *      max: il numero massimo di connessioni contemporaneamente attive
+ *      lru: la lista LRU
+ *      file: il file da inserire, non deve essere già contenuto nella lista
+ * Ritorna: none
  */
-void clean_ht(f_el **ht, int size, int socket_fd, int max);
+void lru_append(lru_list *lru, f_el *file);
 
-int list_size(f_el *list) {
-    if(list == NULL) {
-        return 0;
-    }
+/*
+ * Rimuove un file dalla lista LRU, se il file non è contenuto nella lista non esegue alcuna operazione
+ * Parametri:
+ *      lru: la lista LRU
+ *      file: il file da rimuovere
+ * Ritorna: none
+ */
+void lru_remove(lru_list *lru, f_el *file);
 
-    return list_size(list->metadata.next_file) + 1;
-}
+/*
+ * Sposta un file in coda alla lista LRU, inserendolo nel caso in cui non fosse già contenuto, il costo è O(1)
+ * Parametri:
+ *      lru: la lista LRU
+ *      file: il file usato
+ * Ritorna: none
+ */
+void lru_touch(lru_list *lru, f_el *file);
 
-int insert(f_el **ht, size_t size, f_el *n_file) {
-    f_el *iterator;
+/*
+ * Seleziona un file vittima da rimuovere nel caso di raggiungimento della dimensione massima dello storage, usa una politica LRU con seconda possibilità
+ * Le letture aggiornano solo last_used senza spostare il file, quindi i file usati dopo il loro ultimo spostamento sono riportati in coda prima di scegliere la vittima
+ * Deve essere eseguita possedendo in modo esclusivo la partizione che contiene la lista, il costo ammortizzato è O(1)
+ * Parametri:
+ *      lru: la lista LRU dei file dello storage
+ *      exonerated: un file esonerato dalla possibile espulsione, necessario nel caso di write in cui lo stesso file in cui scrivere potrebbe essere espulso
+ * Ritorna: il puntatore al file scelto come vittima, NULL se non esiste alcun file che può essere espulso
+ */
+f_el *select_victim(lru_list *lru, f_el *exonerated);
 
-    int index;
-    int index1;
-    int index2;
+/*
+ * Dealloca la memoria degli elementi presenti nella hash table e le sue celle
+ * Parametri:
+ *      ht: la hash table da deallocare
+ * Errno:
+ *      EINVAL: se ht è NULL
+ *      
+ * Ritorna: 0 in caso di successo, -1 altrimenti
+ */
+int free_ht(hash_table *ht);
 
-    if(ht == NULL || n_file == NULL) {
+/*
+ * Visualizza sullo standard output il filename degli elementi nella hash table
+ * Parametri:
+ *      ht: la hash table
+ */
+void print_ht(hash_table *ht);
+
+int init_ht(hash_table *ht, size_t size, slab_arena *arena) {
+    size_t n_size = HT_MIN_SIZE;
+
+    if(ht == NULL) {
         errno = EINVAL;
 
         return -1;
     }
 
-    if(lookup(ht, size, n_file->metadata.filename) != NULL) {
-        errno = EEXIST;
+    while(n_size - n_size / HT_MAX_LOAD < size) {
+        n_size <<= 1;
+    }
 
+    if(ht_table_alloc(&ht->table, n_size) == -1) {
         return -1;
     }
 
-    // Necessario perchè lookup imposta errno a ENOENT 
-    errno = 0;
+    ht->old.ctrl = NULL;
+    ht->old.slots = NULL;
+    ht->old.size = 0;
+    ht->old.used = 0;
+    ht->rehash_index = 0;
+    ht->count = 0;
+    ht->arena = arena;
 
-    index1 = hash1(n_file->metadata.filename, size);
+    return 0;
+}
 
-    if(ht[index1] == NULL) {
-        // Non è avvenuta una collisione 
-        ht[index1] = n_file;
+uint64_t hash_filename(const char *filename) {
+    uint64_t hash = 14695981039346656037ULL;
+    const unsigned char *c;
 
-        n_file->metadata.index = index1;
+    // FNV-1a, calcolato in un solo passaggio sul filename
+    for(c = (const unsigned char *)filename; *c != '\0'; c++) {
+        hash ^= *c;
+        hash *= 1099511628211ULL;
+    }
 
-    } else {
-        // È avvenuta una collisione con il primo index prova con il secondo
-        index2 = hash2(n_file->metadata.filename, size);
-
-        if(ht[index2] == NULL) {
-            // Non è avvenuta una collisione 
-            ht[index2] = n_file;
-
-            n_file->metadata.index = index2;
-        } else {
-            // Sceglie la lista di dimensione inferiore in cui inserire il file
-            if(list_size(ht[index1]) > list_size(ht[index1])) {
-                index = index2;
-            } else {
-                index = index1;
-            }
+    // Rimescola i bit in modo che sia i bit bassi che quelli alti dipendano da tutto il filename
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
 
-            // È avvenuta una collisione si aggiunge l'elemento nella linked list
-            iterator = ht[index];
+    return hash;
+}
 
-            while(iterator->metadata.next_file != NULL && strcmp(iterator->metadata.filename, n_file->metadata.filename) < 0) {
-                iterator = iterator->metadata.next_file;
-            }
+int insert(hash_table *ht, f_el *n_file) {
+    if(ht == NULL || n_file == NULL) {
+        errno = EINVAL;
 
-            if(iterator->metadata.next_file == NULL && strcmp(iterator->metadata.filename, n_file->metadata.filename) < 0) {
-                // Il file deve essere aggiunto in coda
-                iterator->metadata.next_file = n_file;
+        return -1;
+    }
 
-                n_file->metadata.prev_file = iterator;
-                n_file->metadata.next_file = NULL;
-            } else if(iterator->metadata.prev_file == NULL && strcmp(iterator->metadata.filename, n_file->metadata.filename) > 0){
-                // Il file deve essere aggiunto in testa
-                ht[index] = n_file;
+    if(lookup(ht, n_file->metadata.filename, n_file->metadata.hash) != NULL) {
+        errno = EEXIST;
 
-                n_file->metadata.prev_file = NULL;
-                n_file->metadata.next_file = iterator;
+        return -1;
+    }
 
-                iterator->metadata.prev_file = n_file;
-            } else {
-                // Il file deve essere aggiunto in mezzo
-                n_file->metadata.prev_file = iterator->metadata.prev_file;
-                n_file->metadata.prev_file->metadata.next_file = n_file;
+    // Necessario perchè lookup imposta errno a ENOENT 
+    errno = 0;
 
-                n_file->metadata.next_file = iterator;
-                iterator->metadata.prev_file = n_file;
-            }
+    ht_rehash_step(ht, HT_REHASH_STEP);
 
-            n_file->metadata.index = index;
+    if(ht->table.used >= ht->table.size - ht->table.size / HT_MAX_LOAD) {
+        // Se la nuova tabella non può essere allocata l'inserimento prosegue finché resta una cella libera
+        if(ht_resize(ht) == -1 && ht->table.used == ht->table.size) {
+            return -1;
         }
-    }
-
-    return 0;
-}
 
-f_el *list_lookup(f_el *list, char *filename) {
-    // Verifica se la lista è vuota oppure se è stata raggiunta la fine della lista
-    if(list == NULL) {
-        // Il file non è presente nella lista
-        return NULL;
+        errno = 0;
     }
 
-    if(strcmp(list->metadata.filename, filename) == 0) {
-        // Il file è stato trovato
-        return list;
-    }
+    ht_table_place(&ht->table, n_file);
 
-    return list_lookup(list->metadata.next_file, filename);
-}
+    ht->count++;
 
-f_el *lookup(f_el **ht, size_t size, char *filename) {
-    f_el *result;
+    return 0;
+}
 
-    int index1 = -1;
-    int index2 = -1;
+f_el *lookup(hash_table *ht, const char *filename, uint64_t hash) {
+    long index;
 
     if(ht == NULL || filename == NULL) {
         errno = EINVAL;
@@ -274,226 +398,423 @@ f_el *lookup(f_el **ht, size_t size, char *filename) {
         return NULL;
     }
 
-    index1 = hash1(filename, size);
-
-    if(index1 == -1) {
-        printf("Errore nel calcolo hash 1\n");
+    if((index = ht_table_find(&ht->table, filename, hash)) != -1) {
+        return ht->table.slots[index];
+    }
 
-        return NULL;
+    // Durante il rehash i file non ancora migrati si trovano nella vecchia tabella
+    if(ht->old.ctrl != NULL && (index = ht_table_find(&ht->old, filename, hash)) != -1) {
+        return ht->old.slots[index];
     }
 
-    if(ht[index1] == NULL || (result = list_lookup(ht[index1], filename)) == NULL) {
-        // Nel primo indice non è presente alcun file oppure il file non è presente nella lista, verifica con il secondo indice
+    errno = ENOENT;
 
-        index2 = hash2(filename, size);
+    return NULL;
+}
 
-        if(index2 == -1) {
-            printf("Errore nel calcolo hash 2\n");
+int delete(hash_table *ht, f_el *victim) {
+    if(detach(ht, victim) == -1) {
+        return -1;
+    }
 
-            return NULL;
-        }
+    open_set_free(&victim->metadata.owners);
 
-        if(ht[index2] == NULL || (result = list_lookup(ht[index2], filename)) == NULL) {
-            // Nel secondo indice non è presente alcun file, quindi il file non è presente nell'hash table
+    data_release(ht->arena, victim->data);
 
-            errno = ENOENT;
+    slab_free(ht->arena, victim, sizeof(f_el));
 
-            return NULL;
-        }
-    }
+    return 0;
+}
 
-    // Il file è stato trovato
+int detach(hash_table *ht, f_el *victim) {
+    ht_table *table;
 
-    return result;
-}
+    long index;
 
-int delete(f_el **ht, size_t size, f_el *victim) {
     if(ht == NULL || victim == NULL) {
         errno = EINVAL;
 
         return -1;
     }
 
+    table = &ht->table;
+
     // Verifica se il file è presente nella hash table
-    if(lookup(ht, size, victim->metadata.filename) == NULL) {
+    if((index = ht_table_find(table, victim->metadata.filename, victim->metadata.hash)) == -1 && ht->old.ctrl != NULL) {
+        table = &ht->old;
+        index = ht_table_find(table, victim->metadata.filename, victim->metadata.hash);
+    }
+
+    if(index == -1 || table->slots[index] != victim) {
         errno = ENOENT;
 
         return -1;
     }
 
-    if(victim->metadata.next_file == NULL && victim->metadata.prev_file != NULL){
-        // Deve essere eliminata la coda della lista
+    ht_table_erase(table, index);
 
-        victim->metadata.prev_file->metadata.next_file = NULL;
-    } else if(victim->metadata.prev_file == NULL) {
-        // Deve essere eliminata la testa della lista
+    ht->count--;
 
-        ht[victim->metadata.index] = victim->metadata.next_file;
+    ht_rehash_step(ht, HT_REHASH_STEP);
 
-        if(victim->metadata.next_file != NULL) {
-            victim->metadata.next_file->metadata.prev_file = NULL;
-        }
-    } else {
-        // Deve essere eliminato un nodo intermedio della lista
+    if(ht->table.size > HT_MIN_SIZE && ht->count < ht->table.size / HT_MIN_LOAD) {
+        // Se la nuova tabella non può essere allocata la tabella corrente resta valida
+        ht_resize(ht);
+    }
+
+    return 0;
+}
 
-        victim->metadata.prev_file->metadata.next_file = victim->metadata.next_file;
-        victim->metadata.next_file->metadata.prev_file = victim->metadata.prev_file;
+static int ht_table_alloc(ht_table *table, size_t size) {
+    size_t i;
+
+    // I byte di controllo sono allineati in modo che ogni gruppo sia letto con un solo accesso allineato
+    if((table->ctrl = aligned_alloc(HT_GROUP_WIDTH, size)) == NULL) {
+        errno = ENOMEM;
+
+        return -1;
     }
 
-    free(victim->metadata.opened);
+    if((table->slots = malloc(size * sizeof(f_el *))) == NULL) {
+        free(table->ctrl);
+
+        errno = ENOMEM;
 
-    if(victim->data != NULL) {
-        free(victim->data);
+        return -1;
+    }
+
+    for(i = 0; i < size; i++) {
+        table->ctrl[i] = HT_CTRL_EMPTY;
+        table->slots[i] = NULL;
     }
 
-    free(victim);
+    table->size = size;
+    table->used = 0;
 
     return 0;
 }
 
-int hash1(const char *filename, size_t size) {
-    const int p = 31, m = 1e9 + 7;
-    int index = 0;
-    long p_pow = 1;
+static uint32_t ht_group_match(const int8_t *group, int8_t tag) {
+#ifdef __SSE2__
+    __m128i ctrl = _mm_load_si128((const __m128i *)group);
+
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(tag)));
+#else
+    uint32_t mask = 0;
+
     int i;
 
-    for(i = 0; i < strlen(filename); i++) {
-        index = (index + (filename[i] - 'a' + 1) * p_pow) % m;
-        p_pow = (p_pow * p) % m;
+    for(i = 0; i < HT_GROUP_WIDTH; i++) {
+        if(group[i] == tag) {
+            mask |= 1u << i;
+        }
     }
 
-    return index % size;
+    return mask;
+#endif
 }
 
-int hash2(const char *filename, size_t size) {
-    const int p = 37, m = 1e9 + 9;
-    int index = 0;
-    long p_pow = 1;
+static uint32_t ht_group_match_free(const int8_t *group) {
+#ifdef __SSE2__
+    // movemask raccoglie proprio il bit alto di ogni byte
+    return (uint32_t)_mm_movemask_epi8(_mm_load_si128((const __m128i *)group));
+#else
+    uint32_t mask = 0;
+
     int i;
 
-    for(i = 0; i < strlen(filename); i++) {
-        index = (index + (filename[i] - 'a' + 1) * p_pow) % m;
-        p_pow = (p_pow * p) % m;
+    for(i = 0; i < HT_GROUP_WIDTH; i++) {
+        if(group[i] < 0) {
+            mask |= 1u << i;
+        }
     }
 
-    return index % size;
+    return mask;
+#endif
 }
 
-f_el *select_victim(f_el **ht, size_t size, char *exonerated) {
-    f_el *victim = NULL;
-    f_el *iterator;
-
-    int index;
+static long ht_table_find(ht_table *table, const char *filename, uint64_t hash) {
+    size_t group_mask = table->size / HT_GROUP_WIDTH - 1;
+    size_t group = (hash >> 7) & group_mask;
+    size_t probe;
+    size_t index;
 
-    // Verifica se è definito un file da ignorare
-    if(exonerated == NULL) {
-        exonerated = "";
-    }
+    int8_t tag = hash & 0x7f;
 
-    for(index = 0; index < size; index++) {
-        iterator = ht[index];
+    uint32_t match;
 
-        while(iterator != NULL) {
+    // Sondaggio quadratico sui gruppi, con un numero di gruppi potenza di 2 visita ogni gruppo una sola volta
+    for(probe = 1; probe <= group_mask + 1; probe++) {
+        match = ht_group_match(table->ctrl + group * HT_GROUP_WIDTH, tag);
 
-            if(strcmp(iterator->metadata.filename, exonerated) != 0 && iterator->metadata.size != 0) {
+        while(match != 0) {
+            index = group * HT_GROUP_WIDTH + __builtin_ctz(match);
 
-                // Verifica se il file puntato da iterator è stato usato meno di recente rispetto all'attuale vittima
-                if(victim == NULL || victim->metadata.last_used > iterator->metadata.last_used) {
-                    victim = iterator;
-                }
+            // Solo le celle con lo stesso tag accedono al file, l'hash completo è confrontato prima del filename
+            if(table->slots[index]->metadata.hash == hash && strcmp(table->slots[index]->metadata.filename, filename) == 0) {
+                return index;
             }
 
-            iterator = iterator->metadata.next_file;
+            match &= match - 1;
         }
+
+        if(ht_group_match(table->ctrl + group * HT_GROUP_WIDTH, HT_CTRL_EMPTY) != 0) {
+            // Un file con questo hash sarebbe stato inserito in questo gruppo
+            return -1;
+        }
+
+        group = (group + probe) & group_mask;
     }
 
-    return victim;
+    return -1;
 }
 
-void free_list(f_el* list) {
-    if(list == NULL) {
-        return;
+static void ht_table_place(ht_table *table, f_el *file) {
+    size_t group_mask = table->size / HT_GROUP_WIDTH - 1;
+    size_t group = (file->metadata.hash >> 7) & group_mask;
+    size_t probe;
+    size_t index;
+
+    uint32_t match;
+
+    for(probe = 1; (match = ht_group_match_free(table->ctrl + group * HT_GROUP_WIDTH)) == 0; probe++) {
+        group = (group + probe) & group_mask;
     }
 
-    free_list(list->metadata.next_file);
+    index = group * HT_GROUP_WIDTH + __builtin_ctz(match);
 
-    free(list->metadata.opened);
-    free(list->data);
-    free(list);
+    // Una cella cancellata era già conteggiata in used
+    if(table->ctrl[index] == HT_CTRL_EMPTY) {
+        table->used++;
+    }
 
+    table->ctrl[index] = file->metadata.hash & 0x7f;
+    table->slots[index] = file;
+}
 
-    return;
+static void ht_table_erase(ht_table *table, size_t index) {
+    size_t group = index & ~(size_t)(HT_GROUP_WIDTH - 1);
+
+    if(ht_group_match(table->ctrl + group, HT_CTRL_EMPTY) != 0) {
+        table->ctrl[index] = HT_CTRL_EMPTY;
+        table->used--;
+    } else {
+        table->ctrl[index] = HT_CTRL_DELETED;
+    }
+
+    table->slots[index] = NULL;
 }
 
-int free_ht(f_el** ht, size_t size) {
-    f_el *list;
+static void ht_rehash_step(hash_table *ht, size_t steps) {
+    size_t index;
+    size_t end;
 
-    int i;
+    while(ht->old.ctrl != NULL && steps > 0) {
+        end = (ht->rehash_index + 1) * HT_GROUP_WIDTH;
 
-    if(ht == NULL || size < 0) {
-        errno = EINVAL;
+        for(index = ht->rehash_index * HT_GROUP_WIDTH; index < end; index++) {
+            if(ht->old.ctrl[index] >= 0) {
+                ht_table_place(&ht->table, ht->old.slots[index]);
 
-        return -1;
+                // Il file migrato non deve più essere trovato nella vecchia tabella, ma le ricerche devono proseguire oltre la cella
+                ht->old.ctrl[index] = HT_CTRL_DELETED;
+                ht->old.slots[index] = NULL;
+            }
+        }
+
+        ht->rehash_index++;
+        steps--;
+
+        if(ht->rehash_index == ht->old.size / HT_GROUP_WIDTH) {
+            // Tutti i gruppi sono stati migrati
+            free(ht->old.ctrl);
+            free(ht->old.slots);
+
+            ht->old.ctrl = NULL;
+            ht->old.slots = NULL;
+            ht->old.size = 0;
+            ht->old.used = 0;
+            ht->rehash_index = 0;
+        }
     }
+}
 
-    for(i = 0; i < size; i++) {
-        list = ht[i];
+static int ht_resize(hash_table *ht) {
+    ht_table table;
 
-        free_list(list);
+    size_t size = HT_MIN_SIZE;
 
-        ht[i] = NULL;
+    // Un solo rehash può essere in corso, quello precedente viene completato
+    ht_rehash_step(ht, ht->old.size);
+
+    while(size < ht->count * 2) {
+        size <<= 1;
+    }
+
+    if(ht_table_alloc(&table, size) == -1) {
+        return -1;
     }
 
+    ht->old = ht->table;
+    ht->table = table;
+    ht->rehash_index = 0;
+
     return 0;
 }
 
-void print_list(f_el *list) {
-    if(list == NULL) {
-        printf("NULL\n");
+void ht_iter_init(ht_iter *it, hash_table *ht) {
+    it->ht = ht;
+    it->old = ht->old.ctrl != NULL;
+    it->index = 0;
+}
 
-        return;
+f_el *ht_iter_next(ht_iter *it) {
+    ht_table *table;
+
+    while(1) {
+        table = it->old ? &it->ht->old : &it->ht->table;
+
+        // I file già migrati hanno lasciato celle cancellate, quindi ogni file viene visitato una sola volta
+        while(it->index < table->size) {
+            if(table->ctrl[it->index++] >= 0) {
+                return table->slots[it->index - 1];
+            }
+        }
+
+        if(!it->old) {
+            return NULL;
+        }
+
+        it->old = 0;
+        it->index = 0;
     }
+}
+
+int lru_contains(lru_list *lru, f_el *file) {
+    return file->metadata.lru_prev != NULL || lru->head == file;
+}
+
+void lru_append(lru_list *lru, f_el *file) {
+    file->metadata.lru_stamp = atomic_load_explicit(&file->metadata.last_used, memory_order_relaxed);
+    file->metadata.lru_next = NULL;
+    file->metadata.lru_prev = lru->tail;
 
-    printf("%s -> ", list->metadata.filename);
+    if(lru->tail == NULL) {
+        // La lista è vuota
+        lru->head = file;
+    } else {
+        lru->tail->metadata.lru_next = file;
+    }
 
-    print_list(list->metadata.next_file);
+    lru->tail = file;
 }
 
-void print_ht(f_el **ht, size_t size) {
-    int i;
-    printf("\n");
-    for(i = 0; i < size; i++) {
-        if(ht[i] != NULL) {
-            printf("%d -> ", i);
+void lru_remove(lru_list *lru, f_el *file) {
+    if(!lru_contains(lru, file)) {
+        return;
+    }
 
-            print_list(ht[i]);
-        }
+    if(file->metadata.lru_prev == NULL) {
+        // Deve essere eliminata la testa della lista
+        lru->head = file->metadata.lru_next;
+    } else {
+        file->metadata.lru_prev->metadata.lru_next = file->metadata.lru_next;
     }
-    printf("\n");
+
+    if(file->metadata.lru_next == NULL) {
+        // Deve essere eliminata la coda della lista
+        lru->tail = file->metadata.lru_prev;
+    } else {
+        file->metadata.lru_next->metadata.lru_prev = file->metadata.lru_prev;
+    }
+
+    file->metadata.lru_next = NULL;
+    file->metadata.lru_prev = NULL;
 }
 
-void clean_list(f_el *list, int socket_fd, int max) {
-    int i;
+void lru_touch(lru_list *lru, f_el *file) {
+    if(lru->tail == file) {
+        // Il file è già il più recente
+        file->metadata.lru_stamp = atomic_load_explicit(&file->metadata.last_used, memory_order_relaxed);
 
-    if(list == NULL) {
         return;
     }
 
-    if(list->metadata.acquired_by == socket_fd) {
-        list->metadata.acquired_by = -1;
-    }
+    lru_remove(lru, file);
+    lru_append(lru, file);
+}
 
-    for(i = 0; i < max; i++) {
-        if(list->metadata.opened[i] == socket_fd) {
-            list->metadata.opened[i] = -1;
+f_el *select_victim(lru_list *lru, f_el *exonerated) {
+    f_el *victim = lru->head;
+    f_el *next;
+
+    while(victim != NULL) {
+        next = victim->metadata.lru_next;
+
+        if(victim != exonerated) {
+            if(victim->metadata.lru_stamp == atomic_load_explicit(&victim->metadata.last_used, memory_order_relaxed)) {
+                // Il file non è stato usato dopo l'ultimo spostamento nella lista
+                return victim;
+            }
+
+            // Il file è stato letto dopo l'ultimo spostamento, riceve una seconda possibilità
+            lru_touch(lru, victim);
+
+            if(next == NULL) {
+                // Il file era in coda, ora è aggiornato e può essere scelto
+                next = victim;
+            }
         }
+
+        victim = next;
     }
+
+    return NULL;
 }
 
-void clean_ht(f_el **ht, int size, int socket_fd, int max) {
-    int i;
+int free_ht(hash_table *ht) {
+    ht_iter it;
+    f_el *file;
 
-    for(i = 0; i < size; i++) {
-        clean_list(ht[i], socket_fd, max);
+    if(ht == NULL) {
+        errno = EINVAL;
+
+        return -1;
+    }
+
+    ht_iter_init(&it, ht);
+
+    while((file = ht_iter_next(&it)) != NULL) {
+        open_set_free(&file->metadata.owners);
+        data_release(ht->arena, file->data);
+        slab_free(ht->arena, file, sizeof(f_el));
     }
-}
\ No newline at end of file
+
+    free(ht->old.ctrl);
+    free(ht->old.slots);
+    free(ht->table.ctrl);
+    free(ht->table.slots);
+
+    ht->old.ctrl = NULL;
+    ht->table.ctrl = NULL;
+    ht->count = 0;
+
+    return 0;
+}
+
+void print_ht(hash_table *ht) {
+    ht_iter it;
+    f_el *file;
+
+    printf("\n");
+
+    ht_iter_init(&it, ht);
+
+    while((file = ht_iter_next(&it)) != NULL) {
+        printf("%s -> ", file->metadata.filename);
+    }
+
+    printf("NULL\n");
+}
+
+#endif
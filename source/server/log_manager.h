@@ -0,0 +1,307 @@
+#include <fcntl.h>
+#include <stdarg.h>
+#include <sched.h>
+#include <sys/uio.h>
+#include <stdatomic.h>
+
+#include "io_utils.h"
+
+#define LOG_RING_SIZE 65536                                 // Dimensione in byte del buffer circolare di ogni produttore, deve essere una potenza di 2
+#define LOG_FLUSH_THRESHOLD 16384                           // Byte in attesa in un buffer oltre i quali il thread di log viene risvegliato
+#define LOG_FLUSH_INTERVAL 100                              // Intervallo massimo in millisecondi tra due scritture sul file di log
+#define LOG_RECORD_MAX 512                                  // Dimensione massima in byte di un record di log
+#define LOG_IOV_MAX 1024                                    // Numero massimo di buffer passati ad una singola writev, pari al limite IOV_MAX di Linux
+
+struct log_ring {
+    char buffer[LOG_RING_SIZE];                             // Buffer circolare che contiene i record non ancora scritti sul file
+    atomic_size_t head;                                     // Posizione del primo byte non ancora scritto sul file, modificata solo dal thread di log
+    atomic_size_t tail;                                     // Posizione del primo byte libero, modificata solo dal produttore
+};
+
+struct logger {
+    int fd;                                                 // File descriptor del file di log, rimane aperto fino alla terminazione
+    struct log_ring *rings;                                 // Un buffer per ogni worker, l'ultimo è condiviso dai thread che non possiedono un buffer
+    int n_rings;                                            // Numero di buffer
+    struct iovec *iov;                                      // Vettore usato dal thread di log per scrivere i buffer con writev
+    size_t *flushed;                                        // Per ogni buffer, la posizione fino a cui arriva la scrittura in corso
+    pthread_mutex_t shared_lock;                            // Mutex che serializza i produttori del buffer condiviso
+    pthread_mutex_t lock;                                   // Mutex associata a cond
+    pthread_cond_t cond;                                    // Variabile di condizione su cui attende il thread di log
+    int stop;                                               // 1 se il thread di log deve terminare, protetto da lock
+    pthread_t thread;                                       // Il thread di log
+};
+
+typedef struct log_ring log_ring;
+typedef struct logger logger;
+
+static __thread log_ring *thread_ring = NULL;               // Buffer del thread corrente, NULL se il thread usa il buffer condiviso
+
+/*
+ * Apre il file di log in modalità append e avvia il thread di log
+ * Parametri:
+ *      log: il logger da inizializzare
+ *      log_filename: il filename del file di log
+ *      n_workers: il numero di worker, ognuno dei quali riceve un buffer dedicato
+ * Errno:
+ *      EINVAL: se log == NULL oppure log_filename == NULL oppure n_workers < 0
+ *      vedi man open e man pthread_create per altri errno
+ * Ritorna: 0 in caso di successo, -1 in caso di errore
+ */
+int init_logger(logger *log, char *log_filename, int n_workers);
+
+/*
+ * Scrive sul file tutti i record in attesa, termina il thread di log e chiude il file
+ * Deve essere eseguita dopo la terminazione di tutti i produttori
+ * Parametri:
+ *      log: il logger da deallocare
+ * Ritorna: none
+ */
+void free_logger(logger *log);
+
+/*
+ * Associa al thread chiamante il buffer dedicato del worker n, i record successivi sono inseriti senza acquisire alcuna mutex
+ * Parametri:
+ *      log: il logger
+ *      n: il numero identificativo del worker
+ * Ritorna: none
+ */
+void log_register(logger *log, int n);
+
+/*
+ * Formatta un record come printf e lo inserisce nel buffer del thread chiamante, la scrittura sul file avviene in modo asincrono
+ * Se il buffer è pieno attende che il thread di log lo svuoti, quindi nessun record viene perso
+ * Parametri:
+ *      log: il logger
+ *      format: la stringa di formato, i record più lunghi di LOG_RECORD_MAX byte sono troncati
+ * Ritorna: none
+ */
+void log_printf(logger *log, const char *format, ...);
+
+/*
+ * Scrive sul file di log, con una writev, tutti i record presenti nei buffer
+ * Parametri:
+ *      log: il logger
+ * Ritorna: 0 in caso di successo, -1 in caso di errore
+ */
+int log_flush(logger *log);
+
+/*
+ * Funzione eseguita dal thread di log, svuota i buffer allo scadere di LOG_FLUSH_INTERVAL oppure quando un buffer supera LOG_FLUSH_THRESHOLD
+ * Parametri:
+ *      arg: il logger
+ * Ritorna: NULL
+ */
+void *log_thread(void *arg);
+
+int init_logger(logger *log, char *log_filename, int n_workers) {
+    int i;
+
+    if(log == NULL || log_filename == NULL || n_workers < 0) {
+        errno = EINVAL;
+
+        return -1;
+    }
+
+    if((log->fd = open(log_filename, O_WRONLY | O_CREAT | O_APPEND, 0644)) == -1) {
+        return -1;
+    }
+
+    log->n_rings = n_workers + 1;
+    log->rings = malloc(log->n_rings * sizeof(log_ring));
+    log->iov = malloc(2 * log->n_rings * sizeof(struct iovec));
+    log->flushed = malloc(log->n_rings * sizeof(size_t));
+
+    for(i = 0; i < log->n_rings; i++) {
+        atomic_init(&log->rings[i].head, 0);
+        atomic_init(&log->rings[i].tail, 0);
+    }
+
+    pthread_mutex_init(&log->shared_lock, NULL);
+    pthread_mutex_init(&log->lock, NULL);
+    pthread_cond_init(&log->cond, NULL);
+    log->stop = 0;
+
+    if((errno = pthread_create(&log->thread, NULL, &log_thread, log)) != 0) {
+        close(log->fd);
+        free(log->rings);
+        free(log->iov);
+        free(log->flushed);
+
+        return -1;
+    }
+
+    return 0;
+}
+
+void free_logger(logger *log) {
+    pthread_mutex_lock(&log->lock);
+    log->stop = 1;
+    pthread_cond_signal(&log->cond);
+    pthread_mutex_unlock(&log->lock);
+
+    // Il thread di log svuota i buffer prima di terminare
+    pthread_join(log->thread, NULL);
+
+    close(log->fd);
+
+    pthread_mutex_destroy(&log->shared_lock);
+    pthread_mutex_destroy(&log->lock);
+    pthread_cond_destroy(&log->cond);
+
+    free(log->rings);
+    free(log->iov);
+    free(log->flushed);
+}
+
+void log_register(logger *log, int n) {
+    thread_ring = &log->rings[n];
+}
+
+void log_printf(logger *log, const char *format, ...) {
+    log_ring *ring = thread_ring;
+
+    char record[LOG_RECORD_MAX];
+    va_list args;
+
+    size_t len;
+    size_t head;
+    size_t tail;
+    size_t pos;
+    size_t first;
+
+    int written;
+
+    va_start(args, format);
+    written = vsnprintf(record, LOG_RECORD_MAX, format, args);
+    va_end(args);
+
+    if(written < 0) {
+        return;
+    }
+
+    len = written < LOG_RECORD_MAX ? written : LOG_RECORD_MAX - 1;
+
+    if(ring == NULL) {
+        // Il thread non possiede un buffer dedicato, usa il buffer condiviso
+        ring = &log->rings[log->n_rings - 1];
+
+        pthread_mutex_lock(&log->shared_lock);
+    }
+
+    tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+    // Attende che il thread di log liberi lo spazio necessario per il record
+    while(tail + len - (head = atomic_load_explicit(&ring->head, memory_order_acquire)) > LOG_RING_SIZE) {
+        pthread_cond_signal(&log->cond);
+
+        sched_yield();
+    }
+
+    // Copia il record nel buffer, eventualmente in due parti se raggiunge la fine del buffer
+    pos = tail & (LOG_RING_SIZE - 1);
+    first = len < LOG_RING_SIZE - pos ? len : LOG_RING_SIZE - pos;
+
+    memcpy(ring->buffer + pos, record, first);
+    memcpy(ring->buffer, record + first, len - first);
+
+    // Il record diventa visibile al thread di log solo dopo essere stato copiato per intero
+    atomic_store_explicit(&ring->tail, tail + len, memory_order_release);
+
+    if(tail - head < LOG_FLUSH_THRESHOLD && tail + len - head >= LOG_FLUSH_THRESHOLD) {
+        // Il buffer ha appena superato la soglia, risveglia il thread di log senza attendere l'intervallo
+        pthread_cond_signal(&log->cond);
+    }
+
+    if(ring == &log->rings[log->n_rings - 1]) {
+        pthread_mutex_unlock(&log->shared_lock);
+    }
+}
+
+int log_flush(logger *log) {
+    log_ring *ring;
+
+    size_t head;
+    size_t tail;
+    size_t pos;
+    size_t len;
+    size_t first;
+
+    int first_ring = 0;
+    int iovcnt = 0;
+    int result = 0;
+    int i;
+    int j;
+
+    for(i = 0; i < log->n_rings; i++) {
+        ring = &log->rings[i];
+
+        head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+        tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+        log->flushed[i] = tail;
+
+        if(head != tail) {
+            // I byte in attesa possono essere divisi in due parti dalla fine del buffer
+            pos = head & (LOG_RING_SIZE - 1);
+            len = tail - head;
+            first = len < LOG_RING_SIZE - pos ? len : LOG_RING_SIZE - pos;
+
+            log->iov[iovcnt].iov_base = ring->buffer + pos;
+            log->iov[iovcnt].iov_len = first;
+            iovcnt++;
+
+            if(len > first) {
+                log->iov[iovcnt].iov_base = ring->buffer;
+                log->iov[iovcnt].iov_len = len - first;
+                iovcnt++;
+            }
+        }
+
+        // Scrive i buffer raccolti quando il vettore è pieno oppure dopo l'ultimo buffer
+        if(iovcnt > 0 && (iovcnt + 2 > LOG_IOV_MAX || i == log->n_rings - 1)) {
+            if(writevn(log->fd, log->iov, iovcnt) == -1) {
+                result = -1;
+            }
+
+            // Libera lo spazio scritto, i byte inseriti dopo la lettura di tail restano per la scrittura successiva
+            for(j = first_ring; j <= i; j++) {
+                atomic_store_explicit(&log->rings[j].head, log->flushed[j], memory_order_release);
+            }
+
+            first_ring = i + 1;
+            iovcnt = 0;
+        }
+    }
+
+    return result;
+}
+
+void *log_thread(void *arg) {
+    logger *log = (logger *)arg;
+
+    struct timespec deadline;
+
+    int stop = 0;
+
+    while(!stop) {
+        pthread_mutex_lock(&log->lock);
+
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += LOG_FLUSH_INTERVAL * 1000000L;
+        deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+        deadline.tv_nsec %= 1000000000L;
+
+        if(!log->stop) {
+            pthread_cond_timedwait(&log->cond, &log->lock, &deadline);
+        }
+
+        stop = log->stop;
+
+        pthread_mutex_unlock(&log->lock);
+
+        // Dopo la richiesta di terminazione esegue un'ultima scrittura, i produttori sono già terminati
+        log_flush(log);
+    }
+
+    return NULL;
+}
@@ -0,0 +1,299 @@
+#ifndef OPEN_SET_H
+#define OPEN_SET_H
+
+#include <errno.h>
+#include <stdlib.h>
+
+#define OPEN_SET_INLINE 2                   // Numero di connessioni memorizzate direttamente nell'insieme, la maggior parte dei file è aperta da al più un client
+#define OPEN_SET_MIN_SIZE 8                 // Numero iniziale di celle della tabella in cui l'insieme si espande, deve essere una potenza di 2
+
+struct open_entry {
+    int fd;                                 // Il descrittore del socket della connessione, -1 se la cella è vuota
+    struct owner *owner;                    // L'elemento dell'indice delle connessioni associato
+};
+
+struct open_set {
+    int n;                                  // Numero di connessioni contenute nell'insieme
+    int size;                               // 0 se le connessioni sono in inline_els, altrimenti numero di celle di table, potenza di 2
+    union {
+        struct open_entry inline_els[OPEN_SET_INLINE];  // Le connessioni, finchè sono al più OPEN_SET_INLINE
+        struct open_entry *table;                       // Tabella ad indirizzamento aperto con scansione lineare, indicizzata per descrittore
+    };
+};
+
+typedef struct open_entry open_entry;
+typedef struct open_set open_set;
+
+/*
+ * Inizializza un insieme vuoto, senza allocare memoria
+ * Parametri:
+ *      set: l'insieme da inizializzare
+ * Ritorna: none
+ */
+void open_set_init(open_set *set);
+
+/*
+ * Dealloca l'eventuale tabella dell'insieme, gli elementi associati non vengono deallocati
+ * Parametri:
+ *      set: l'insieme da deallocare
+ * Ritorna: none
+ */
+void open_set_free(open_set *set);
+
+/*
+ * Cerca una connessione nell'insieme, il costo è O(1)
+ * Parametri:
+ *      set: l'insieme
+ *      fd: il descrittore del socket della connessione
+ * Ritorna: l'elemento associato alla connessione, NULL se la connessione non è contenuta nell'insieme
+ */
+struct owner *open_set_find(open_set *set, int fd);
+
+/*
+ * Inserisce una connessione nell'insieme, che non deve essere già contenuta, espandendo l'insieme in una tabella se necessario
+ * Parametri:
+ *      set: l'insieme
+ *      fd: il descrittore del socket della connessione
+ *      owner: l'elemento da associare alla connessione
+ * Errno:
+ *      ENOMEM: se non è possibile allocare la tabella
+ * Ritorna: 0 in caso di successo, -1 in caso di errore
+ */
+int open_set_add(open_set *set, int fd, struct owner *owner);
+
+/*
+ * Rimuove una connessione dall'insieme, se la connessione non è contenuta non esegue alcuna operazione
+ * Parametri:
+ *      set: l'insieme
+ *      fd: il descrittore del socket della connessione
+ * Ritorna: none
+ */
+void open_set_remove(open_set *set, int fd);
+
+/*
+ * Restituisce un elemento qualsiasi dell'insieme, usata per svuotarlo
+ * Parametri:
+ *      set: l'insieme
+ * Ritorna: un elemento dell'insieme, NULL se l'insieme è vuoto
+ */
+struct owner *open_set_any(open_set *set);
+
+/*
+ * Sposta tutte le connessioni in una nuova tabella con il numero di celle specificato
+ * Parametri:
+ *      set: l'insieme
+ *      size: il nuovo numero di celle, potenza di 2
+ * Errno:
+ *      ENOMEM: se non è possibile allocare la tabella
+ * Ritorna: 0 in caso di successo, -1 in caso di errore
+ */
+static int open_set_grow(open_set *set, int size);
+
+/*
+ * Restituisce l'indice della cella che contiene la connessione oppure della cella vuota in cui inserirla
+ * Parametri:
+ *      table: la tabella
+ *      size: il numero di celle della tabella
+ *      fd: il descrittore del socket della connessione
+ * Ritorna: l'indice della cella
+ */
+static int open_set_slot(open_entry *table, int size, int fd);
+
+void open_set_init(open_set *set) {
+    int i;
+
+    set->n = 0;
+    set->size = 0;
+
+    for(i = 0; i < OPEN_SET_INLINE; i++) {
+        set->inline_els[i].fd = -1;
+        set->inline_els[i].owner = NULL;
+    }
+}
+
+void open_set_free(open_set *set) {
+    if(set->size != 0) {
+        free(set->table);
+    }
+
+    open_set_init(set);
+}
+
+struct owner *open_set_find(open_set *set, int fd) {
+    open_entry *el;
+
+    int i;
+
+    if(set->size == 0) {
+        for(i = 0; i < OPEN_SET_INLINE; i++) {
+            if(set->inline_els[i].fd == fd) {
+                return set->inline_els[i].owner;
+            }
+        }
+
+        return NULL;
+    }
+
+    el = &set->table[open_set_slot(set->table, set->size, fd)];
+
+    return el->fd == fd ? el->owner : NULL;
+}
+
+int open_set_add(open_set *set, int fd, struct owner *owner) {
+    open_entry *el;
+
+    int i;
+
+    if(set->size == 0) {
+        for(i = 0; i < OPEN_SET_INLINE; i++) {
+            if(set->inline_els[i].fd == -1) {
+                set->inline_els[i].fd = fd;
+                set->inline_els[i].owner = owner;
+                set->n++;
+
+                return 0;
+            }
+        }
+
+        // Le celle inline sono tutte occupate, l'insieme si espande in una tabella
+        if(open_set_grow(set, OPEN_SET_MIN_SIZE) == -1) {
+            return -1;
+        }
+    } else if((set->n + 1) * 2 > set->size && open_set_grow(set, set->size * 2) == -1) {
+        // Il fattore di carico è mantenuto sotto 1/2, quindi le scansioni restano brevi
+        return -1;
+    }
+
+    el = &set->table[open_set_slot(set->table, set->size, fd)];
+    el->fd = fd;
+    el->owner = owner;
+    set->n++;
+
+    return 0;
+}
+
+void open_set_remove(open_set *set, int fd) {
+    int mask;
+    int hole;
+    int i;
+    int home;
+
+    if(set->size == 0) {
+        for(i = 0; i < OPEN_SET_INLINE; i++) {
+            if(set->inline_els[i].fd == fd) {
+                set->inline_els[i].fd = -1;
+                set->inline_els[i].owner = NULL;
+                set->n--;
+            }
+        }
+
+        return;
+    }
+
+    mask = set->size - 1;
+    hole = open_set_slot(set->table, set->size, fd);
+
+    if(set->table[hole].fd != fd) {
+        return;
+    }
+
+    set->n--;
+
+    if(set->n == 0) {
+        // L'insieme vuoto torna alla rappresentazione inline
+        open_set_free(set);
+
+        return;
+    }
+
+    // Le connessioni successive nella stessa sequenza sono spostate nella cella liberata, senza lasciare celle cancellate
+    for(i = (hole + 1) & mask; set->table[i].fd != -1; i = (i + 1) & mask) {
+        home = set->table[i].fd & mask;
+
+        if(((i - home) & mask) >= ((i - hole) & mask)) {
+            set->table[hole] = set->table[i];
+            hole = i;
+        }
+    }
+
+    set->table[hole].fd = -1;
+    set->table[hole].owner = NULL;
+}
+
+struct owner *open_set_any(open_set *set) {
+    int i;
+
+    if(set->size == 0) {
+        for(i = 0; i < OPEN_SET_INLINE; i++) {
+            if(set->inline_els[i].fd != -1) {
+                return set->inline_els[i].owner;
+            }
+        }
+
+        return NULL;
+    }
+
+    for(i = 0; i < set->size; i++) {
+        if(set->table[i].fd != -1) {
+            return set->table[i].owner;
+        }
+    }
+
+    return NULL;
+}
+
+static int open_set_grow(open_set *set, int size) {
+    open_entry *table;
+    open_entry *old;
+
+    int old_size;
+    int i;
+
+    if((table = malloc(size * sizeof(open_entry))) == NULL) {
+        errno = ENOMEM;
+
+        return -1;
+    }
+
+    for(i = 0; i < size; i++) {
+        table[i].fd = -1;
+        table[i].owner = NULL;
+    }
+
+    if(set->size == 0) {
+        for(i = 0; i < OPEN_SET_INLINE; i++) {
+            if(set->inline_els[i].fd != -1) {
+                table[open_set_slot(table, size, set->inline_els[i].fd)] = set->inline_els[i];
+            }
+        }
+    } else {
+        old = set->table;
+        old_size = set->size;
+
+        for(i = 0; i < old_size; i++) {
+            if(old[i].fd != -1) {
+                table[open_set_slot(table, size, old[i].fd)] = old[i];
+            }
+        }
+
+        free(old);
+    }
+
+    set->table = table;
+    set->size = size;
+
+    return 0;
+}
+
+static int open_set_slot(open_entry *table, int size, int fd) {
+    int i = fd & (size - 1);
+
+    // I descrittori sono piccoli e distinti, quindi sono usati direttamente come hash
+    while(table[i].fd != -1 && table[i].fd != fd) {
+        i = (i + 1) & (size - 1);
+    }
+
+    return i;
+}
+
+#endif
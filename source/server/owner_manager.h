@@ -0,0 +1,256 @@
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ht_manager.h"
+
+#define OWNER_MIN_CONNS 64                  // Numero iniziale di descrittori indicizzati, l'indice cresce raddoppiando
+
+struct owner {
+    struct f_el *file;                      // Il file aperto o posseduto dalla connessione
+    int fd;                                 // Il descrittore del socket della connessione
+    int opened;                             // 1 se la connessione ha aperto il file, 0 altrimenti
+    int locked;                             // 1 se la connessione possiede la lock sul file, 0 altrimenti
+    struct owner *conn_next;                // Elemento successivo nella lista dei file della connessione
+    struct owner *conn_prev;                // Elemento precedente nella lista dei file della connessione
+};
+
+struct owner_index {
+    struct owner **conns;                   // Testa della lista dei file di ogni connessione, indicizzata per descrittore del socket
+    int size;                               // Numero di descrittori indicizzati da conns
+};
+
+typedef struct owner owner;
+typedef struct owner_index owner_index;
+
+/*
+ * Inizializza un indice vuoto, ogni partizione dello storage possiede il proprio indice protetto dalla sua lock
+ * Parametri:
+ *      index: l'indice da inizializzare
+ * Errno:
+ *      EINVAL: se index == NULL
+ *      ENOMEM: se non è possibile allocare l'indice
+ * Ritorna: 0 in caso di successo, -1 in caso di errore
+ */
+int init_owner_index(owner_index *index);
+
+/*
+ * Dealloca l'indice e tutti i suoi elementi, i file a cui gli elementi fanno riferimento non vengono modificati
+ * Parametri:
+ *      index: l'indice da deallocare
+ * Ritorna: none
+ */
+void free_owner_index(owner_index *index);
+
+/*
+ * Restituisce l'elemento che lega la connessione al file, creandolo se create == 1
+ * L'elemento è cercato nell'insieme delle connessioni del file, il costo è O(1)
+ * Parametri:
+ *      index: l'indice della partizione che contiene il file
+ *      file: il file
+ *      fd: il descrittore del socket della connessione
+ *      create: 1 se l'elemento deve essere creato quando non esiste, 0 altrimenti
+ * Errno:
+ *      ENOENT: se l'elemento non esiste e create == 0
+ *      ENOMEM: se non è possibile allocare l'elemento
+ * Ritorna: il puntatore all'elemento, NULL in caso di errore
+ */
+owner *owner_get(owner_index *index, f_el *file, int fd, int create);
+
+/*
+ * Verifica se la connessione ha aperto il file, non modifica l'indice
+ * Parametri:
+ *      file: il file
+ *      fd: il descrittore del socket della connessione
+ * Ritorna: 1 se la connessione ha aperto il file, 0 altrimenti
+ */
+int owner_opened(f_el *file, int fd);
+
+/*
+ * Rimuove e dealloca l'elemento se la connessione non ha più aperto il file e non ne possiede la lock
+ * Parametri:
+ *      index: l'indice della partizione che contiene il file
+ *      el: l'elemento da verificare
+ * Ritorna: none
+ */
+void owner_put(owner_index *index, owner *el);
+
+/*
+ * Rimuove dall'indice tutti gli elementi che fanno riferimento al file, deve essere eseguita prima di deallocare il file
+ * Parametri:
+ *      index: l'indice della partizione che contiene il file
+ *      file: il file da rimuovere
+ * Ritorna: none
+ */
+void owner_release_file(owner_index *index, f_el *file);
+
+/*
+ * Chiude tutti i file aperti dalla connessione e rilascia tutte le lock da essa possedute, il costo è proporzionale al numero di questi file
+ * Parametri:
+ *      index: l'indice della partizione
+ *      fd: il descrittore del socket della connessione chiusa
+ * Ritorna: none
+ */
+void owner_release_conn(owner_index *index, int fd);
+
+/*
+ * Rimuove l'elemento dalla lista della connessione e dall'insieme del file, quindi lo dealloca
+ * Parametri:
+ *      index: l'indice che contiene l'elemento
+ *      el: l'elemento da rimuovere
+ * Ritorna: none
+ */
+static void owner_unlink(owner_index *index, owner *el);
+
+int init_owner_index(owner_index *index) {
+    if(index == NULL) {
+        errno = EINVAL;
+
+        return -1;
+    }
+
+    if((index->conns = calloc(OWNER_MIN_CONNS, sizeof(owner *))) == NULL) {
+        errno = ENOMEM;
+
+        return -1;
+    }
+
+    index->size = OWNER_MIN_CONNS;
+
+    return 0;
+}
+
+void free_owner_index(owner_index *index) {
+    owner *el;
+    owner *next;
+
+    int i;
+
+    for(i = 0; i < index->size; i++) {
+        for(el = index->conns[i]; el != NULL; el = next) {
+            next = el->conn_next;
+
+            free(el);
+        }
+    }
+
+    free(index->conns);
+}
+
+owner *owner_get(owner_index *index, f_el *file, int fd, int create) {
+    owner **conns;
+    owner *el;
+
+    int size;
+
+    if((el = open_set_find(&file->metadata.owners, fd)) != NULL) {
+        return el;
+    }
+
+    if(!create) {
+        errno = ENOENT;
+
+        return NULL;
+    }
+
+    if(fd >= index->size) {
+        // I descrittori dei socket sono piccoli e riutilizzati, quindi l'indice cresce raramente
+        size = index->size;
+
+        while(size <= fd) {
+            size <<= 1;
+        }
+
+        if((conns = realloc(index->conns, size * sizeof(owner *))) == NULL) {
+            errno = ENOMEM;
+
+            return NULL;
+        }
+
+        memset(conns + index->size, 0, (size - index->size) * sizeof(owner *));
+
+        index->conns = conns;
+        index->size = size;
+    }
+
+    if((el = malloc(sizeof(owner))) == NULL) {
+        errno = ENOMEM;
+
+        return NULL;
+    }
+
+    if(open_set_add(&file->metadata.owners, fd, el) == -1) {
+        free(el);
+
+        return NULL;
+    }
+
+    el->file = file;
+    el->fd = fd;
+    el->opened = 0;
+    el->locked = 0;
+
+    // L'elemento è inserito in testa alla lista della connessione
+    el->conn_prev = NULL;
+    el->conn_next = index->conns[fd];
+    if(el->conn_next != NULL) {
+        el->conn_next->conn_prev = el;
+    }
+    index->conns[fd] = el;
+
+    return el;
+}
+
+int owner_opened(f_el *file, int fd) {
+    owner *el = open_set_find(&file->metadata.owners, fd);
+
+    return el != NULL && el->opened;
+}
+
+void owner_put(owner_index *index, owner *el) {
+    if(!el->opened && !el->locked) {
+        owner_unlink(index, el);
+    }
+}
+
+void owner_release_file(owner_index *index, f_el *file) {
+    owner *el;
+
+    while((el = open_set_any(&file->metadata.owners)) != NULL) {
+        owner_unlink(index, el);
+    }
+}
+
+void owner_release_conn(owner_index *index, int fd) {
+    owner *el;
+
+    if(fd >= index->size) {
+        // La connessione non ha mai aperto file di questa partizione
+        return;
+    }
+
+    // Rimuovendo l'elemento dall'insieme del file la connessione non risulta più tra quelle che hanno aperto il file
+    while((el = index->conns[fd]) != NULL) {
+        if(el->locked && el->file->metadata.acquired_by == fd) {
+            el->file->metadata.acquired_by = -1;
+        }
+
+        owner_unlink(index, el);
+    }
+}
+
+static void owner_unlink(owner_index *index, owner *el) {
+    if(el->conn_prev == NULL) {
+        index->conns[el->fd] = el->conn_next;
+    } else {
+        el->conn_prev->conn_next = el->conn_next;
+    }
+
+    if(el->conn_next != NULL) {
+        el->conn_next->conn_prev = el->conn_prev;
+    }
+
+    open_set_remove(&el->file->metadata.owners, el->fd);
+
+    free(el);
+}
@@ -1,171 +1,147 @@
-#include <pthread.h>
-#include <errno.h>
-
-struct request_queue_el {
-    int request_fd;
-    struct request_queue_el *next_request;
-};
-
-typedef struct request_queue_el request_queue_el;
-
-pthread_mutex_t lock_queue = PTHREAD_MUTEX_INITIALIZER;
-pthread_cond_t cond_queue = PTHREAD_COND_INITIALIZER;
-
-/*
- * Inserisce un nuovo elemento nella queue
- * Parametri:
- *      head: il puntatore al puntatore alla testa della queue
- *      tail: il puntatore al puntatore alla coda della queue
- *      fd: il file descriptor da inserire nella queue
- * Errno:
- *      EINVAL: se head == NULL, tail == NULL oppure fd < 0
- * Ritorna: il nuovo elemento in caso di successo, NULL altrimenti
- */
-request_queue_el *push_request(request_queue_el **head, request_queue_el **tail, int fd);
-
-/*
- * Rimuove un elemento dalla queue, se la queue è vuota il thread che invoca questa funzione si mette in attesa
- * Parametri:
- *      head: il puntatore al puntatore alla testa della queue
- * Ritorna: il file descriptor presente in testa alla queue
- */
-int pop_request(request_queue_el **head);
-
-/*
- * Visualizza sullo standard output il contenuto della queue
- * Parametri:
- *      head: il puntatore alla testa della queue
- * Ritorna: none
- */
-void print_queue(request_queue_el *head);
-
-/*
- * Verifica l'esistenza del file descriptor fd nella queue
- * Parametri:
- *      head: il puntatore alla testa della queue
- *      fd: il file descriptor su cui si vuole eseguire la verifica
- * Ritorna: 1 se il file descriptor è stato trovato, 0 altrimenti
- */
-int exist_fd(request_queue_el *head, int fd);
-
-/*
- * Dealloca gli elementi contenuti nella queue
- * Parametri:
- *      head: il puntatore alla testa della queue
- * Ritorna: none
- */
-void free_request_queue(request_queue_el *head);
-
-request_queue_el *push_request(request_queue_el **head, request_queue_el **tail, int fd) {
-    request_queue_el *n_el;
-
-    if(*head != NULL && *tail == NULL) {
-        errno = EINVAL;
-
-        return NULL;
-    }
-
-    if(fd < 0) {
-        errno = EINVAL;
-
-        return NULL;
-    }
-
-    // Crea e inizializza il nuovo elemento della queue
-    if((n_el = malloc(sizeof(request_queue_el))) == NULL) {
-        return NULL;
-    }
-    n_el->request_fd = fd;
-    n_el->next_request = NULL;
-
-    if((errno = pthread_mutex_lock(&lock_queue)) != 0) {
-        return NULL;
-    }
-
-    if(*head == NULL) {
-        // La queue è vuota, bisogna modificare la testa
-        *head = n_el;
-        *tail = n_el;
-    } else {
-        // La queue non è vuota, bisogna modificare la coda
-        (*tail)->next_request = n_el;
-        *tail = n_el;
-    }
-
-    // Informa i thread consumatori che un nuovo elemento è disponibile
-    if((errno = pthread_cond_signal(&cond_queue)) != 0) {
-        pthread_mutex_unlock(&lock_queue);
-
-        return NULL;
-    }
-
-    pthread_mutex_unlock(&lock_queue);
-
-    return n_el;
-}
-
-int pop_request(request_queue_el **head) {
-    int result;
-    request_queue_el *old_head;
-
-    if((errno = pthread_mutex_lock(&lock_queue)) != 0) {
-
-        return -1;
-    }
-
-    // Verifica se è presente un elemento nella queue, in caso contrario si mette in attesa fino a che un nuovo elemento è disponibile
-    while(*head == NULL) {
-        if((errno = pthread_cond_wait(&cond_queue, &lock_queue)) != 0) {
-            pthread_mutex_unlock(&lock_queue);
-
-            return -1;
-        }
-    }
-
-    // Rimuove l'elemento dalla queue
-    old_head = *head;
-    *head = old_head->next_request;
-    result = old_head->request_fd;
-
-    pthread_mutex_unlock(&lock_queue);
-
-    free(old_head);
-
-    return result;
-}
-
-void print_queue(request_queue_el *head){
-    if(head == NULL) {
-        fprintf(stderr, "NULL\n");
-    }
-
-    if(head != NULL) {
-        fprintf(stderr, "%d->", head->request_fd);
-
-        print_queue(head->next_request);
-    }
-}
-
-int exist_fd(request_queue_el *head, int fd) {
-    if(head == NULL) {
-        // Il file descriptor non è stato trovato
-        return 0;
-    }
-
-    if(head->request_fd == fd) {
-        // Il file descriptor è stato trovato
-        return 1;
-    }
-
-    return exist_fd(head->next_request, fd);
-}
-
-void free_request_queue(request_queue_el *head) {
-    if(head == NULL) {
-        return;
-    }
-
-    free_request_queue(head->next_request);
-
-    free(head);
-}
\ No newline at end of file
+#ifndef REQUEST_QUEUE_H
+#define REQUEST_QUEUE_H
+
+#include <errno.h>
+#include <stdlib.h>
+
+#include "definitions.h"
+#include "fd_ring.h"
+#include "data_manager.h"
+#include "storage_manager.h"
+
+struct request {
+    int fd;                                                 // Il descrittore della connessione da cui è stata ricevuta la richiesta
+    frame_header header;                                    // L'intestazione della richiesta
+    uint64_t key;                                           // L'hash del filename, le richieste con la stessa chiave di una connessione sono eseguite in ordine
+    struct request *next;                                   // La richiesta successiva tra quelle della connessione in attesa di essere assegnate ai worker
+    f_data *data;                                           // Il payload ricevuto direttamente nel buffer che diventerà il contenuto del file, NULL se il payload è nel corpo
+    slab_arena *arena;                                      // L'arena a cui restituire data
+    atomic_long *budget;                                    // Il budget di ricezione del manager a cui restituire charge, NULL se la richiesta non è stata ricevuta dal manager
+    long charge;                                            // Byte del filename e del payload addebitati al budget di ricezione
+    read_cursor cursor;                                     // La posizione raggiunta da una lettura di n file, valida solo se header.flags contiene MORE_FRAMES
+    char body[];                                            // Il filename terminato da '\0' seguito dal payload terminato da '\0', vuoto se il payload è in data
+};
+
+typedef struct request request;
+typedef fd_ring request_queue;
+
+/*
+ * Inizializza la queue delle richieste, preallocando lo spazio per size richieste
+ * Parametri:
+ *      queue: la queue da inizializzare
+ *      size: il numero massimo di richieste contenute nella queue, pari a PIPELINE_DEPTH richieste per ogni connessione attiva
+ * Errno:
+ *      EINVAL: se queue == NULL oppure size <= 0
+ * Ritorna: 0 in caso di successo, -1 in caso di errore
+ */
+int init_request_queue(request_queue *queue, int size);
+
+/*
+ * Inserisce una richiesta già ricevuta per intero nella queue e risveglia un worker in attesa, senza allocare memoria né acquisire alcuna lock
+ * Parametri:
+ *      queue: la queue in cui inserire
+ *      req: la richiesta da inserire, passa al worker che la estrae
+ * Errno:
+ *      EINVAL: se req == NULL oppure req->fd < 0
+ *      EAGAIN: se la queue è piena
+ * Ritorna: 0 in caso di successo, -1 in caso di errore
+ */
+int push_request(request_queue *queue, request *req);
+
+/*
+ * Rimuove fino a max richieste dalla queue, se la queue è vuota il thread che invoca questa funzione si mette in attesa
+ * Parametri:
+ *      queue: la queue da cui rimuovere
+ *      reqs: l'array in cui memorizzare le richieste rimosse, il chiamante deve deallocarle con free_request
+ *      max: il numero massimo di richieste da rimuovere
+ * Errno:
+ *      ESHUTDOWN: se la queue è stata chiusa
+ * Ritorna: il numero di richieste rimosse, almeno 1, -1 in caso di errore
+ */
+int pop_requests(request_queue *queue, request **reqs, int max);
+
+/*
+ * Dealloca una richiesta e rilascia il riferimento al payload, se non è passato allo storage, restituendo i suoi byte al budget di ricezione
+ * Parametri:
+ *      req: la richiesta da deallocare, se è NULL non viene eseguita alcuna operazione
+ * Ritorna: none
+ */
+void free_request(request *req);
+
+/*
+ * Chiude la queue e risveglia tutti i worker in attesa, che terminano
+ * Parametri:
+ *      queue: la queue da chiudere
+ * Ritorna: none
+ */
+void close_request_queue(request_queue *queue);
+
+/*
+ * Dealloca la queue, i file descriptor delle richieste ancora presenti non vengono chiusi
+ * Parametri:
+ *      queue: la queue da deallocare
+ * Ritorna: none
+ */
+void free_request_queue(request_queue *queue);
+
+int init_request_queue(request_queue *queue, int size) {
+    return init_ring(queue, size);
+}
+
+int push_request(request_queue *queue, request *req) {
+    if(req == NULL || req->fd < 0) {
+        errno = EINVAL;
+
+        return -1;
+    }
+
+    return ring_push(queue, req->fd, 0, req);
+}
+
+int pop_requests(request_queue *queue, request **reqs, int max) {
+    ring_el els[max];
+
+    int n;
+    int i;
+
+    if((n = ring_pop(queue, els, max, 1)) == -1) {
+        return -1;
+    }
+
+    for(i = 0; i < n; i++) {
+        reqs[i] = els[i].data;
+    }
+
+    return n;
+}
+
+void free_request(request *req) {
+    if(req == NULL) {
+        return;
+    }
+
+    data_release(req->arena, req->data);
+
+    if(req->budget != NULL) {
+        atomic_fetch_sub(req->budget, req->charge);
+    }
+
+    free(req);
+}
+
+void close_request_queue(request_queue *queue) {
+    ring_close(queue);
+}
+
+void free_request_queue(request_queue *queue) {
+    ring_el el;
+
+    // Le richieste non ancora estratte dai worker sono deallocate insieme alla queue
+    while(ring_try_pop(queue, &el)) {
+        free_request(el.data);
+    }
+
+    free_ring(queue);
+}
+
+#endif
@@ -1,143 +1,120 @@
-#include <pthread.h>
-#include <errno.h>
-
-struct resolved_queue_el {
-    int resolved_fd;
-    int close;
-    struct resolved_queue_el *next_resolved;
-};
-
-typedef struct resolved_queue_el resolved_queue_el;
-
-pthread_mutex_t lock_resolved_queue = PTHREAD_MUTEX_INITIALIZER;
-
-/*
- * Inserisce un nuovo elemento nella queue
- * Parametri:
- *      head: il puntatore al puntatore alla testa della queue
- *      tail: il puntatore al puntatore alla coda della queue
- *      fd: il file descriptor da inserire nella queue
- *      close: indica se il file descriptor deve essere chiuso, 1 se deve essere chiuso, 0 altrimenti
- * Errno:
- *      EINVAL: se head == NULL, tail == NULL oppure fd < 0
- * Ritorna: il nuovo elemento in caso di successo, NULL altrimenti
- */
-resolved_queue_el *push_resolved(resolved_queue_el **head, resolved_queue_el **tail, int fd, int close);
-
-/*
- * Rimuove un elemento dalla queue
- * Parametri:
- *      head: il puntatore al puntatore alla testa della queue
- * Ritorna: una struct contenente il file descriptor e l'indicazione sulla necessità di chiudere il file descriptor, se la queue è vuota allora il file descriptor è impostato a -1
- */
-resolved_queue_el pop_resolved(resolved_queue_el **head);
-
-/*
- * Visualizza sullo standard output il contenuto della queue
- * Parametri:
- *      head: il puntatore alla testa della queue
- * Ritorna: none
- */
-void print_resolved_queue(resolved_queue_el *head);
-
-/*
- * Dealloca gli elementi contenuti nella queue
- * Parametri:
- *      head: il puntatore alla testa della queue
- * Ritorna: none
- */
-void free_resolved_queue(resolved_queue_el *head);
-
-resolved_queue_el *push_resolved(resolved_queue_el **head, resolved_queue_el **tail, int fd, int close) {
-    resolved_queue_el *n_el;
-
-    if(*head != NULL && tail == NULL) {
-        errno = EINVAL;
-
-        return NULL;
-    }
-
-    if(fd < 0) {
-        errno = EINVAL;
-
-        return NULL;
-    }
-
-    // Alloca e inizializza il nuovo elemento
-    if((n_el = malloc(sizeof(resolved_queue_el))) == NULL) {
-        return NULL;
-    }
-    n_el->resolved_fd = fd;
-    n_el->close = close;
-    n_el->next_resolved = NULL;
-
-    if((errno = pthread_mutex_lock(&lock_resolved_queue)) != 0) {
-        return NULL;
-    }
-
-    if(*head == NULL) {
-        // La queue è vuota, modifica la testa
-        *head = n_el;
-        *tail = n_el;
-    } else {
-        // La queue non è vuota, modifica la coda
-        (*tail)->next_resolved = n_el;
-        *tail = n_el;
-    }
-
-    pthread_mutex_unlock(&lock_resolved_queue);
-
-    return n_el;
-}
-
-resolved_queue_el pop_resolved(resolved_queue_el **head) {
-    resolved_queue_el result;
-    resolved_queue_el *old_head;
-
-    if((errno = pthread_mutex_lock(&lock_resolved_queue)) != 0) {
-
-        result.resolved_fd = -1;
-        return result;
-    }
-
-    if(*head != NULL) {
-        // È presente un elemento nella queue
-        old_head = *head;
-
-        *head = old_head->next_resolved;
-
-        result.resolved_fd = old_head->resolved_fd;
-        result.close = old_head->close;
-
-        free(old_head);
-    } else {
-        // La queue è vuota
-        result.resolved_fd = -1;
-    }
-
-    pthread_mutex_unlock(&lock_resolved_queue);
-
-    return result;
-}
-
-void print_resolved_queue(resolved_queue_el *head){
-    if(head == NULL) {
-        fprintf(stderr, "NULL\n");
-    }
-
-    if(head != NULL) {
-        fprintf(stderr, "%d->", head->resolved_fd);
-
-        print_resolved_queue(head->next_resolved);
-    }
-}
-
-void free_resolved_queue(resolved_queue_el *head) {
-    if(head == NULL) {
-        return;
-    }
-
-    free_resolved_queue(head->next_resolved);
-
-    free(head);
-}
\ No newline at end of file
+#include <errno.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#include "fd_ring.h"
+
+struct resolved_queue {
+    fd_ring ring;                                           // Il ring in cui i worker inseriscono i file descriptor delle richieste elaborate
+    int notify_fd;                                          // Eventfd segnalato ad ogni inserimento, il manager lo attende insieme alle connessioni
+};
+
+typedef struct resolved_queue resolved_queue;
+typedef struct ring_el resolved_queue_el;
+
+/*
+ * Inizializza la queue delle richieste elaborate e crea l'eventfd con cui push_resolved risveglia il manager
+ * Parametri:
+ *      queue: la queue da inizializzare
+ *      size: il numero massimo di richieste elaborate contenute nella queue, pari a PIPELINE_DEPTH richieste per ogni connessione attiva
+ * Errno:
+ *      EINVAL: se queue == NULL oppure size <= 0
+ *      vedi man eventfd per altri errno
+ * Ritorna: 0 in caso di successo, -1 in caso di errore
+ */
+int init_resolved_queue(resolved_queue *queue, int size);
+
+/*
+ * Inserisce un nuovo elemento nella queue e risveglia il manager, senza allocare memoria né acquisire alcuna lock
+ * Parametri:
+ *      queue: la queue in cui inserire
+ *      fd: il file descriptor da inserire nella queue
+ *      close: indica se il file descriptor deve essere chiuso, 1 se deve essere chiuso, 0 altrimenti
+ *      resp: la risposta da inviare sulla connessione, passa al manager, può essere NULL
+ * Errno:
+ *      EINVAL: se fd < 0
+ *      EAGAIN: se la queue è piena
+ * Ritorna: 0 in caso di successo, -1 in caso di errore
+ */
+int push_resolved(resolved_queue *queue, int fd, int close, void *resp);
+
+/*
+ * Rimuove fino a max elementi dalla queue, senza attendere se la queue è vuota
+ * Parametri:
+ *      queue: la queue da cui rimuovere
+ *      els: l'array in cui memorizzare gli elementi rimossi, ognuno contiene il file descriptor, l'indicazione sulla necessità di chiuderlo e la risposta in data
+ *      max: il numero massimo di elementi da rimuovere
+ * Ritorna: il numero di elementi rimossi, 0 se la queue è vuota
+ */
+int pop_resolved(resolved_queue *queue, resolved_queue_el *els, int max);
+
+/*
+ * Azzera il contatore dell'eventfd, deve essere eseguita prima di svuotare la queue in modo da non perdere gli inserimenti successivi
+ * Parametri:
+ *      queue: la queue
+ * Ritorna: none
+ */
+void drain_resolved_notify(resolved_queue *queue);
+
+/*
+ * Dealloca la queue e chiude l'eventfd
+ * Parametri:
+ *      queue: la queue da deallocare
+ * Ritorna: none
+ */
+void free_resolved_queue(resolved_queue *queue);
+
+int init_resolved_queue(resolved_queue *queue, int size) {
+    if(queue == NULL) {
+        errno = EINVAL;
+
+        return -1;
+    }
+
+    if(init_ring(&queue->ring, size) == -1) {
+        return -1;
+    }
+
+    if((queue->notify_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) == -1) {
+        free_ring(&queue->ring);
+
+        return -1;
+    }
+
+    return 0;
+}
+
+int push_resolved(resolved_queue *queue, int fd, int close, void *resp) {
+    if(fd < 0) {
+        errno = EINVAL;
+
+        return -1;
+    }
+
+    if(ring_push(&queue->ring, fd, close, resp) == -1) {
+        return -1;
+    }
+
+    // Risveglia il manager in modo che riattivi subito la connessione, senza attendere il timeout di epoll_wait
+    while(eventfd_write(queue->notify_fd, 1) == -1 && errno == EINTR);
+
+    return 0;
+}
+
+int pop_resolved(resolved_queue *queue, resolved_queue_el *els, int max) {
+    return ring_pop(&queue->ring, els, max, 0);
+}
+
+void drain_resolved_notify(resolved_queue *queue) {
+    eventfd_t value;
+
+    // La lettura riporta il contatore a 0, con EFD_NONBLOCK non si blocca se il contatore è già 0
+    while(eventfd_read(queue->notify_fd, &value) == -1 && errno == EINTR);
+}
+
+void free_resolved_queue(resolved_queue *queue) {
+    close(queue->notify_fd);
+
+    free_ring(&queue->ring);
+}
@@ -0,0 +1,217 @@
+#ifndef RESPONSE_QUEUE_H
+#define RESPONSE_QUEUE_H
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/sendfile.h>
+
+#include "definitions.h"
+#include "io_utils.h"
+#include "storage_manager.h"
+#include "request_queue.h"
+
+struct response {
+    frame_header header;                                    // L'intestazione della risposta, inviata dal primo buffer
+    struct iovec *iov;                                      // I buffer ancora da inviare, avanzati dopo ogni scrittura parziale
+    int iovcnt;                                             // Numero di buffer ancora da inviare
+    struct iovec *iov_alloc;                                // L'array dei buffer se allocato dal worker, NULL se sono usati i buffer inline
+    struct iovec inline_iov[2];                             // Buffer delle risposte composte dall'intestazione e da un solo payload
+    data_source *src;                                       // L'origine di ogni buffer, parallela a iov_alloc oppure a inline_iov, NULL se tutti i buffer sono inviati dalla memoria
+    data_source inline_src[2];                              // Origine dei buffer inline
+
+    char *payload;                                          // Il payload allocato per la risposta, NULL se non esiste
+    f_data *data;                                           // Il riferimento al buffer di un file letto, inviato senza essere copiato
+    f_el *victims;                                          // I file espulsi oppure letti con readNFiles inviati nella risposta, collegati tramite metadata.lru_next
+    frame_header *victims_h;                                // Le intestazioni dei frame dei file espulsi
+    storage *storage;                                       // Lo storage a cui restituire i buffer e i file espulsi
+    uint64_t key;                                           // La chiave della richiesta a cui si riferisce la risposta, vedi struct request
+    struct request *resume;                                 // La lettura di n file da riprendere dopo l'invio della risposta, NULL se la richiesta è terminata
+
+    struct response *next;                                  // La risposta successiva nella coda della connessione
+};
+
+struct response_queue {
+    struct response *head;                                  // La risposta in corso di invio, NULL se la coda è vuota
+    struct response *tail;                                  // L'ultima risposta della coda
+    int count;                                              // Numero di risposte nella coda
+};
+
+typedef struct response response;
+typedef struct response_queue response_queue;
+
+/*
+ * Dealloca una risposta e rilascia tutte le risorse che possiede
+ * Parametri:
+ *      resp: la risposta da deallocare, se è NULL non viene eseguita alcuna operazione
+ * Ritorna: none
+ */
+void response_free(response *resp);
+
+/*
+ * Inizializza una coda vuota
+ * Parametri:
+ *      queue: la coda da inizializzare
+ * Ritorna: none
+ */
+void response_queue_init(response_queue *queue);
+
+/*
+ * Inserisce una risposta in fondo alla coda, la risposta passa alla coda
+ * Parametri:
+ *      queue: la coda
+ *      resp: la risposta da inserire
+ * Ritorna: none
+ */
+void response_queue_push(response_queue *queue, response *resp);
+
+/*
+ * Invia senza bloccarsi le risposte della coda, nell'ordine di inserimento, finchè il socket le accetta
+ * Le risposte inviate per intero sono rimosse e deallocate, una scrittura parziale è ripresa dal punto in cui si è interrotta
+ * I buffer memorizzati in un memfd sono inviati con sendfile, gli altri con sendmsg, quindi il socket deve essere non bloccante
+ * Parametri:
+ *      queue: la coda
+ *      fd: il socket della connessione
+ *      sent: il puntatore in cui memorizzare 1 se almeno un byte è stato inviato, 0 altrimenti
+ * Errno:
+ *      vedi man sendmsg e man sendfile
+ * Ritorna: 1 se la coda è vuota, 0 se il socket non accetta altri byte, -1 in caso di errore
+ */
+int response_queue_flush(response_queue *queue, int fd, int *sent);
+
+/*
+ * Dealloca tutte le risposte della coda, anche se non sono state inviate
+ * Parametri:
+ *      queue: la coda
+ * Ritorna: none
+ */
+void response_queue_free(response_queue *queue);
+
+void response_free(response *resp) {
+    if(resp == NULL) {
+        return;
+    }
+
+    free(resp->iov_alloc);
+    free(resp->victims_h);
+    free(resp->payload);
+
+    data_release(&resp->storage->arena, resp->data);
+    release_victims(resp->storage, resp->victims);
+    free_request(resp->resume);
+
+    free(resp);
+}
+
+void response_queue_init(response_queue *queue) {
+    queue->head = NULL;
+    queue->tail = NULL;
+    queue->count = 0;
+}
+
+void response_queue_push(response_queue *queue, response *resp) {
+    resp->next = NULL;
+
+    if(queue->tail == NULL) {
+        queue->head = resp;
+    } else {
+        queue->tail->next = resp;
+    }
+
+    queue->tail = resp;
+    queue->count++;
+}
+
+int response_queue_flush(response_queue *queue, int fd, int *sent) {
+    response *resp;
+    struct msghdr msg;
+    data_source *src;
+
+    off_t offset;
+    ssize_t r;
+    int n;
+    int i;
+
+    *sent = 0;
+
+    while((resp = queue->head) != NULL) {
+        // Salta i buffer vuoti, una risposta senza altri buffer è già stata inviata per intero
+        iov_advance(&resp->iov, &resp->iovcnt, 0);
+
+        if(resp->iovcnt == 0) {
+            queue->head = resp->next;
+
+            if(queue->head == NULL) {
+                queue->tail = NULL;
+            }
+
+            queue->count--;
+
+            response_free(resp);
+
+            continue;
+        }
+
+        src = NULL;
+
+        if(resp->src != NULL) {
+            src = resp->src + (resp->iov - (resp->iov_alloc != NULL ? resp->iov_alloc : resp->inline_iov));
+        }
+
+        if(src != NULL && src->fd != -1) {
+            // Il buffer è nelle pagine di un memfd, che sono passate al socket senza essere copiate in un buffer utente
+            offset = (char *)resp->iov->iov_base - src->map;
+            r = sendfile(fd, src->fd, &offset, resp->iov->iov_len);
+        } else {
+            n = resp->iovcnt < IOV_MAX ? resp->iovcnt : IOV_MAX;
+
+            // Un solo sendmsg invia i buffer che precedono il prossimo buffer memorizzato in un memfd
+            for(i = 1; src != NULL && i < n; i++) {
+                if(src[i].fd != -1) {
+                    n = i;
+                }
+            }
+
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_iov = resp->iov;
+            msg.msg_iovlen = n;
+
+            // MSG_NOSIGNAL evita SIGPIPE se il client ha già chiuso la connessione
+            r = sendmsg(fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+        }
+
+        if(r == -1) {
+            if(errno == EINTR) {
+                continue;
+            }
+
+            if(errno == EAGAIN || errno == EWOULDBLOCK) {
+                return 0;
+            }
+
+            return -1;
+        }
+
+        *sent = 1;
+
+        iov_advance(&resp->iov, &resp->iovcnt, r);
+    }
+
+    return 1;
+}
+
+void response_queue_free(response_queue *queue) {
+    response *resp;
+
+    while((resp = queue->head) != NULL) {
+        queue->head = resp->next;
+
+        response_free(resp);
+    }
+
+    queue->tail = NULL;
+    queue->count = 0;
+}
+
+#endif
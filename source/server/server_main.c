@@ -1,3 +1,6 @@
+// Necessaria per accept4 e memfd_create
+#define _GNU_SOURCE
+
 #include <stdio.h>
 #include <sys/errno.h>
 #include <unistd.h>
@@ -8,22 +11,24 @@
 #include <fcntl.h>
 #include <sys/socket.h>
 #include <pthread.h>
-#include <poll.h>
 #include <sys/un.h>
 #include <signal.h>
 
 #include "request_queue.h"
 #include "resolved_queue.h"
 #include "storage_manager.h"
+#include "response_queue.h"
 #include "worker.h"
+#include "conn_manager.h"
 
 #define CONFIG_PATH "./etc/"
 #define CONFIG_FN "./etc/config.txt"
 #define TOKEN_SYMBOL ":"                        // Simbolo separatore nel file gi configurazione
 #define BUFFER_SIZE 256                         // Dimensione del buffer usato per la lettura del file di configurazione
-#define DEFAULT_CONFIG "# Il numero di thread che compongono il thread pool\nn_thread:1\n# La dimensione massima dello storage espressa in Mbyte\nb_storage:128\n# Il numero massimo di file che possono essere presenti contemporaneamente nello storage\nn_file_storage:10000\n# Il filename del socket di ascolto del server\nsoc_filename:./etc/server_socket\n# Il numero massimo di connessioni in attesa di essere accettate\nmax_conn_wait:10\n# Il numero massimo di connessioni attive contemporaneamente\nmax_active_conn:10\n# Il timeout di attesa del server\nmanager_timeout:10\n# Il file name del file di log\nlog_filename:./etc/log.txt\n# Il timeout per chiudere le connessioni inutilizzate con i client, specificato in secondi\nclient_timeout:60"
+#define DEFAULT_CONFIG "# Il numero di thread che compongono il thread pool\nn_thread:1\n# La dimensione massima dello storage espressa in Mbyte\nb_storage:128\n# Il numero massimo di file che possono essere presenti contemporaneamente nello storage\nn_file_storage:10000\n# Il filename del socket di ascolto del server\nsoc_filename:./etc/server_socket\n# Il numero massimo di connessioni in attesa di essere accettate\nmax_conn_wait:10\n# Il numero massimo di connessioni attive contemporaneamente\nmax_active_conn:10\n# Il timeout di attesa del server\nmanager_timeout:10\n# Il file name del file di log\nlog_filename:./etc/log.txt\n# Il timeout per chiudere le connessioni inutilizzate con i client, specificato in secondi\nclient_timeout:60\n# 1 se i contenuti dei file di almeno 64Kbyte sono memorizzati in un memfd e inviati ai client con sendfile\nmemfd_storage:0"
 #define UNIX_PATH_MAX 108
 #define CLIENT_TIMEOUT 60
+#define MANAGER_BATCH 64                        // Numero massimo di richieste risolte estratte insieme dal manager
 
 struct config_struct{
     int n_thread;                                                   // Numero di thread worker che compongono il thread pool
@@ -32,9 +37,10 @@ struct config_struct{
     char soc_filename[UNIX_PATH_MAX];                               // Nome del socket file
     int max_conn_wait;                                              // Numero massimo di connessioni in attesa di essere accettate
     int max_active_conn;                                            // Numero massimo di connessioni attive contemporaneamente
-    int manager_timeout;                                            // Timeout in millisecondi associato alla poll
+    int manager_timeout;                                            // Timeout in millisecondi associato alla epoll_wait
     char log_filename[UNIX_PATH_MAX];                               // Filename del file di log
     int client_timeout;                                             // Il timeout per chiudere le connessioni inutilizzate con i client, specificato in secondi
+    int memfd_storage;                                              // 1 se i contenuti dei file sono memorizzati in un memfd e inviati con sendfile, opzionale
 };
 
 typedef struct config_struct config;
@@ -66,33 +72,38 @@ static void sihup_manager(int signum) {
 config parse_config();
 
 /*
- * Alloca e inizializza l'array contenente i file descriptor di connessioni aperte con i client, utilizzato per la system call poll
+ * Chiude una connessione, ripristinando lo stato dello storage e deallocando le risposte non ancora inviate
  * Parametri:
- *      max: il numero massimo di connessioni contemporaneamente attive
- * Ritorna: l'array di file descriptor inizializzato
+ *      cm: il gestore delle connessioni
+ *      storage: lo storage
+ *      fd: il file descriptor della connessione
+ *      active_conn: il puntatore al contatore delle connessioni attive
+ * Ritorna: none
  */
-struct pollfd *init_fds(int max, time_t **client_lu);
+static void close_conn(conn_manager *cm, storage *storage, int fd, int *active_conn);
 
 /*
- * Aggiunge un nuovo file descriptor all'array fds
+ * Inserisce nella queue delle richieste una richiesta di una connessione pronta per essere elaborata
  * Parametri:
- *      fds: l'array in cui inserire il nuovo file descriptor
- *      fd: il file descriptor da aggiungere a fds
- *      max: il numero massimo di connessioni contemporaneamente attive
- *      max_poll_index: l'indice massimo t.c. fds[max_poll_index].fd != -1
- * Ritorna: l'indice il cui è stato inserito il nuovo file descriptor
+ *      cm: il gestore delle connessioni
+ *      requests: la queue delle richieste
+ *      slot: lo slot della connessione
+ *      req: la richiesta, passa al worker che la estrae
+ * Ritorna: none
  */
-int add_fd(struct pollfd *fds, int fd, int max);
+static void submit_request(conn_manager *cm, request_queue *requests, int slot, request *req);
 
 /*
- * Chiude la connessione con un client rimuovendo il corrispondente file descriptor da fds
+ * Invia senza bloccarsi le risposte in coda di una connessione e assegna ai worker le sue richieste pronte, quindi la chiude se ha terminato, altrimenti la riattiva
  * Parametri:
- *      fds: l'array da cui rimuovere il file descriptor
- *      fd: il file descriptor da rimuovere
- *      max: il numero massimo di connessioni contemporaneamente attive
- *      max_poll_index: l'indice massimo t.c. fds[max_poll_index].fd != -1
+ *      cm: il gestore delle connessioni
+ *      storage: lo storage
+ *      requests: la queue delle richieste
+ *      slot: lo slot della connessione
+ *      active_conn: il puntatore al contatore delle connessioni attive
+ * Ritorna: none
  */
-int close_conn(struct pollfd *fds, int fd, int max);
+static void serve_conn(conn_manager *cm, storage *storage, request_queue *requests, int slot, int *active_conn);
 
 int main(int argc, char *argv[]){
     config config;                                                      // Contiene i valori di configurazione del server
@@ -100,51 +111,57 @@ int main(int argc, char *argv[]){
     int fd_socket;                                                      // Socket usato dal server per ricevere le richieste di connessione
     int n_fd_socket;                                                    // Il socket usato dal server per la comunicazione con il client
 
-    int poll_result;                                                    // Il risultato ottenuto dall'esecuzione della procedura poll
+    int n_events;                                                       // Il numero di eventi restituiti da epoll_wait
+    int fd;
+    int slot;
+    int result;
     int i;
     int active_conn = 0;                                                // Numero di connessioni attualmente attive
     int stat_max_conn = 0;                                              // Statistica del numero massimo di connessioni contemporaneamente attive
     int terminate = 0;
 
     struct sockaddr_un socket_addr;
-    struct pollfd *fds;                                                 // Array di file descriptor su eseguire la poll
-    time_t *client_lu;                                                  // Array contenente il momento in cui il client corrispondente ha comunicato per l'ultima volta con il server
-    time_t actual_time;
+    conn_manager conns;                                                 // Il gestore delle connessioni attive, notificate da epoll
 
-    request_queue_el *head_request = NULL, *tail_request = NULL;        // Testa e coda della coda delle richieste
-    resolved_queue_el *head_resolved = NULL, *tail_resolved = NULL;     // Testa e coda della coda delle richieste soddisfatte
+    request_queue requests;                                             // La coda delle richieste, da cui i worker ottengono le connessioni pronte
+    resolved_queue resolved_requests;                                   // La coda delle richieste soddisfatte, da cui il manager ottiene le connessioni da riattivare o chiudere
+    request *req;                                                       // Una richiesta ricevuta per intero dal manager, da inserire nella coda delle richieste
 
     storage storage; 
 
     pthread_t *workers;                                                 // Array contenente puntatori ai thread worker
 
-    worker_arg *args;                                                   // Struct contenente tutti gli argomenti che devono essere passati ai worker al momento della loro creazione
+    worker_arg *args;                                                   // Array contenente gli argomenti passati ad ogni worker al momento della sua creazione
+
+    logger log;                                                         // Il logger che registra le operazioni sul file di log
 
-    resolved_queue_el resolved;                                         // Un singolo elemento della coda delle richieste risolte                                    
+    resolved_queue_el resolved[MANAGER_BATCH];                          // Gli elementi estratti insieme dalla coda delle richieste risolte
+    int n_resolved;
 
     struct sigaction sigint;
     struct sigaction sigquit;
     struct sigaction sighup;
+    struct sigaction sigpipe;
 
     int *served_request;
 
-    FILE *log_file;
-
-    f_el **ht = NULL;
 
     config = parse_config();
 
     // Visualizza la configurazione che è stata letta dal server dal file di configurazione 
     printf("Configurazione letta dal file config.txt:\n");
-    printf("\t-Numero di thread worker: %d\n\t-Dimensione dello storage: %fMbytes\n\t-Numero massimo di file: %d\n\t-Filename del socket di ascolto: %s\n\t-Numero massimo di connessioni in attesa: %d\n\t-Numero massimo di connessioni attive contemporaneamente: %d\n\t-Timeout per la poll: %d\n\t-Filename del file di log: %s\n\t-Timeout delle connessioni con i client: %d\n", config.n_thread, (config.b_storage / 1000000), config.n_file_storage, config.soc_filename, config.max_conn_wait, config.max_active_conn, config.manager_timeout, config.log_filename, config.client_timeout);
+    printf("\t-Numero di thread worker: %d\n\t-Dimensione dello storage: %fMbytes\n\t-Numero massimo di file: %d\n\t-Filename del socket di ascolto: %s\n\t-Numero massimo di connessioni in attesa: %d\n\t-Numero massimo di connessioni attive contemporaneamente: %d\n\t-Timeout per la epoll_wait: %d\n\t-Filename del file di log: %s\n\t-Timeout delle connessioni con i client: %d\n\t-Contenuti memorizzati nei memfd: %d\n", config.n_thread, (config.b_storage / 1000000), config.n_file_storage, config.soc_filename, config.max_conn_wait, config.max_active_conn, config.manager_timeout, config.log_filename, config.client_timeout, config.memfd_storage);
     
     memset(&sigint, 0, sizeof(sigint));
     memset(&sigquit, 0, sizeof(sigquit));
     memset(&sighup, 0, sizeof(sighup));
+    memset(&sigpipe, 0, sizeof(sigpipe));
 
     sigint.sa_handler = sigint_manager;
     sigquit.sa_handler = sigquit_manager;
     sighup.sa_handler = sihup_manager;
+    // sendfile non accetta MSG_NOSIGNAL, la chiusura della connessione da parte del client è rilevata tramite EPIPE
+    sigpipe.sa_handler = SIG_IGN;
 
     if(sigaction(SIGINT, &sigint, NULL) == -1) {
         printf("Manager:");
@@ -167,6 +184,13 @@ int main(int argc, char *argv[]){
         return -1;
     }
 
+    if(sigaction(SIGPIPE, &sigpipe, NULL) == -1) {
+        printf("Manager:");
+        perror("Ignorando SIGPIPE");
+
+        return -1;
+    }
+
     // Crea un socket non bloccante
     fd_socket = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
 
@@ -187,46 +211,58 @@ int main(int argc, char *argv[]){
 
     printf("MANAGER: Socket creato con successo\n");
 
-    // Alloca e inizializza l'array che contiene i file descriptor delle connessioni aperte
-    fds = init_fds(config.max_active_conn, &client_lu);
-    fds[0].fd = fd_socket;
-    fds[0].events = POLLIN;
+    // Inizializza il gestore delle connessioni e registra il socket di ascolto
+    if(init_conn_manager(&conns, fd_socket, config.max_active_conn, config.client_timeout, &storage) == -1) {
+        perror("MANAGER: Inizializzando epoll");
+
+        return -1;
+    }
+
+    // Le code sono preallocate, ogni connessione attiva ha al più PIPELINE_DEPTH richieste non ancora soddisfatte, che occupano in tutto al più PIPELINE_DEPTH elementi delle due code
+    if(init_request_queue(&requests, config.max_active_conn * PIPELINE_DEPTH) == -1 || init_resolved_queue(&resolved_requests, config.max_active_conn * PIPELINE_DEPTH) == -1) {
+        perror("MANAGER: Inizializzando le code delle richieste");
+
+        return -1;
+    }
+
+    // I worker segnalano le richieste elaborate sull'eventfd, che risveglia il manager
+    if(conn_notify(&conns, resolved_requests.notify_fd) == -1) {
+        perror("MANAGER: Inizializzando la notifica delle richieste elaborate");
+
+        return -1;
+    }
+
+    // Inizializza il logger, con un buffer dedicato per ogni worker
+    if(init_logger(&log, config.log_filename, config.n_thread) == -1) {
+        perror("Inizializzando il file di log");
+
+        return -1;
+    }
 
     // Inizializza lo storage
-    ht = malloc((int)((config.n_file_storage * 1.3) + 1) * sizeof(f_el*));
-    for(i = 0; i < (int)((config.n_file_storage * 1.3) + 1); i++) {
-        ht[i] = NULL;
+    if(init_storage(&storage, config.b_storage, config.n_file_storage, &log, config.memfd_storage) == -1) {
+        perror("Inizializzando lo storage");
+
+        return -1;
     }
-    storage.size.size_bytes = config.b_storage;
-    storage.size.size_n = config.n_file_storage;
-    storage.size.size_ht = (int)(((int)config.n_file_storage * 1.3) + 1);
-    storage.size.occupied_bytes = 0;
-    storage.size.occupied_size_n = 0;
-    storage.ht = ht;
-    storage.statistics.max_stored_bytes = 0;
-    storage.statistics.max_stored_files = 0;
-    storage.statistics.replaced_files = 0;
-    storage.log_filename = config.log_filename;
 
     //Alloca l'array per contenere i riferimenti ai thread worker presenti nel thread pool
     workers = malloc(config.n_thread * sizeof(pthread_t));
     served_request = malloc(config.n_thread * sizeof(pthread_t));
 
-    // Alloca e inizializza gli argomenti dei thread worker
-    args = malloc(sizeof(worker_arg));
-    args->head_request = &head_request;
-    args->head_resolved = &head_resolved;
-    args->tail_resolved = &tail_resolved;
-    args->storage = &storage;
-    args->max_conn = config.max_active_conn;
+    // Alloca gli argomenti dei thread worker, ogni worker riceve la propria struct in modo che il numero identificativo non sia sovrascritto dalle creazioni successive
+    args = malloc(config.n_thread * sizeof(worker_arg));
 
     // Crea e avvia i thread worker del thread pool
     for(i = 0; i < config.n_thread; i++) {
-        args->thread_n = i;
+        args[i].requests = &requests;
+        args[i].resolved = &resolved_requests;
+        args[i].storage = &storage;
+        args[i].thread_n = i;
         served_request[i] = 0;
-        args->served_request = served_request + i;
+        args[i].served_request = served_request + i;
 
-        if((errno = pthread_create(&(workers[i]), NULL, &main_worker, args)) != 0) {
+        if((errno = pthread_create(&(workers[i]), NULL, &main_worker, &args[i])) != 0) {
             perror("MANAGER: Creando i thread worker");
         }
     }
@@ -238,13 +274,14 @@ int main(int argc, char *argv[]){
         if(rcvd_signal == SIGINT || rcvd_signal == SIGQUIT) {
             terminate = 1;
 
+            conn_unlisten(&conns);
             close(fd_socket);
         } else if(rcvd_signal == SIGHUP){
             if(active_conn == 0) {
                 terminate = 2;
 
+                conn_unlisten(&conns);
                 close(fd_socket);
-                fds[0].fd = -1;
             }
 
             memset(&sigint, 0, sizeof(sigint));
@@ -267,175 +304,241 @@ int main(int argc, char *argv[]){
         }
 
         if(terminate != 1) {
-            // Verifica se qualche connessione è pronta per poter essere letta
-            poll_result = poll(fds, config.max_active_conn + 1, config.manager_timeout);
+            // Attende i soli eventi pronti, il costo non dipende dal numero massimo di connessioni
+            // Il timeout serve solo per la scadenza delle connessioni e per i segnali, le richieste elaborate risvegliano il manager tramite l'eventfd
+            n_events = conn_wait(&conns, config.manager_timeout);
 
-            if(poll_result == -1) {
+            if(n_events == -1) {
                 if(errno != EINTR) {
-                    perror("MANAGER: Polling");
+                    perror("MANAGER: Attendendo gli eventi");
                 }
             }
 
-            if(poll_result > 0) {
-                if(fds[0].fd != -1 && active_conn < config.max_active_conn) {
-                    if(fds[0].revents == POLLIN) {
-                        n_fd_socket = accept(fd_socket, NULL, 0);
+            for(i = 0; i < n_events; i++) {
+                if(conns.events[i].data.u32 == CONN_NOTIFY) {
+                    // Le richieste elaborate sono estratte subito dopo, il contatore è azzerato prima in modo da non perdere le segnalazioni successive
+                    drain_resolved_notify(&resolved_requests);
+                } else if(conns.events[i].data.u32 == CONN_LISTENER) {
+                    // Accetta tutte le connessioni in attesa finchè non si raggiunge il numero massimo di connessioni attive
+                    while(active_conn < config.max_active_conn) {
+                        // Il socket della connessione è non bloccante, in modo che sendfile non blocchi il manager
+                        n_fd_socket = accept4(fd_socket, NULL, 0, SOCK_NONBLOCK);
 
                         if(n_fd_socket == -1) {
                             if(errno != EAGAIN && errno != EWOULDBLOCK) {
                                 perror("MANAGER: Accettando una nuova connessione");
                             }
-                        } else {
-                            printf("MANAGER: Nuova connessione accettata, il nuovo descrittore del socket è: %d\n", n_fd_socket);
 
-                            i = add_fd(fds, n_fd_socket, config.max_active_conn);
+                            break;
+                        }
 
-                            client_lu[i] = time(NULL);
+                        printf("MANAGER: Nuova connessione accettata, il nuovo descrittore del socket è: %d\n", n_fd_socket);
 
-                            active_conn++;
+                        if(conn_add(&conns, n_fd_socket) == -1) {
+                            perror("MANAGER: Registrando una nuova connessione");
 
-                            if(active_conn > stat_max_conn) {
-                                stat_max_conn = active_conn;
-                            }
+                            close(n_fd_socket);
+
+                            continue;
                         }
-                    }
-                }
 
-                // Cerca i file descriptor che sono pronti per la lettura
-                for(i = 1; i < config.max_active_conn + 1; i++) {
-                    if(fds[i].revents == POLLIN) {
-                        // Serve per evitare che il manager vada a chiudere una connessione in uso da parte dei worker nel caso in cui l'operazione richiedesse un tempo maggiore al timeout
-                        client_lu[i] = -1;
+                        active_conn++;
 
-                        // Si inseriscono i file descriptor nella coda delle richieste
-                        if(push_request(&head_request, &tail_request, fds[i].fd) == NULL) {
-                            perror("MANAGER: Inserendo una nuova richiesta");
+                        if(active_conn > stat_max_conn) {
+                            stat_max_conn = active_conn;
                         }
-
-                        // Si ignora il file descriptor per successive call di poll
-                        fds[i].fd = -fds[i].fd;
                     }
-                }
-            }
-
-            errno = 0;
-            resolved = pop_resolved(&head_resolved);
-            while(resolved.resolved_fd != -1) {
-                if(resolved.close) {
-                    printf("MANAGER: La connessione con %d è chiusa\n", resolved.resolved_fd);
-
-                    close(resolved.resolved_fd);
-
-                    // Qui non serve inizializzare client_lu in quanto prima di passare il descrittore ai worker la corrispondente cella in client_lu è impostata a -1
-                    clean_closed_conn(&storage, resolved.resolved_fd, config.max_active_conn);
 
-                    close_conn(fds, resolved.resolved_fd, config.max_active_conn);
+                    if(active_conn == config.max_active_conn) {
+                        // Le connessioni in attesa rimangono nella coda del socket di ascolto finchè non si libera uno slot
+                        conn_listen(&conns, 0);
+                    }
+                } else {
+                    slot = conns.events[i].data.u32;
+                    fd = conns.conns[slot].fd;
 
-                    active_conn--;
+                    if(conns.conns[slot].broken) {
+                        // La connessione sarà chiusa quando i worker termineranno le sue richieste
+                        continue;
+                    }
 
-                    printf("MANAGER: Rimangono %d connessioni attive\n", active_conn);
-                } else {
-                    for(i = 1; i < config.max_active_conn + 1; i++) {
-                        if(-fds[i].fd == resolved.resolved_fd) {
-                            fds[i].fd = -fds[i].fd;
+                    // La connessione è disattivata da EPOLLONESHOT, il manager riceve senza bloccarsi le richieste disponibili finchè la connessione può riceverne altre
+                    // Le richieste sono assegnate ai worker appena ricevute, senza attendere le risposte alle precedenti
+                    result = 0;
+                    while(conn_readable(&conns, slot) && (result = conn_read(&conns, slot, &req)) == 1) {
+                        if(conn_dispatch(&conns, slot, req)) {
+                            submit_request(&conns, &requests, slot, req);
+                        }
+                    }
 
-                            client_lu[i] = time(NULL);
+                    if(result == -1) {
+                        if(errno != ECONNRESET) {
+                            printf("MANAGER: Errore socket: %d ", fd);
+                            perror("Ricevendo la richiesta");
                         }
+
+                        conn_fail(&conns, slot);
                     }
-                }
 
-                resolved = pop_resolved(&head_resolved);
+                    serve_conn(&conns, &storage, &requests, slot, &active_conn);
+                }
             }
 
-            if(resolved.resolved_fd == -1 && errno != 0) {
-                perror("MANAGER: Leggendo la coda delle richieste risolte");
-            }
+            // Estrae le richieste risolte a blocchi, finchè la coda non è vuota
+            while((n_resolved = pop_resolved(&resolved_requests, resolved, MANAGER_BATCH)) > 0) {
+                for(i = 0; i < n_resolved; i++) {
+                    // Una connessione non viene chiusa finchè i worker elaborano le sue richieste
+                    if((slot = conn_find(&conns, resolved[i].fd)) == -1) {
+                        response_free(resolved[i].data);
 
-            // Verifica se il timer è scaduto per qualche connessione
-            actual_time = time(NULL);
-            for(i = 0; i < config.max_active_conn; i++) {
-                if(client_lu[i] != -1 && (actual_time - client_lu[i]) >= config.client_timeout) {
-                    printf("MANAGER: La connessione con %d è chiusa per timeout\n", fds[i].fd);
+                        continue;
+                    }
 
-                    close(fds[i].fd);
+                    conn_resolve(&conns, slot, resolved[i].data, resolved[i].close);
 
-                    client_lu[i] = -1;
+                    // Invia subito quanto il socket accetta, il resto delle risposte è inviato quando la connessione è notificata per la scrittura
+                    serve_conn(&conns, &storage, &requests, slot, &active_conn);
+                }
+            }
 
-                    clean_closed_conn(&storage, -fds[i].fd, config.max_active_conn);
+            // I worker hanno deallocato le richieste elaborate, le connessioni in attesa del budget di ricezione riprendono a ricevere se il budget lo consente
+            while((fd = conn_next_unstalled(&conns)) != -1) {
+                if(conn_rearm(&conns, fd) == -1) {
+                    perror("MANAGER: Riattivando una connessione");
+                }
+            }
 
-                    close_conn(fds, -fds[i].fd, config.max_active_conn);
+            // Chiude le connessioni il cui timer è scaduto, la timer wheel esamina solo le connessioni in scadenza
+            while((fd = conn_next_expired(&conns, time(NULL))) != -1) {
+                printf("MANAGER: La connessione con %d è chiusa per timeout\n", fd);
 
-                    active_conn--;
+                close_conn(&conns, &storage, fd, &active_conn);
+            }
 
-                    printf("MANAGER: Rimangono %d connessioni attive\n", active_conn);
-                }
+            if(active_conn < config.max_active_conn && conn_listen(&conns, 1) == -1) {
+                perror("MANAGER: Riattivando il socket di ascolto");
             }
         }
     }
 
-    // Operazioni per la terminazione del server
+    // Operazioni per la terminazione del server, la chiusura della coda risveglia i worker in attesa che terminano dopo la richiesta in corso
+    close_request_queue(&requests);
+
     for(i = 0; i < config.n_thread; i++) {
-        pthread_cancel(workers[i]);
         pthread_join(workers[i], NULL);
         printf("MANAGER: Worker %d, terminato\n", i);
     }
 
-    print_ht(storage.ht, storage.size.size_ht);
-
-    printf("\nStatistiche: \n");
-    printf("\t-Numero massimo di file memorizzati: %d\n", storage.statistics.max_stored_files);
-    printf("\t-Numero massimo di byte memorizzati: %fMbytes\n", (double)storage.statistics.max_stored_bytes / 1000000);
-    printf("\t-Numero di file rimpiazzati: %d\n", storage.statistics.replaced_files);
-    printf("\t-Numero di file attualmente memorizzati nello storage: %d\n", storage.size.occupied_size_n);
-    printf("\t-Numero di byte attualmente memorizzati nello storage: %fMbytes\n", (double)storage.size.occupied_bytes / 1000000);
-
-    log_file = fopen(storage.log_filename, "a");
-
-    fwrite("maxsize:", sizeof(char), 8, log_file);
-    fprintf(log_file, "%ld", storage.statistics.max_stored_bytes);
-    fwrite("\n", sizeof(char), 1, log_file);
+    // Le risposte elaborate dai worker e non ancora estratte sono deallocate senza essere inviate
+    while((n_resolved = pop_resolved(&resolved_requests, resolved, MANAGER_BATCH)) > 0) {
+        for(i = 0; i < n_resolved; i++) {
+            response_free(resolved[i].data);
+        }
+    }
 
-    fwrite("maxnsize:", sizeof(char), 9, log_file);
-    fprintf(log_file, "%d", storage.statistics.max_stored_files);
-    fwrite("\n", sizeof(char), 1, log_file);
+    print_storage(&storage);
 
-    fwrite("replacedfiles:", sizeof(char), 14, log_file);
-    fprintf(log_file, "%d", storage.statistics.replaced_files);
-    fwrite("\n", sizeof(char), 1, log_file);
+    printf("\nStatistiche: \n");
+    printf("\t-Numero massimo di file memorizzati: %d\n", atomic_load(&storage.statistics.max_stored_files));
+    printf("\t-Numero massimo di byte memorizzati: %fMbytes\n", (double)atomic_load(&storage.statistics.max_stored_bytes) / 1000000);
+    printf("\t-Numero di file rimpiazzati: %d\n", atomic_load(&storage.statistics.replaced_files));
+    printf("\t-Numero di file attualmente memorizzati nello storage: %d\n", atomic_load(&storage.size.occupied_size_n));
+    printf("\t-Numero di byte attualmente memorizzati nello storage: %fMbytes\n", (double)atomic_load(&storage.size.occupied_bytes) / 1000000);
+    printf("\t-Memoria occupata dai blocchi dell'arena, in uso o liberi: %fMbytes\n", (double)atomic_load(&storage.arena.stats.reserved) / 1000000);
+    printf("\t-Memoria dei blocchi in uso: %fMbytes, di cui richiesti: %fMbytes\n", (double)atomic_load(&storage.arena.stats.used) / 1000000, (double)atomic_load(&storage.arena.stats.requested) / 1000000);
+    printf("\t-Numero di allocazioni: %ld, riempimenti delle cache dei worker: %ld\n", atomic_load(&storage.arena.stats.allocs), atomic_load(&storage.arena.stats.refills));
+
+    // I worker sono terminati, le statistiche sono registrate sul buffer condiviso del logger
+    log_printf(&log, "maxsize:%ld\n", atomic_load(&storage.statistics.max_stored_bytes));
+    log_printf(&log, "maxnsize:%d\n", atomic_load(&storage.statistics.max_stored_files));
+    log_printf(&log, "replacedfiles:%d\n", atomic_load(&storage.statistics.replaced_files));
 
     for(i = 0; i < config.n_thread; i++) {
-        fwrite("servedrequest:", sizeof(char), 14, log_file);
-        fprintf(log_file, "%d", i);
-        fwrite(",", sizeof(char), 1, log_file);
-        fprintf(log_file, "%d", served_request[i]);
-        fwrite("\n", sizeof(char), 1, log_file);
+        log_printf(&log, "servedrequest:%d,%d\n", i, served_request[i]);
     }
 
-    fwrite("maxactiveconn:", sizeof(char), 14, log_file);
-    fprintf(log_file, "%d", stat_max_conn);
-    fwrite("\n", sizeof(char), 1, log_file);
+    log_printf(&log, "maxactiveconn:%d\n", stat_max_conn);
 
-    fclose(log_file);
+    // Scrive sul file i record ancora presenti nei buffer e chiude il file di log
+    free_logger(&log);
 
-    free_request_queue(head_request);
-    free_resolved_queue(head_resolved);
-    free_ht(storage.ht, storage.size.size_ht);
+    free_request_queue(&requests);
+    free_resolved_queue(&resolved_requests);
+
+    // Le risposte ancora in coda sulle connessioni fanno riferimento ai buffer dello storage, che viene deallocato dopo
+    free_conn_manager(&conns);
+
+    // Anche il manager alloca e rilascia blocchi dell'arena, la sua cache è svuotata come quella dei worker
+    slab_thread_flush(&storage.arena);
+    free_storage(&storage);
 
-    free(ht);
     free(workers);
-    free(fds);
-    free(client_lu);
     free(served_request);
     free(args);
 
     return 0;
 }
 
+static void close_conn(conn_manager *cm, storage *storage, int fd, int *active_conn) {
+    printf("MANAGER: La connessione con %d è chiusa\n", fd);
+
+    conn_remove(cm, fd);
+
+    clean_closed_conn(storage, fd);
+
+    close(fd);
+
+    *active_conn -= 1;
+
+    printf("MANAGER: Rimangono %d connessioni attive\n", *active_conn);
+}
+
+static void submit_request(conn_manager *cm, request_queue *requests, int slot, request *req) {
+    if(push_request(requests, req) == -1) {
+        perror("MANAGER: Inserendo una nuova richiesta");
+
+        free_request(req);
+
+        // La richiesta non riceverà risposta, il client non può più associare le risposte successive e la connessione viene chiusa
+        conn_resolve(cm, slot, NULL, 1);
+    }
+}
+
+static void serve_conn(conn_manager *cm, storage *storage, request_queue *requests, int slot, int *active_conn) {
+    request *req;
+
+    int fd = cm->conns[slot].fd;
+
+    if(!cm->conns[slot].broken && cm->conns[slot].out.head != NULL && conn_write(cm, slot) == -1) {
+        if(errno != EPIPE && errno != ECONNRESET) {
+            printf("MANAGER: Errore socket: %d ", fd);
+            perror("Inviando la risposta");
+        }
+
+        conn_fail(cm, slot);
+    }
+
+    // Le richieste sullo stesso file rimaste in attesa sono assegnate ai worker nell'ordine di arrivo, una lettura di n file riprende dopo l'invio del passo precedente
+    while((req = conn_next_ready(cm, slot)) != NULL) {
+        submit_request(cm, requests, slot, req);
+    }
+
+    if(conn_done(cm, slot)) {
+        // Lo storage è ripristinato prima della chiusura, finchè il descrittore non è riutilizzato da una nuova connessione
+        close_conn(cm, storage, fd, active_conn);
+    } else if(conn_rearm(cm, fd) == -1) {
+        perror("MANAGER: Riattivando una connessione");
+    }
+}
+
 config parse_config() {
     FILE *conf_fp;                                                  //Puntatore al file di configurazione
     char *tag_name, *value;
     config result;
 
+    // Le impostazioni opzionali hanno un valore di default se non sono presenti nel file
+    result.memfd_storage = 0;
+
     if(access(CONFIG_FN, R_OK) == -1) {
         // Verifica l'esistenza del file di configurazione
         if(errno == ENOENT) {
@@ -478,7 +581,8 @@ config parse_config() {
                 }
             }
         } else {
-            if(buffer[0] != '#') {
+            // Le righe di commento e le righe vuote sono ignorate
+            if(buffer[0] != '#' && buffer[strspn(buffer, " \t\r\n")] != '\0') {
                 tag_name = strtok(buffer, TOKEN_SYMBOL);
                 value = strtok(NULL, TOKEN_SYMBOL);
 
@@ -513,6 +617,9 @@ config parse_config() {
                 } else if(!strcmp(tag_name, "client_timeout")) {
                     result.client_timeout = (int)(strtol(value, NULL, 10));
 
+                } else if(!strcmp(tag_name, "memfd_storage")) {
+                    result.memfd_storage = (int)(strtol(value, NULL, 10));
+
                 } else {
                     printf("L'impostazione non è supportata, controlla il file di configurazione: %s\n", tag_name);
                 }
@@ -526,55 +633,3 @@ config parse_config() {
 
     return result;
 }
-
-struct pollfd *init_fds(int max, time_t **client_lu) {
-    struct pollfd *fds;
-    int i;
-
-    fds = malloc((max + 1) * sizeof(struct pollfd));
-    *client_lu = malloc((max + 1) * sizeof(time_t));
-
-    for(i = 0; i < max + 1; i++) {
-        fds[i].fd = -1;
-        fds[i].events = 0;
-        fds[i].revents = 0;
-    }
-
-    for(i = 0; i < max + 1; i++) {
-        *(*client_lu + i) = -1;
-    }
-
-
-    return fds;
-}
-
-int add_fd(struct pollfd *fds, int fd, int max) {
-    int i;
-
-    for(i = 1; i < max + 1; i++) {
-        if(fds[i].fd == -1) {
-            fds[i].fd = fd;
-            fds[i].events = POLLIN;
-
-            return i;
-        }
-    }
-
-    return -1;
-}
-
-int close_conn(struct pollfd *fds, int fd, int max) {
-    int i;
-
-    // Cerca la cella dell'array che contiene il file descriptor da rimuovere
-    for(i = 1; i < max + 1; i++) {
-        if(-fds[i].fd == fd) {
-            fds[i].fd = -1;
-            fds[i].events = 0;
-
-            return 0;
-        }
-    }
-
-    return -1;
-}
@@ -0,0 +1,661 @@
+#ifndef SLAB_MANAGER_H
+#define SLAB_MANAGER_H
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+
+#define SLAB_ALIGN 16                                       // Allineamento di ogni blocco, la dimensione di ogni classe ne è un multiplo
+#define SLAB_MIN_SIZE 32                                    // Dimensione dei blocchi della classe più piccola
+#define SLAB_MAX_SIZE (256 * 1024)                          // Dimensione dei blocchi della classe più grande, le richieste maggiori sono mappate direttamente
+#define SLAB_CLASSES 64                                     // Numero massimo di classi di dimensione
+#define SLAB_CHUNK_SIZE (2 * 1024 * 1024)                   // Dimensione di un chunk richiesto al sistema operativo, suddiviso in blocchi di una sola classe, ogni chunk è allineato alla sua dimensione
+#define SLAB_CACHE_SIZE 32                                  // Numero massimo di blocchi liberi per classe nella cache di ogni thread
+#define SLAB_CACHE_BYTES (8 * 1024)                         // Byte massimi dei blocchi liberi di una classe nella cache di ogni thread, i blocchi più grandi non sono mai in cache
+#define SLAB_PAGE_SIZE 4096                                 // Granularità dei blocchi mappati direttamente e delle pagine restituite al sistema operativo
+
+struct slab_block {
+    struct slab_block *next;                                // Il blocco libero successivo, memorizzato all'interno del blocco stesso
+};
+
+struct slab_chunk {
+    struct slab_chunk *next;                                // Il chunk successivo della stessa classe, memorizzato all'inizio del chunk
+    struct slab_chunk *prev;                                // Il chunk precedente della stessa classe
+    struct slab_chunk *avail_next;                          // Il chunk successivo della classe che contiene blocchi liberi
+    struct slab_chunk *avail_prev;                          // Il chunk precedente della classe che contiene blocchi liberi
+    struct slab_block *free;                                // I blocchi liberi del chunk non contenuti nella cache di alcun thread
+    long resident;                                          // Byte dei blocchi del chunk che occupano memoria, contati in stats.reserved
+    int live;                                               // Numero di blocchi del chunk in uso oppure nella cache di un thread, a 0 il chunk è restituito al sistema operativo
+};
+
+struct slab_class {
+    size_t size;                                            // Dimensione dei blocchi della classe
+    int depth;                                              // Numero massimo di blocchi della classe nella cache di ogni thread, 0 se i blocchi non sono mai in cache
+    struct slab_chunk *chunks;                              // Chunk ottenuti dal sistema operativo per la classe
+    struct slab_chunk *avail;                               // Chunk della classe che contengono blocchi liberi
+    char *fresh;                                            // Primo blocco mai utilizzato dell'ultimo chunk, i blocchi sono ricavati dal chunk solo quando servono
+    char *fresh_end;                                        // Fine dell'ultimo chunk
+    pthread_mutex_t lock;                                   // Lock che protegge i chunk della classe, acquisita solo per riempire o svuotare la cache di un thread
+};
+
+struct slab_stats {
+    atomic_long reserved;                                   // Byte dei blocchi che occupano memoria, in uso oppure liberi, approssimano la memoria residente usata per i file
+    atomic_long used;                                       // Byte dei blocchi in uso, arrotondati alla dimensione della classe
+    atomic_long requested;                                  // Byte richiesti dai chiamanti per i blocchi in uso
+    atomic_long allocs;                                     // Numero totale di allocazioni
+    atomic_long refills;                                    // Numero di volte in cui la cache di un thread è stata riempita dalle classi condivise
+};
+
+struct slab_arena {
+    struct slab_class classes[SLAB_CLASSES];                // Le classi di dimensione in ordine crescente
+    int n_classes;                                          // Numero di classi utilizzate
+    struct slab_stats stats;                                // Statistiche dell'arena
+};
+
+struct slab_cache {
+    struct slab_arena *arena;                               // L'arena a cui appartengono i blocchi in cache, NULL se il thread non ha ancora usato alcuna arena
+    int n[SLAB_CLASSES];                                    // Numero di blocchi in cache per ogni classe
+    struct slab_block *blocks[SLAB_CLASSES][SLAB_CACHE_SIZE];   // I blocchi liberi in cache per ogni classe
+};
+
+typedef struct slab_block slab_block;
+typedef struct slab_chunk slab_chunk;
+typedef struct slab_class slab_class;
+typedef struct slab_stats slab_stats;
+typedef struct slab_arena slab_arena;
+typedef struct slab_cache slab_cache;
+
+// Cache del thread, allocazioni e rilasci non acquisiscono alcuna lock finchè la cache non è vuota o piena
+static __thread slab_cache thread_slab_cache;
+
+// Dimensione dell'intestazione di un chunk, i blocchi iniziano subito dopo
+#define SLAB_CHUNK_HEADER ((sizeof(slab_chunk) + SLAB_ALIGN - 1) & ~(size_t)(SLAB_ALIGN - 1))
+
+/*
+ * Inizializza un'arena vuota, le classi hanno dimensioni crescenti di circa 1/4 a partire da SLAB_MIN_SIZE fino a SLAB_MAX_SIZE
+ * Parametri:
+ *      arena: l'arena da inizializzare
+ * Errno:
+ *      EINVAL: se arena == NULL
+ * Ritorna: 0 in caso di successo, -1 in caso di errore
+ */
+int init_slab_arena(slab_arena *arena);
+
+/*
+ * Restituisce al sistema operativo tutti i chunk dell'arena, i blocchi mappati direttamente devono essere già stati rilasciati
+ * Parametri:
+ *      arena: l'arena da deallocare
+ * Ritorna: none
+ */
+void free_slab_arena(slab_arena *arena);
+
+/*
+ * Restituisce la dimensione del blocco che verrebbe allocato per una richiesta di size byte, può essere usata per sfruttare l'intero blocco
+ * Parametri:
+ *      arena: l'arena
+ *      size: la dimensione richiesta
+ * Ritorna: la dimensione del blocco
+ */
+size_t slab_usable(slab_arena *arena, size_t size);
+
+/*
+ * Alloca un blocco di almeno size byte, prelevandolo dalla cache del thread se possibile
+ * Parametri:
+ *      arena: l'arena da cui allocare
+ *      size: la dimensione richiesta
+ * Errno:
+ *      ENOMEM: se non è possibile ottenere memoria dal sistema operativo
+ * Ritorna: il puntatore al blocco, NULL in caso di errore
+ */
+void *slab_alloc(slab_arena *arena, size_t size);
+
+/*
+ * Rilascia un blocco, inserendolo nella cache del thread se possibile
+ * Parametri:
+ *      arena: l'arena da cui il blocco è stato allocato
+ *      ptr: il blocco da rilasciare, se è NULL non viene eseguita alcuna operazione
+ *      size: la dimensione richiesta al momento dell'allocazione oppure la dimensione restituita da slab_usable
+ * Ritorna: none
+ */
+void slab_free(slab_arena *arena, void *ptr, size_t size);
+
+/*
+ * Restituisce alle classi condivise tutti i blocchi nella cache del thread chiamante, deve essere eseguita prima della terminazione di ogni thread
+ * Parametri:
+ *      arena: l'arena
+ * Ritorna: none
+ */
+void slab_thread_flush(slab_arena *arena);
+
+/*
+ * Restituisce la memoria che l'arena occupa senza usarla: i blocchi liberi nelle cache dei thread e nei chunk non ancora restituiti al sistema operativo
+ * Parametri:
+ *      arena: l'arena
+ * Ritorna: la memoria in byte
+ */
+long slab_idle(slab_arena *arena);
+
+/*
+ * Individua la classe più piccola che contiene blocchi di almeno size byte
+ * Parametri:
+ *      arena: l'arena
+ *      size: la dimensione richiesta
+ * Ritorna: l'indice della classe, -1 se size > SLAB_MAX_SIZE
+ */
+static int slab_class_of(slab_arena *arena, size_t size);
+
+/*
+ * Calcola le pagine interne ad un blocco libero che possono essere restituite al sistema operativo, la prima pagina contiene il collegamento al blocco successivo
+ * Solo i blocchi delle classi che non sono mai in cache restituiscono le proprie pagine
+ * Parametri:
+ *      class: la classe del blocco
+ *      block: il blocco
+ *      start: il puntatore in cui memorizzare l'inizio delle pagine
+ * Ritorna: il numero di byte delle pagine, 0 se il blocco non ne restituisce
+ */
+static size_t slab_span(slab_class *class, slab_block *block, char **start);
+
+/*
+ * Ottiene dal sistema operativo un nuovo chunk allineato alla sua dimensione, in modo che ogni blocco possa risalire al proprio chunk
+ * Parametri: none
+ * Errno:
+ *      ENOMEM: se non è possibile ottenere il chunk
+ * Ritorna: il chunk, NULL in caso di errore
+ */
+static slab_chunk *slab_map_chunk();
+
+/*
+ * Preleva un blocco libero da un chunk della classe, altrimenti un blocco mai utilizzato dell'ultimo chunk, altrimenti ottiene un nuovo chunk
+ * Deve essere eseguita possedendo la lock della classe
+ * Parametri:
+ *      arena: l'arena
+ *      class: la classe
+ * Errno:
+ *      ENOMEM: se non è possibile ottenere un nuovo chunk
+ * Ritorna: il blocco, NULL in caso di errore
+ */
+static slab_block *slab_take(slab_arena *arena, slab_class *class);
+
+/*
+ * Restituisce un blocco al proprio chunk, il chunk è restituito al sistema operativo quando tutti i suoi blocchi sono liberi
+ * Deve essere eseguita possedendo la lock della classe
+ * Parametri:
+ *      arena: l'arena
+ *      class: la classe
+ *      block: il blocco
+ * Ritorna: none
+ */
+static void slab_give(slab_arena *arena, slab_class *class, slab_block *block);
+
+/*
+ * Sposta nella cache del thread fino a metà dei blocchi che la cache della classe può contenere, ottenendo un nuovo chunk se la classe non ha blocchi liberi
+ * Parametri:
+ *      arena: l'arena
+ *      index: l'indice della classe
+ *      cache: la cache del thread
+ * Errno:
+ *      ENOMEM: se non è possibile ottenere un nuovo chunk
+ * Ritorna: il numero di blocchi spostati, -1 in caso di errore
+ */
+static int slab_refill(slab_arena *arena, int index, slab_cache *cache);
+
+/*
+ * Restituisce alla classe gli ultimi n blocchi della cache del thread
+ * Parametri:
+ *      arena: l'arena
+ *      index: l'indice della classe
+ *      cache: la cache del thread
+ *      n: il numero di blocchi da restituire
+ * Ritorna: none
+ */
+static void slab_drain(slab_arena *arena, int index, slab_cache *cache, int n);
+
+int init_slab_arena(slab_arena *arena) {
+    size_t size = SLAB_MIN_SIZE;
+    size_t step;
+    size_t depth;
+
+    if(arena == NULL) {
+        errno = EINVAL;
+
+        return -1;
+    }
+
+    arena->n_classes = 0;
+
+    while(size <= SLAB_MAX_SIZE && arena->n_classes < SLAB_CLASSES) {
+        // La cache di ogni classe contiene al più SLAB_CACHE_BYTES byte, quindi i thread non trattengono molti blocchi grandi
+        depth = SLAB_CACHE_BYTES / size;
+
+        arena->classes[arena->n_classes].size = size;
+        arena->classes[arena->n_classes].depth = depth < SLAB_CACHE_SIZE ? depth : SLAB_CACHE_SIZE;
+        arena->classes[arena->n_classes].chunks = NULL;
+        arena->classes[arena->n_classes].avail = NULL;
+        arena->classes[arena->n_classes].fresh = NULL;
+        arena->classes[arena->n_classes].fresh_end = NULL;
+        pthread_mutex_init(&arena->classes[arena->n_classes].lock, NULL);
+
+        arena->n_classes++;
+
+        // Quattro classi per ogni potenza di 2, quindi lo spreco interno di un blocco è al più circa il 25%
+        for(step = SLAB_ALIGN; step * 8 <= size; step <<= 1);
+
+        size += step;
+    }
+
+    atomic_init(&arena->stats.reserved, 0);
+    atomic_init(&arena->stats.used, 0);
+    atomic_init(&arena->stats.requested, 0);
+    atomic_init(&arena->stats.allocs, 0);
+    atomic_init(&arena->stats.refills, 0);
+
+    return 0;
+}
+
+void free_slab_arena(slab_arena *arena) {
+    slab_chunk *chunk;
+    slab_chunk *next;
+
+    int i;
+
+    for(i = 0; i < arena->n_classes; i++) {
+        for(chunk = arena->classes[i].chunks; chunk != NULL; chunk = next) {
+            next = chunk->next;
+
+            atomic_fetch_sub_explicit(&arena->stats.reserved, chunk->resident, memory_order_relaxed);
+
+            munmap(chunk, SLAB_CHUNK_SIZE);
+        }
+
+        arena->classes[i].chunks = NULL;
+        arena->classes[i].avail = NULL;
+
+        pthread_mutex_destroy(&arena->classes[i].lock);
+    }
+
+    if(thread_slab_cache.arena == arena) {
+        // I blocchi nella cache del thread chiamante appartenevano ai chunk appena restituiti
+        thread_slab_cache.arena = NULL;
+        memset(thread_slab_cache.n, 0, sizeof(thread_slab_cache.n));
+    }
+}
+
+size_t slab_usable(slab_arena *arena, size_t size) {
+    int index;
+
+    if((index = slab_class_of(arena, size)) == -1) {
+        return (size + SLAB_PAGE_SIZE - 1) & ~(size_t)(SLAB_PAGE_SIZE - 1);
+    }
+
+    return arena->classes[index].size;
+}
+
+void *slab_alloc(slab_arena *arena, size_t size) {
+    slab_cache *cache = &thread_slab_cache;
+    slab_block *block;
+
+    size_t usable;
+
+    int index;
+
+    if((index = slab_class_of(arena, size)) == -1) {
+        // I blocchi molto grandi sono mappati direttamente, in modo che la loro memoria sia restituita al sistema operativo al rilascio
+        usable = slab_usable(arena, size);
+
+        if((block = mmap(NULL, usable, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)) == MAP_FAILED) {
+            errno = ENOMEM;
+
+            return NULL;
+        }
+
+        atomic_fetch_add_explicit(&arena->stats.reserved, usable, memory_order_relaxed);
+    } else {
+        usable = arena->classes[index].size;
+
+        if(cache->arena == NULL) {
+            cache->arena = arena;
+        }
+
+        if(cache->arena == arena && arena->classes[index].depth > 0) {
+            if(cache->n[index] == 0 && slab_refill(arena, index, cache) == -1) {
+                return NULL;
+            }
+
+            block = cache->blocks[index][--cache->n[index]];
+        } else {
+            // La classe non ha cache oppure la cache del thread appartiene ad un'altra arena, il blocco è prelevato direttamente dalla classe
+            pthread_mutex_lock(&arena->classes[index].lock);
+
+            block = slab_take(arena, &arena->classes[index]);
+
+            pthread_mutex_unlock(&arena->classes[index].lock);
+
+            if(block == NULL) {
+                return NULL;
+            }
+        }
+    }
+
+    atomic_fetch_add_explicit(&arena->stats.used, usable, memory_order_relaxed);
+    atomic_fetch_add_explicit(&arena->stats.requested, size, memory_order_relaxed);
+    atomic_fetch_add_explicit(&arena->stats.allocs, 1, memory_order_relaxed);
+
+    return block;
+}
+
+void slab_free(slab_arena *arena, void *ptr, size_t size) {
+    slab_cache *cache = &thread_slab_cache;
+    slab_block *block = ptr;
+
+    size_t usable;
+
+    int index;
+
+    if(ptr == NULL) {
+        return;
+    }
+
+    usable = slab_usable(arena, size);
+
+    atomic_fetch_sub_explicit(&arena->stats.used, usable, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&arena->stats.requested, size, memory_order_relaxed);
+
+    if((index = slab_class_of(arena, size)) == -1) {
+        munmap(ptr, usable);
+
+        atomic_fetch_sub_explicit(&arena->stats.reserved, usable, memory_order_relaxed);
+
+        return;
+    }
+
+    if(cache->arena == NULL) {
+        cache->arena = arena;
+    }
+
+    if(cache->arena != arena || arena->classes[index].depth == 0) {
+        pthread_mutex_lock(&arena->classes[index].lock);
+
+        slab_give(arena, &arena->classes[index], block);
+
+        pthread_mutex_unlock(&arena->classes[index].lock);
+
+        return;
+    }
+
+    if(cache->n[index] == arena->classes[index].depth) {
+        // La cache è piena, metà dei blocchi torna alla classe in modo che gli altri thread possano riutilizzarli
+        slab_drain(arena, index, cache, (arena->classes[index].depth + 1) / 2);
+    }
+
+    cache->blocks[index][cache->n[index]++] = block;
+}
+
+void slab_thread_flush(slab_arena *arena) {
+    slab_cache *cache = &thread_slab_cache;
+
+    int i;
+
+    if(cache->arena != arena) {
+        return;
+    }
+
+    for(i = 0; i < arena->n_classes; i++) {
+        slab_drain(arena, i, cache, cache->n[i]);
+    }
+
+    cache->arena = NULL;
+}
+
+long slab_idle(slab_arena *arena) {
+    long idle;
+
+    // I due contatori sono letti in momenti diversi, la differenza è solo una stima
+    idle = atomic_load_explicit(&arena->stats.reserved, memory_order_relaxed) - atomic_load_explicit(&arena->stats.used, memory_order_relaxed);
+
+    return idle > 0 ? idle : 0;
+}
+
+static int slab_class_of(slab_arena *arena, size_t size) {
+    int low = 0;
+    int high = arena->n_classes - 1;
+    int middle;
+
+    if(size > arena->classes[high].size) {
+        return -1;
+    }
+
+    while(low < high) {
+        middle = (low + high) / 2;
+
+        if(arena->classes[middle].size < size) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+static size_t slab_span(slab_class *class, slab_block *block, char **start) {
+    uintptr_t first;
+    uintptr_t last;
+
+    if(class->depth > 0) {
+        return 0;
+    }
+
+    first = ((uintptr_t)block + sizeof(slab_block) + SLAB_PAGE_SIZE - 1) & ~(uintptr_t)(SLAB_PAGE_SIZE - 1);
+    last = ((uintptr_t)block + class->size) & ~(uintptr_t)(SLAB_PAGE_SIZE - 1);
+
+    if(last <= first) {
+        return 0;
+    }
+
+    *start = (char *)first;
+
+    return last - first;
+}
+
+static slab_chunk *slab_map_chunk() {
+    char *map;
+    char *chunk;
+
+    // Viene mappato il doppio della dimensione e sono restituite le parti che precedono e seguono il chunk allineato
+    if((map = mmap(NULL, 2 * SLAB_CHUNK_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)) == MAP_FAILED) {
+        errno = ENOMEM;
+
+        return NULL;
+    }
+
+    chunk = (char *)(((uintptr_t)map + SLAB_CHUNK_SIZE - 1) & ~(uintptr_t)(SLAB_CHUNK_SIZE - 1));
+
+    if(chunk > map) {
+        munmap(map, chunk - map);
+    }
+
+    munmap(chunk + SLAB_CHUNK_SIZE, map + SLAB_CHUNK_SIZE - chunk);
+
+    return (slab_chunk *)chunk;
+}
+
+static slab_block *slab_take(slab_arena *arena, slab_class *class) {
+    slab_chunk *chunk;
+    slab_block *block;
+
+    size_t span;
+    char *start;
+
+    if((chunk = class->avail) != NULL) {
+        block = chunk->free;
+        chunk->free = block->next;
+        chunk->live++;
+
+        if(chunk->free == NULL) {
+            // Il chunk non ha altri blocchi liberi
+            class->avail = chunk->avail_next;
+
+            if(class->avail != NULL) {
+                class->avail->avail_prev = NULL;
+            }
+        }
+
+        // Le pagine restituite al sistema operativo tornano ad occupare memoria quando il blocco viene scritto
+        if((span = slab_span(class, block, &start)) > 0) {
+            chunk->resident += span;
+
+            atomic_fetch_add_explicit(&arena->stats.reserved, span, memory_order_relaxed);
+        }
+
+        return block;
+    }
+
+    if(class->fresh == NULL || class->fresh + class->size > class->fresh_end) {
+        if((chunk = slab_map_chunk()) == NULL) {
+            return NULL;
+        }
+
+        chunk->next = class->chunks;
+        chunk->prev = NULL;
+        chunk->avail_next = NULL;
+        chunk->avail_prev = NULL;
+        chunk->free = NULL;
+        chunk->resident = 0;
+        chunk->live = 0;
+
+        if(class->chunks != NULL) {
+            class->chunks->prev = chunk;
+        }
+
+        class->chunks = chunk;
+
+        // I blocchi seguono l'intestazione del chunk, le pagine non ancora utilizzate non occupano memoria residente
+        class->fresh = (char *)chunk + SLAB_CHUNK_HEADER;
+        class->fresh_end = (char *)chunk + SLAB_CHUNK_SIZE;
+    }
+
+    chunk = (slab_chunk *)((uintptr_t)class->fresh & ~(uintptr_t)(SLAB_CHUNK_SIZE - 1));
+    chunk->live++;
+    chunk->resident += class->size;
+
+    atomic_fetch_add_explicit(&arena->stats.reserved, class->size, memory_order_relaxed);
+
+    block = (slab_block *)class->fresh;
+    class->fresh += class->size;
+
+    return block;
+}
+
+static void slab_give(slab_arena *arena, slab_class *class, slab_block *block) {
+    slab_chunk *chunk = (slab_chunk *)((uintptr_t)block & ~(uintptr_t)(SLAB_CHUNK_SIZE - 1));
+
+    size_t span;
+    char *start;
+
+    chunk->live--;
+
+    if(chunk->live == 0) {
+        // Tutti i blocchi del chunk sono liberi, il chunk è restituito al sistema operativo insieme ai blocchi mai utilizzati
+        if(chunk->free != NULL) {
+            if(chunk->avail_prev == NULL) {
+                class->avail = chunk->avail_next;
+            } else {
+                chunk->avail_prev->avail_next = chunk->avail_next;
+            }
+
+            if(chunk->avail_next != NULL) {
+                chunk->avail_next->avail_prev = chunk->avail_prev;
+            }
+        }
+
+        if(chunk->prev == NULL) {
+            class->chunks = chunk->next;
+        } else {
+            chunk->prev->next = chunk->next;
+        }
+
+        if(chunk->next != NULL) {
+            chunk->next->prev = chunk->prev;
+        }
+
+        if(class->fresh != NULL && (slab_chunk *)((uintptr_t)(class->fresh - 1) & ~(uintptr_t)(SLAB_CHUNK_SIZE - 1)) == chunk) {
+            class->fresh = NULL;
+            class->fresh_end = NULL;
+        }
+
+        atomic_fetch_sub_explicit(&arena->stats.reserved, chunk->resident, memory_order_relaxed);
+
+        munmap(chunk, SLAB_CHUNK_SIZE);
+
+        return;
+    }
+
+    // Le pagine interne di un blocco grande sono restituite subito al sistema operativo, il blocco resta nel chunk
+    if((span = slab_span(class, block, &start)) > 0) {
+        madvise(start, span, MADV_DONTNEED);
+
+        chunk->resident -= span;
+
+        atomic_fetch_sub_explicit(&arena->stats.reserved, span, memory_order_relaxed);
+    }
+
+    if(chunk->free == NULL) {
+        // Il chunk torna ad avere blocchi liberi
+        chunk->avail_prev = NULL;
+        chunk->avail_next = class->avail;
+
+        if(class->avail != NULL) {
+            class->avail->avail_prev = chunk;
+        }
+
+        class->avail = chunk;
+    }
+
+    block->next = chunk->free;
+    chunk->free = block;
+}
+
+static int slab_refill(slab_arena *arena, int index, slab_cache *cache) {
+    slab_class *class = &arena->classes[index];
+    slab_block *block;
+
+    pthread_mutex_lock(&class->lock);
+
+    while(cache->n[index] < (class->depth + 1) / 2 && (block = slab_take(arena, class)) != NULL) {
+        cache->blocks[index][cache->n[index]++] = block;
+    }
+
+    pthread_mutex_unlock(&class->lock);
+
+    if(cache->n[index] == 0) {
+        return -1;
+    }
+
+    atomic_fetch_add_explicit(&arena->stats.refills, 1, memory_order_relaxed);
+
+    return cache->n[index];
+}
+
+static void slab_drain(slab_arena *arena, int index, slab_cache *cache, int n) {
+    slab_class *class = &arena->classes[index];
+
+    if(n == 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&class->lock);
+
+    while(n > 0) {
+        slab_give(arena, class, cache->blocks[index][--cache->n[index]]);
+
+        n--;
+    }
+
+    pthread_mutex_unlock(&class->lock);
+}
+
+#endif
@@ -1,51 +1,208 @@
+#ifndef STORAGE_MANAGER_H
+#define STORAGE_MANAGER_H
+
 #include <time.h>
+#include <stdatomic.h>
 
 #include "definitions.h"
 #include "ht_manager.h"
+#include "owner_manager.h"
+#include "log_manager.h"
 
 #define UNIX_PATH_MAX 108
+#define STORAGE_SHARDS 16                                   // Numero di partizioni indipendenti in cui è suddiviso lo storage, deve essere una potenza di 2
 
 struct statistics {
-    long max_stored_bytes;                                  // Il numero massimo di byte memorizzati nello storage
-    int max_stored_files;                                   // Il numero massimo di file memorizzati nello storage
-    int replaced_files;                                     // il numero di file rimpiazzati
+    atomic_long max_stored_bytes;                           // Il numero massimo di byte memorizzati nello storage
+    atomic_int max_stored_files;                            // Il numero massimo di file memorizzati nello storage
+    atomic_int replaced_files;                              // il numero di file rimpiazzati
 };
 
 struct size {
     long size_bytes;                                        // Dimensione massima dello storage in byte
     int size_n;                                             // Numero massimo di file che possono essere contenuti nello storage
 
-    int size_ht;                                            // Dimensione dell'array che modella l'hash table
+    atomic_long occupied_bytes;                             // Byte occupati nello storage, include i byte riservati dalle scritture in corso
+    atomic_int occupied_size_n;                             // Numero di file presenti nello storage, include i file riservati dalle creazioni in corso
+};
+
+struct shard {
+    struct hash_table ht;                                   // Hash table ridimensionabile che contiene i file della partizione
+    struct owner_index owners;                              // File aperti e lock possedute da ogni connessione, limitatamente ai file della partizione
+
+    long occupied_bytes;                                    // Byte occupati nella partizione
+    int occupied_size_n;                                    // Numero di file presenti nella partizione
 
-    long occupied_bytes;                                    // Byte occupati nello storage
-    int occupied_size_n;                                    // Numero di file presenti nello storage
+    struct lru_list lru;                                    // Lista dei file della partizione che occupano spazio, ordinata per ultimo utilizzo, usata per la selezione delle vittime
+    pthread_rwlock_t lock;                                  // Lock che protegge la partizione, condivisa dalle letture ed esclusiva per le modifiche
 };
 
 struct storage{
-    struct f_el **ht;                                       // Array di puntatori a file che modella l'hash tabel
+    struct shard *shards;                                   // Array delle partizioni dello storage, un file appartiene alla partizione individuata dai bit alti del suo hash
+    int n_shards;                                           // Numero di partizioni dello storage
     struct size size;                                       // Struct contenente tutte le dimensioni dello storage
     struct statistics statistics;                           // Struct contenente tutte le statistiche dello storage
-    char *log_filename;                                     // Il filename del file di log
+    struct slab_arena arena;                                // Arena da cui sono allocati i file e i loro contenuti, condivisa da tutte le partizioni
+    logger *log;                                            // Il logger su cui sono registrate le operazioni
+    int memfd;                                              // 1 se i contenuti di almeno DATA_MEMFD_MIN byte sono memorizzati in un memfd, per essere inviati con sendfile
 };
 
+struct read_cursor {
+    int shard;                                              // La prossima partizione da visitare
+    int remaining;                                          // Numero di file ancora da leggere, -1 se devono essere letti tutti i file
+};
+
+typedef struct shard shard;
 typedef struct storage storage;
+typedef struct read_cursor read_cursor;
+
+// Interfacce funzioni di gestione dello storage
+/*
+ * Inizializza lo storage suddividendolo in STORAGE_SHARDS partizioni, ognuna con la propria hash table e la propria mutex
+ * Parametri:
+ *      storage: lo storage da inizializzare
+ *      size_bytes: la dimensione massima dello storage in byte
+ *      size_n: il numero massimo di file che possono essere contenuti nello storage
+ *      log: il logger su cui registrare le operazioni, già inizializzato
+ *      memfd: 1 se i contenuti di almeno DATA_MEMFD_MIN byte devono essere memorizzati in un memfd, 0 altrimenti
+ * Errno:
+ *      EINVAL: se storage == NULL oppure size_n <= 0 oppure log == NULL
+ * Ritorna: 0 in caso di successo, -1 in caso di errore
+ */
+int init_storage(storage *storage, long size_bytes, int size_n, logger *log, int memfd);
+
+/*
+ * Dealloca tutti i file e le partizioni dello storage
+ * Parametri:
+ *      storage: lo storage da deallocare
+ * Ritorna: none
+ */
+void free_storage(storage *storage);
+
+/*
+ * Visualizza sullo standard output il filename dei file contenuti nello storage
+ * Parametri:
+ *      storage: lo storage da visualizzare
+ * Ritorna: none
+ */
+void print_storage(storage *storage);
+
+/*
+ * Restituisce la partizione dello storage che contiene, o che conterrà, il file con l'hash specificato
+ * Parametri:
+ *      storage: lo storage in cui cercare la partizione
+ *      hash: l'hash del filename del file, calcolato con hash_filename
+ * Ritorna: il puntatore alla partizione
+ */
+shard *get_shard(storage *storage, uint64_t hash);
+
+/*
+ * Acquisisce in modo esclusivo la lock della partizione specificata oppure, se all == 1, le lock di tutte le partizioni in ordine crescente di indice
+ * L'ordine di acquisizione è sempre lo stesso, quindi non sono possibili deadlock tra operazioni sulla singola partizione e operazioni sull'intero storage
+ * Parametri:
+ *      storage: lo storage che contiene le partizioni
+ *      shard: la partizione da acquisire, ignorata se all == 1
+ *      all: 1 se devono essere acquisite tutte le partizioni, 0 altrimenti
+ * Ritorna: 0 in caso di successo, il codice di errore di pthread_rwlock_wrlock altrimenti
+ */
+int storage_lock(storage *storage, shard *shard, int all);
+
+/*
+ * Acquisisce in modo condiviso la lock della partizione specificata oppure, se all == 1, le lock di tutte le partizioni in ordine crescente di indice
+ * Più letture possono possedere la stessa partizione, le operazioni eseguite non devono modificare le hash table né le liste LRU
+ * Parametri:
+ *      storage: lo storage che contiene le partizioni
+ *      shard: la partizione da acquisire, ignorata se all == 1
+ *      all: 1 se devono essere acquisite tutte le partizioni, 0 altrimenti
+ * Ritorna: 0 in caso di successo, il codice di errore di pthread_rwlock_rdlock altrimenti
+ */
+int storage_rdlock(storage *storage, shard *shard, int all);
+
+/*
+ * Rilascia le lock acquisite con storage_lock oppure con storage_rdlock
+ * Parametri:
+ *      storage: lo storage che contiene le partizioni
+ *      shard: la partizione da rilasciare, ignorata se all == 1
+ *      all: 1 se devono essere rilasciate tutte le partizioni, 0 altrimenti
+ * Ritorna: none
+ */
+void storage_unlock(storage *storage, shard *shard, int all);
+
+/*
+ * Riserva in modo atomico bytes byte dello spazio globale dello storage, senza acquisire alcuna mutex
+ * Parametri:
+ *      storage: lo storage in cui riservare lo spazio
+ *      bytes: il numero di byte da riservare
+ * Errno:
+ *      EAGAIN: se lo spazio libero non è sufficiente, in questo caso è necessario espellere dei file acquisendo tutte le partizioni
+ * Ritorna: 0 in caso di successo, -1 se lo spazio non è stato riservato
+ */
+int reserve_bytes(storage *storage, long bytes);
+
+/*
+ * Restituisce lo spazio dello storage ancora disponibile per il contenuto dei file
+ * La memoria che l'arena occupa senza usarla, vedi slab_idle, è sottratta allo spazio, quindi lo storage limita la memoria residente e non solo quella dei file
+ * Parametri:
+ *      storage: lo storage
+ * Ritorna: lo spazio disponibile in byte, negativo se la memoria occupata supera la dimensione dello storage
+ */
+long storage_available(storage *storage);
 
-pthread_mutex_t lock_storage = PTHREAD_MUTEX_INITIALIZER;
+/*
+ * Riserva in modo atomico un file nel numero massimo di file dello storage, senza acquisire alcuna mutex
+ * Parametri:
+ *      storage: lo storage in cui riservare il file
+ * Errno:
+ *      EAGAIN: se lo storage contiene già il numero massimo di file, in questo caso è necessario espellere un file acquisendo tutte le partizioni
+ * Ritorna: 0 in caso di successo, -1 se il file non è stato riservato
+ */
+int reserve_file(storage *storage);
+
+/*
+ * Aggiorna in modo atomico un valore massimo
+ * Parametri:
+ *      max: il massimo da aggiornare
+ *      value: il nuovo valore da confrontare con il massimo
+ * Ritorna: none
+ */
+void update_max_long(atomic_long *max, long value);
+
+/*
+ * Aggiorna in modo atomico un valore massimo
+ * Parametri:
+ *      max: il massimo da aggiornare
+ *      value: il nuovo valore da confrontare con il massimo
+ * Ritorna: none
+ */
+void update_max_int(atomic_int *max, int value);
+
+/*
+ * Seleziona il file usato meno di recente dell'intero storage, confrontando le teste delle liste LRU delle partizioni, richiede il possesso di tutte le partizioni
+ * Parametri:
+ *      storage: lo storage in cui cercare la vittima
+ *      exonerated: un file esonerato dalla possibile espulsione
+ * Ritorna: il puntatore al file scelto come vittima, NULL se non esiste alcun file che può essere espulso
+ */
+f_el *select_storage_victim(storage *storage, f_el *exonerated);
 
 // Interfacce funzioni di supporto
 /*
- * Crea un nuovo file e lo inserisce nella hash table
+ * Crea un nuovo file e lo inserisce nella hash table della partizione specificata
  * Parametri:
  *      storage: lo storage in cui inserire il nuovo file
+ *      shard: la partizione che deve contenere il file, la sua mutex deve essere posseduta
  *      filename: il filename da associare al file
- *      max: il numero massimo di connessioni contemporaneamente attive
+ *      hash: l'hash del filename, calcolato con hash_filename
+ *      all: 1 se sono possedute le mutex di tutte le partizioni, necessario per espellere un file nel caso in cui lo storage sia pieno
  * Errno:
- *      EINVAL: se storage == NULL oppure filename == NULL oppure se max < 0
+ *      EINVAL: se storage == NULL oppure shard == NULL oppure filename == NULL
  *      EEXIST: se esiste già un file con il filename specificato
+ *      EAGAIN: se lo storage contiene il numero massimo di file e all == 0
+ *      ENOMEM: se lo storage contiene il numero massimo di file e nessuno di questi può essere espulso
  * Ritorna: il puntatore ad un eventuale file vittima, oppure NULL in caso di errore o nel caso non ci sia alcuna vittima
  *          è necessario verificare errno per distinguere i due casi
  */
-f_el *create_file(storage *storage, char *filename, int max);
+f_el *create_file(storage *storage, shard *shard, char *filename, uint64_t hash, int all);
 
 /*
  * Elimina un file dallo storage
@@ -59,44 +216,121 @@ f_el *create_file(storage *storage, char *filename, int max);
  */
 int delete_file(storage *storage, f_el *victim);
 
+/*
+ * Rimuove un file dallo storage senza deallocarlo, il file e il suo buffer passano al chiamante che deve rilasciarli con release_victims
+ * Parametri:
+ *      storage: lo storage da cui rimuovere il file
+ *      victim: il file che deve essere rimosso
+ * Errno:
+ *      EINVAL: se storage == NULL oppure victim == NULL
+ *      ENOENT: se il file specificato non esiste nello storage
+ * Ritorna: 0 in caso di successo, -1 in caso di errore
+ */
+int detach_file(storage *storage, f_el *victim);
+
+/*
+ * Rilascia una lista di file espulsi, restituendo all'arena i file e, se non sono più referenziati, i loro buffer
+ * Parametri:
+ *      storage: lo storage da cui i file sono stati espulsi
+ *      victims: la lista dei file espulsi, collegati tramite metadata.lru_next, può essere NULL
+ * Ritorna: none
+ */
+void release_victims(storage *storage, f_el *victims);
+
+/*
+ * Alloca il buffer che conterrà il nuovo contenuto di un file, il contenuto ha già dimensione size ma i suoi byte devono essere scritti dal chiamante
+ * Se lo storage memorizza i contenuti nei memfd e il contenuto ha almeno DATA_MEMFD_MIN byte il buffer è memorizzato in un memfd,
+ * se la creazione del memfd fallisce, ad esempio per il limite di descrittori aperti, il buffer è allocato nell'arena
+ * Il contenuto occupa un solo chunk, quindi i suoi byte sono contigui a partire da base
+ * Parametri:
+ *      storage: lo storage che conterrà il file
+ *      size: la dimensione in byte del contenuto
+ * Errno:
+ *      EINVAL: se size < 0
+ *      ENOMEM: se non è possibile allocare il buffer
+ * Ritorna: il puntatore al buffer, NULL in caso di errore
+ */
+f_data *alloc_content(storage *storage, int size);
+
+/*
+ * Alloca il buffer che conterrà il nuovo contenuto di un file e vi copia content, vedi alloc_content
+ * Parametri:
+ *      storage: lo storage che conterrà il file
+ *      content: il contenuto da copiare nel buffer
+ *      size: la dimensione in byte di content
+ * Errno:
+ *      EINVAL: se content è NULL oppure size < 0
+ *      ENOMEM: se non è possibile allocare il buffer
+ * Ritorna: il puntatore al buffer, NULL in caso di errore
+ */
+f_data *create_content(storage *storage, const char *content, int size);
+
+/*
+ * Stima la memoria occupata dal buffer che alloc_content allocherebbe per un contenuto di size byte
+ * Se il buffer può essere memorizzato in un memfd la stima è la maggiore tra le due allocazioni, così un ripiego sull'arena non supera la memoria addebitata
+ * Parametri:
+ *      storage: lo storage che conterrà il file
+ *      size: la dimensione in byte del contenuto
+ * Ritorna: la memoria in byte
+ */
+long content_footprint(storage *storage, int size);
+
+/*
+ * Aggiorna il momento dell'ultimo utilizzo del file e la sua posizione nella lista LRU dello storage
+ * Un file che non occupa spazio nello storage viene rimosso dalla lista, un file che torna ad occuparlo viene reinserito come il più recente
+ * Deve essere eseguita possedendo in modo esclusivo la partizione che contiene il file, dopo l'aggiornamento di metadata.charged
+ * Parametri:
+ *      storage: lo storage che contiene il file
+ *      file: il file utilizzato
+ * Ritorna: none
+ */
+void touch_file(storage *storage, f_el *file);
+
+/*
+ * Aggiorna solo il momento dell'ultimo utilizzo del file, senza modificare la lista LRU
+ * Può essere eseguita possedendo la partizione in modo condiviso, il file riceverà una seconda possibilità alla successiva selezione di una vittima
+ * Parametri:
+ *      file: il file utilizzato
+ * Ritorna: none
+ */
+void mark_used(f_el *file);
+
 /*
  * Verifica se il file è stato aperto dal client connesso attraverso il socket descritto da socket_fd
  * Parametri:
  *      file: il file su cui eseguire la verifica
  *      socket_fd: il descrittore del socket su cui eseguire la verifica
- *      max: il numero massimo di connessioni contemporaneamente attive
  * Errno:
- *      EINVAL: se file == NULL oppure socket_fd < 0 oppure max < 0
+ *      EINVAL: se file == NULL oppure socket_fd < 0
  * Ritorna: 0 se il file non è stato aperto da quel client, 1 in caso contrario
  */
-int check_opened(f_el *file, int socket_fd, int max);
+int check_opened(f_el *file, int socket_fd);
 
 /*
- * Apre il file inserendo il "socket_fd" nell'array "opened" del file
+ * Apre il file inserendo il "socket_fd" nell'insieme delle connessioni del file
  * Parametri:
  *      storage: lo storage che contiene il file da aprire
  *      file: il file da aprire
  *      socket_fd: il descrittore del socket su cui è stata ricevuta la richiesta di apertura
- *      max: il numero massimo di connessioni contemporaneamente attive
  *      log: 1 se bisogna scrivere nel file di lock, 0 altrimenti
  * Errno:
- *      EINVAL: se storage == NULL oppure file == NULL oppure socket_fd == NULL oppure max < 0
+ *      EINVAL: se storage == NULL oppure file == NULL oppure socket_fd == NULL
+ *      ENOMEM: se non è possibile registrare l'apertura
  * Ritorna: 1 in caso di successo, 0 in caso di errore
  */
-int open_file(storage *storage, f_el *file, int socket_fd, int max, int log);
+int open_file(storage *storage, f_el *file, int socket_fd, int log);
 
 /*
- * Chiude il file rimuovendo il "socket_fd" dall'array "opened" del file
+ * Chiude il file rimuovendo il "socket_fd" dall'insieme delle connessioni del file
  * Parametri:
  *      storage: lo storage che contiente il file da chiudere
  *      file: il file da chiudere
  *      socket_fd: il descrittore del socket su cui è stata ricevuta la richiesta di chiusura
- *      max: il numero massimo di connessioni contemporaneamente attive
  * Errno:
- *      EINVAL: se storage == NULL oppure file == NULL oppure socket_fd == NULL oppure max < 0
+ *      EINVAL: se storage == NULL oppure file == NULL oppure socket_fd == NULL
  * Ritorna: 0 in caso di successo, -1 in caso di errore
  */
-int close_file(storage *storage, f_el *file, int socket_fd, int max);
+int close_file(storage *storage, f_el *file, int socket_fd);
 
 /*
  * Verifica se la lock sul file è ottenuta dal client connesso al server con il socket con descrittore "socket_fd"
@@ -119,6 +353,7 @@ int check_locked(f_el *file, int socket_fd);
  * Errno:
  *      EINVAL: se storage == NULL oppure file == NULL oppure socket_fd < 0
  *      EPERM: se la lock sul file è già posseduta da un altro utente
+ *      ENOMEM: se non è possibile registrare la lock nell'indice delle connessioni
  * Ritorna: 0 in caso di successo, -1 in caso di errore
  */
 int lock_file(storage *storage, f_el *file, int socket_fd, int lock_type);
@@ -137,56 +372,54 @@ int lock_file(storage *storage, f_el *file, int socket_fd, int lock_type);
 int unlock_file(storage *storage, f_el *file, int socket_fd);
 
 /*
- * Rimpiazza n file fino a svuotare un quantitativo di memoria >= required_space
+ * Rimpiazza n file fino a svuotare un quantitativo di memoria >= required_space, richiede il possesso di tutte le partizioni
  * Parametri:
  *      storage: lo storage in cui liberare la memoria
  *      required_space: il quantitativo di memoria richiesto
  *      exonerated: eventuale file da non considerare come file vittima
  * Errno:
- *      EINVAL: se storage == NULL oppure required_space <= 0 oppure storage->ht == NULL
+ *      EINVAL: se storage == NULL oppure required_space <= 0 oppure storage->shards == NULL
  *      ENOMEM: se required_space è maggiore della dimensione massima dello storage
- * Ritorna: un array contenente i file scelti come vittima, NULL in caso di errore 
+ * Ritorna: la lista dei file espulsi collegati tramite metadata.lru_next, NULL se nessun file è stato espulso oppure in caso di errore, verificare errno per distinguere i due casi
+ *          I file espulsi conservano il proprio buffer, che viene inviato al client senza essere copiato, il chiamante deve rilasciarli con release_victims
  */
-f_el *replace_files(storage *storage, long required_space, char *exonerated);
+f_el *replace_files(storage *storage, long required_space, f_el *exonerated);
 
 /*
- * Rimpiazza un file
+ * Rimpiazza un file, richiede il possesso di tutte le partizioni
  * Parametri:
  *      storage: lo storage in cui rimpiazzare il file
  * Errno:
- *      EINVAL: se storage == NULL oppure storage->ht == NULL
+ *      EINVAL: se storage == NULL oppure storage->shards == NULL
  *      EPERM: se non c'è un file da selezionare come vittima nello storage
- * Ritorna: il puntatore al file scelto come vittima, NULL in caso di errore
+ * Ritorna: il file espulso, rimosso dallo storage insieme al suo buffer, NULL in caso di errore
+ *          Il chiamante deve rilasciarlo con release_victims
  */
 f_el *replace_file(storage *storage);
 
 /*
- * Calcola la dimensione della stringa contenente i filename e contenuti dei file letti
+ * Inizializza un cursore sui file dello storage
  * Parametri:
- *      ht: l'hash table in cui cercare i file
- *      size: la dimensione dell'array che modella l'hash table
- *      n: il numero di file da leggere
- *      socket_fd: il descrittore del socket su cui è stata ottenuta la richiesta
- * Errno:
- *      EINVAL: se ht == NULL oppure size <= 0 opppure n < 0 oppure socket_fd < 0
- * Ritorna: la dimesione della stringa contenente i filename e contenuti dei file letti in caso di successo, -1 in caso di errore
+ *      cursor: il cursore da inizializzare
+ *      n: il numero di file da leggere, se n == 0 vengono letti tutti i file
+ * Ritorna: none
  */
-int read_n_files_size(f_el **ht, int size, int n, int socket_fd);
+void read_cursor_init(read_cursor *cursor, int n);
 
 /*
- * Genera la stringa contenente i filename e contenuti dei file letti
+ * Fissa i file leggibili della prossima partizione del cursore, la partizione è posseduta in modo condiviso solo durante la visita
+ * Un file fissato è una copia dei metadati con un riferimento al buffer del file, che resta valido anche se il file viene modificato o rimosso
  * Parametri:
- *      ht: l'hash table in cui cercare i file
- *      size: la dimensione dell'array che modella l'hash table
- *      n: il numero di file da leggere
- *      result: la stringa che conterrà il risultato della funzione
- *      log_file: il file di log
+ *      storage: lo storage da cui leggere i file
+ *      cursor: il cursore
  *      socket_fd: il descrittore del socket su cui è stata ottenuta la richiesta
+ *      tail: il puntatore al campo metadata.lru_next dell'ultimo file della lista, aggiornato dopo ogni inserimento
  * Errno:
- *      EINVAL: se ht == NULL oppure size <= 0 oppure n < 0 oppure log_file == NULL oppure socket_fd < 0
- * Ritorna: 0 in caso di successo, -1 in caso di errore
+ *      EINVAL: se storage == NULL oppure cursor == NULL oppure socket_fd < 0 oppure tail == NULL
+ *      ENOMEM: se non è possibile allocare la copia di un file
+ * Ritorna: 1 se restano file da leggere, 0 se la lettura è terminata, -1 in caso di errore
  */
-int set_read_n_files(f_el **ht, int size, int n, char *result, FILE *log_file, int socket_fd);
+int read_cursor_next(storage *storage, read_cursor *cursor, int socket_fd, f_el ***tail);
 
 // Interfacce funzioni api
 /*
@@ -196,9 +429,8 @@ int set_read_n_files(f_el **ht, int size, int n, char *result, FILE *log_file, i
  *      filename: il filename del file da aprire o da creare nel caso in cui non esistesse
  *      flags: contiene i flags richiesti per l'apertura del file, per la specifica dei possibili flag vedi "definitions.h"
  *      socket_fd: il descrittore del socket su cui è stata ottenuta la richiesta
- *      max: il numero massimo di connessioni contemporaneamente attive
  * Errno:
- *      EINVAL: se storage == NULL oppure storage->ht == NULL || filename == NULL oppure socket_fd < 0 oppure max <= 0
+ *      EINVAL: se storage == NULL oppure storage->shards == NULL || filename == NULL oppure socket_fd < 0
  *      ENAMETOOLONG: se filename ha una lunghezza maggiore di UNIX_PATH_MAX
  *      ENOENT: se non esiste un file con il filename specificato e il flag O_CREATE non è specificato
  *      EEXIST: se esiste un file con filename specificato e il flag O_CREATE è specificato
@@ -206,7 +438,7 @@ int set_read_n_files(f_el **ht, int size, int n, char *result, FILE *log_file, i
  *      EPERM: se il flag O_LOCK è impostato e la lock è posseduta da un altro utente
  * Ritorna: il puntatore ad un eventuale file espulso durante la creazione di un nuovo file, NULL in caso di successo senza espulsione di file oppure in caso di errore, verificare errno per scoprire eventuali errori
  */
-f_el *openFile(storage *storage, char *filename, int flags, int socket_fd, int max);
+f_el *openFile(storage *storage, char *filename, int flags, int socket_fd);
 
 /*
  * Gestisce la chiusura di un file
@@ -214,14 +446,13 @@ f_el *openFile(storage *storage, char *filename, int flags, int socket_fd, int m
  *      storage: lo storage in cui cercare il file da chiudere
  *      filename: il filename del file da chiudere
  *      socket_fd: il descrittore del socket su cui è stata ottenuta la richiesta
- *      max: il numero massimo di connessioni contemporaneamente attive
  * Errno:
- *      EINVAL: se storage == NULL oppure storage->ht == NULL oppure filename == NULL oppure socket_fd < 0 oppure max <= 0
+ *      EINVAL: se storage == NULL oppure storage->shards == NULL oppure filename == NULL oppure socket_fd < 0
  *      ENAMETOOLONG: se filename ha una lunghezza maggiore di UNIX_PATH_MAX
  *      ENOENT: se non esiste un file con il filename specificato
  * Ritorna: 0 in caso di successo, -1 in caso di errore
  */
-int closeFile(storage *storage, char *filename, int socket_fd, int max);
+int closeFile(storage *storage, char *filename, int socket_fd);
 
 /*
  * Scrive il contenuto di un file
@@ -229,18 +460,19 @@ int closeFile(storage *storage, char *filename, int socket_fd, int max);
  *      storage: lo storage in cui cercare il file in cui scrivere il contenuto
  *      filename: il filename del file da scrivere
  *      socket_fd: il descrittore del socket su cui è stata ottenuta la richiesta
- *      content: il contenuto per il file
- *      max: il numero massimo di connessioni contemporaneamente attive
+ *      content: il contenuto per il file, ignorato se data != NULL
+ *      size: la dimensione in byte del contenuto, che può contenere qualsiasi byte
+ *      data: il buffer in cui il contenuto è già stato ricevuto, di dimensione size, di cui viene acquisito un riferimento senza copiarlo, NULL se il contenuto deve essere copiato da content
  * Errno:
- *      EINVAL: se storage == NULL oppure storage->ht == NULL oppure filename == NULL oppure socket_fd < 0 oppure content == NULL oppure max <= 0
+ *      EINVAL: se storage == NULL oppure storage->shards == NULL oppure filename == NULL oppure socket_fd < 0 oppure content == NULL e data == NULL oppure size < 0
  *      ENAMETOOLONG: se filename ha una lunghezza maggiore di UNIX_PATH_MAX
  *      ENOENT: se non esiste un file con il filename specificato
  *      EPERM: se un altro utente possiede la lock sul file
  *      EBADF: se il file non è stato aperto dal client che ha richiesto l'operazione
- *      ENOMEM: se il contenuto ha dimensione superiore alla capacità massima dello storage
+ *      ENOMEM: se il contenuto ha dimensione superiore alla capacità massima dello storage oppure non è possibile allocarlo
  * Ritorna: un array contenente eventuali file espulsi per fare spazio nello storage oppure NULL in caso di successo, NULL in caso di errore, verificare errno per scoprire eventuali errori
  */
-f_el *writeFile(storage *storage, char *filename, int socket_fd, char *content, int max);
+f_el *writeFile(storage *storage, char *filename, int socket_fd, char *content, long size, f_data *data);
 
 /*
  * Legge il contenuto del file con filename specificato
@@ -249,44 +481,51 @@ f_el *writeFile(storage *storage, char *filename, int socket_fd, char *content,
  *      filename: il filename del file da leggere
  *      socket_fd: il descrittore del socket su cui è stata ottenuta la richiesta
  * Errno:
- *      EINVAL: se storage == NULL oppure storage->ht == NULL oppure filename == NULL oppure socket_f < 0
+ *      EINVAL: se storage == NULL oppure storage->shards == NULL oppure filename == NULL oppure socket_f < 0
  *      ENAMETOOLONG: se filename ha una lunghezza maggiore di UNIX_PATH_MAX
  *      ENOENT: se non esiste un file con il filename specificato
  *      EPERM: se un altro utente possiede la lock sul file
- * Ritorna: la stringa contenente il contenuto del file in caso di successo, NULL in caso di errore
+ * Ritorna: un riferimento al buffer contenente il contenuto del file in caso di successo, NULL se il file è vuoto oppure in caso di errore, verificare errno per distinguere i due casi
+ *          Il buffer resta valido anche se il file viene modificato o eliminato, il chiamante deve rilasciarlo con data_release
  */
-char *readFile(storage *storage, char *filename, int socket_fd);
+f_data *readFile(storage *storage, char *filename, int socket_fd);
 
 /*
- * Legge n file qualsiasi contenuti nello storage, se n == 0 allora vengono letti tutti i file 
+ * Esegue un passo della lettura di n file qualsiasi contenuti nello storage, il cursore è inizializzato con read_cursor_init
+ * Il passo visita le partizioni del cursore finchè non fissa almeno un file, il contenuto dei file non viene copiato
+ * In questo modo solo i file di un passo restano fissati, quelli del passo successivo sono fissati dopo l'invio dei precedenti
  * Parametri:
  *      storage: lo storage da cui leggere i file
- *      n: il numero di file da leggere
+ *      cursor: il cursore della lettura, avanzato dal passo
  *      socket_fd: il descrittore del socket su cui è stata ottenuta la richiesta
+ *      more: il puntatore in cui memorizzare 1 se restano file da leggere con un altro passo, 0 altrimenti
  * Errno:
- *      EINVAL: se storage == NULL oppure storage->ht == NULL oppure n < 0 oppure socket_fd < 0
- * Ritorna: la stringa contenente i filename e contenuti di tutti i file letti in caso di successo, NULL in caso di errore
+ *      EINVAL: se storage == NULL oppure storage->shards == NULL oppure cursor == NULL oppure socket_fd < 0 oppure more == NULL
+ *      ENOMEM: se non è possibile allocare la copia di un file
+ * Ritorna: la lista dei file letti collegati tramite metadata.lru_next, NULL se nessun file è stato letto oppure in caso di errore, verificare errno per distinguere i due casi
+ *          Il chiamante deve rilasciare i file letti con release_victims
  */
-char *readNFiles(storage *storage, int n, int socket_fd);
+f_el *readNFiles(storage *storage, read_cursor *cursor, int socket_fd, int *more);
 
 /*
  * Concatena "content" al contenuto del file specificato
+ * Il contenuto è scritto nei chunk del buffer del file, il costo dipende solo dalla dimensione del contenuto concatenato
  * Parametri:
  *      storage: lo storage in cui cercare il file
  *      filename: il filename del file a cui concatenare il contenuto
  *      socket_fd: il descrittore del socket su cui è stata ottenuta la richiesta
  *      content: il contenuto da concatenare
- *      max: il numero massimo di connessioni attive contemporaneamente
+ *      size: la dimensione in byte del contenuto da concatenare
  * Errno:
- *      EINVAL: se storage == NULL oppure storage->ht == NULL oppure filename == NULL oppure socket_fd < 0 oppure content == NULL oppure max <= 0
+ *      EINVAL: se storage == NULL oppure storage->shards == NULL oppure filename == NULL oppure socket_fd < 0 oppure content == NULL oppure size < 0
  *      ENAMETOOLONG: se filename ha una lunghezza maggiore di UNIX_PATH_MAX
  *      ENOENT: se non esiste un file con il filename specificato
  *      EPERM: se un altro utente possiede la lock sul file
  *      EBADF: se il file non è stato aperto dall'utente che ha richiesto l'operazione
- *      ENOMEM: se la dimensione del vecchio contenuto aggiunta alla dimensione del nuovo contenuto supera la capacità massima dello storage
+ *      ENOMEM: se la dimensione del vecchio contenuto aggiunta alla dimensione del nuovo contenuto supera la capacità massima dello storage oppure non è possibile allocare un nuovo chunk
  * Ritorna: un array di file vittima espulsi per fare spazio nello storage oppure NULL in caso di successo, NULL in caso di errore, verificare errno per scoprire eventuali errori
  */
-f_el *appendToFile(storage *storage, char *filename, int socket_fd, char *content, int max);
+f_el *appendToFile(storage *storage, char *filename, int socket_fd, char *content, long size);
 
 /*
  * Imposta la lock su un file
@@ -295,7 +534,7 @@ f_el *appendToFile(storage *storage, char *filename, int socket_fd, char *conten
  *      filename: il filename del file su cui impostare la lock
  *      socket_fd: il descrittore del socket su cui è stata ottenuta la richiesta
  * Errno:
- *      EINVAL: se storage == NULL oppure storage->ht == NULL oppure filename == NULL oppure socket_fd < 0
+ *      EINVAL: se storage == NULL oppure storage->shards == NULL oppure filename == NULL oppure socket_fd < 0
  *      ENOENT: se non esiste un file con il filename specificato
  *      EPERM: se un altro utente possiede la lock sul file
  * Ritorna: 0 in caso di successo, -1 in caso di errore
@@ -309,7 +548,7 @@ int lockFile(storage *storage, char *filename, int socket_fd);
  *      filename: il filename del file su cui rilasciare la lock
  *      socket_fd: il descrittore del socket su cui è stata ottenuta la richiesta
  * Errno:
- *      EINVAL: se storage == NULL oppure storage->ht == NULL oppure filename == NULL oppure socket_fd < 0
+ *      EINVAL: se storage == NULL oppure storage->shards == NULL oppure filename == NULL oppure socket_fd < 0
  *      ENOENT: se non esiste un file con il filename specificato
  *      EPERM: se un altro utente possiede la lock sul file
  * Ritorna: 0 in caso di successo, -1 in caso di errore
@@ -323,850 +562,1734 @@ int unlockFile(storage *storage, char *filename, int socket_fd);
  *      filename: il filename del file da eliminare
  *      socket_fd: il descrittore del socket su cui è stata ottenuta la richiesta
  * Errno:
- *      EINVAL: se storage == NULL oppure storage->ht == NULL oppure filename == NULL oppure socket_fd < 0
+ *      EINVAL: se storage == NULL oppure storage->shards == NULL oppure filename == NULL oppure socket_fd < 0
  *      ENOENT: se non esiste un file con il filename specificato
  *      EPERM: se un altro utente possiede la lock sul file
  * Ritorna: 0 in caso di successo, -1 in caso di errore
  */
 int removeFile(storage *storage, char *filename, int socket_fd);
 
+/*
+ * Crea un file con il contenuto specificato, equivale a openFile con O_CREATE | O_LOCK seguita da writeFile e closeFile ma esegue una sola ricerca del file
+ * Al termine il file non è aperto e la lock non è posseduta dall'utente che ha richiesto l'operazione
+ * Parametri:
+ *      storage: lo storage in cui creare il file
+ *      filename: il filename del file da creare
+ *      socket_fd: il descrittore del socket su cui è stata ottenuta la richiesta
+ *      content: il contenuto per il file, ignorato se data != NULL
+ *      size: la dimensione in byte del contenuto, se 0 il file viene creato vuoto
+ *      data: il buffer in cui il contenuto è già stato ricevuto, vedi writeFile, NULL se il contenuto deve essere copiato da content
+ * Errno:
+ *      EINVAL: se storage == NULL oppure storage->shards == NULL oppure filename == NULL oppure socket_fd < 0 oppure content == NULL e data == NULL oppure size < 0
+ *      ENAMETOOLONG: se filename ha una lunghezza maggiore di UNIX_PATH_MAX
+ *      EEXIST: se esiste un file con il filename specificato
+ *      ENOMEM: se il contenuto ha dimensione superiore alla capacità massima dello storage oppure non è possibile allocarlo
+ * Ritorna: la lista dei file espulsi per fare spazio nello storage, collegati tramite metadata.lru_next, NULL in caso di successo senza espulsioni oppure in caso di errore, verificare errno per scoprire eventuali errori
+ */
+f_el *putFile(storage *storage, char *filename, int socket_fd, char *content, long size, f_data *data);
+
+/*
+ * Legge il contenuto di un file, equivale a openFile con O_LOCK seguita da readFile e closeFile ma esegue una sola ricerca del file
+ * La lettura non modifica lo stato del file, quindi è eseguita in parallelo con le altre letture della stessa partizione
+ * Parametri:
+ *      storage: lo storage in cui cercare il file da leggere
+ *      filename: il filename del file da leggere
+ *      socket_fd: il descrittore del socket su cui è stata ottenuta la richiesta
+ * Errno:
+ *      vedi readFile
+ * Ritorna: un riferimento al buffer contenente il contenuto del file in caso di successo, da rilasciare con data_release, NULL se il file è vuoto oppure in caso di errore, verificare errno per distinguere i due casi
+ */
+f_data *getFile(storage *storage, char *filename, int socket_fd);
+
+/*
+ * Legge un intervallo di byte del contenuto di un file, senza copiare il resto del contenuto
+ * Parametri:
+ *      storage: lo storage in cui cercare il file da leggere
+ *      filename: il filename del file da leggere
+ *      socket_fd: il descrittore del socket su cui è stata ottenuta la richiesta
+ *      offset: la posizione del primo byte da leggere
+ *      length: il numero massimo di byte da leggere
+ *      size: il puntatore in cui memorizzare il numero di byte letti, minore di length se l'intervallo supera la fine del file, 0 se offset è oltre la fine del file
+ * Errno:
+ *      EINVAL: se storage == NULL oppure storage->shards == NULL oppure filename == NULL oppure socket_fd < 0 oppure offset < 0 oppure length < 0 oppure size == NULL
+ *      ENAMETOOLONG: se filename ha una lunghezza maggiore di UNIX_PATH_MAX
+ *      ENOENT: se non esiste un file con il filename specificato
+ *      EPERM: se un altro utente possiede la lock sul file
+ * Ritorna: un riferimento al buffer del file, da rilasciare con data_release, NULL se nessun byte è stato letto oppure in caso di errore, verificare errno per distinguere i due casi
+ *          I byte letti sono quelli a partire da offset nel buffer restituito, che non vengono modificati finchè il riferimento è posseduto
+ */
+f_data *readFileRange(storage *storage, char *filename, int socket_fd, long offset, long length, long *size);
+
+/*
+ * Scrive "content" nel file specificato a partire da offset, sovrascrivendo i byte esistenti ed estendendo il file se necessario
+ * Sono modificati solo i chunk che contengono l'intervallo, il buffer viene copiato solo se una risposta in corso di invio ne possiede un riferimento
+ * Parametri:
+ *      storage: lo storage in cui cercare il file
+ *      filename: il filename del file in cui scrivere
+ *      socket_fd: il descrittore del socket su cui è stata ottenuta la richiesta
+ *      offset: la posizione del primo byte da scrivere, al più la dimensione del file
+ *      content: il contenuto da scrivere
+ *      size: la dimensione in byte del contenuto
+ * Errno:
+ *      EINVAL: se storage == NULL oppure storage->shards == NULL oppure filename == NULL oppure socket_fd < 0 oppure content == NULL oppure size < 0 oppure offset non è compreso tra 0 e la dimensione del file
+ *      ENAMETOOLONG: se filename ha una lunghezza maggiore di UNIX_PATH_MAX
+ *      ENOENT: se non esiste un file con il filename specificato
+ *      EPERM: se un altro utente possiede la lock sul file
+ *      EBADF: se il file non è stato aperto dall'utente che ha richiesto l'operazione
+ *      ENOMEM: se la dimensione del file dopo la scrittura supera la capacità massima dello storage oppure non è possibile allocare il contenuto
+ * Ritorna: la lista dei file espulsi per fare spazio nello storage, collegati tramite metadata.lru_next, NULL in caso di successo senza espulsioni oppure in caso di errore, verificare errno per scoprire eventuali errori
+ */
+f_el *writeFileAt(storage *storage, char *filename, int socket_fd, long offset, char *content, long size);
+
 /*
  * Ripristina lo storage in uno stato coerente al momento della chiusura della connessione, rilasciando eventuali lock possedute dalla connessione chiusa e chiudendo file
+ * Sono esaminati solo i file registrati per la connessione nell'indice di ogni partizione, non l'intera hash table
  * Parametri:
  *      storage: lo storage in cui cercare il file
  *      socket_fd: il descrittore del socket su cui è stata ottenuta la richiesta
- *      max: il numero massimo di connessioni contemporaneamente aperte
  * Errno:
- *      EINVAL: se storage == NULL oppure storage->ht == NULL oppure socket_fd < 0 oppure max <= 0
+ *      EINVAL: se storage == NULL oppure storage->shards == NULL oppure socket_fd < 0
  * Ritorna: 0 in caso di successo, -1 in caso di errore
  */
-int clean_closed_conn(storage *storage, int socket_fd, int max);
+int clean_closed_conn(storage *storage, int socket_fd);
 
 /*
  * Inserisce l'informazione di log nel caso della scrittura di un file vuoto
  * Parametri:
- *      storage: lo storage per ottenere il filename del file di log
+ *      storage: lo storage per ottenere il logger
  * Ritorna: none
  */
 void write_no_content(storage *storage);
 
 /*
  * Restituisce una stringa formattata che rappresenta la data e ora attuale
+ * La stringa è memorizzata in un buffer privato del thread chiamante e viene sovrascritta dalla chiamata successiva dello stesso thread
  * Parametri: none
  * Ritorna: una stringa che rappresenta la data e ora attuale
  */
 char *get_timestamp();
 
+
 /*
- * Funzioni di supporto per l'api 
+ * Funzioni di gestione dello storage
  */
-f_el *create_file(storage *storage, char *filename, int max) {
-    f_el **ht;
-    f_el *file;
-
-    f_el *victim = NULL;
-
-    struct timespec time;
+int init_storage(storage *storage, long size_bytes, int size_n, logger *log, int memfd) {
+    shard *shard;
 
     int i;
 
-    if(storage == NULL || filename == NULL || max <= 0) {
+    if(storage == NULL || size_n <= 0 || log == NULL) {
         errno = EINVAL;
 
-        return NULL;
+        return -1;
     }
 
-    ht = storage->ht;
-
-    if(lookup(ht, storage->size.size_ht, filename) != NULL) {
-        errno = EEXIST;
-
-        return NULL;
+    if(init_slab_arena(&storage->arena) == -1) {
+        return -1;
     }
 
-    file = malloc(sizeof(f_el));
+    storage->n_shards = STORAGE_SHARDS;
+    storage->shards = malloc(storage->n_shards * sizeof(struct shard));
 
-    strcpy(file->metadata.filename, filename);
-    file->metadata.size = 0;
-    clock_gettime(CLOCK_REALTIME, &time);
-    file->metadata.last_used = (long long int)time.tv_sec * 1000000000L + (long long int)time.tv_nsec;
-    file->metadata.acquired_by = -1;
-    file->metadata.lock_type = 0;
-    file->metadata.opened = malloc(max * sizeof(int));
-    file->metadata.next_file = NULL;
-    file->metadata.prev_file = NULL;
+    for(i = 0; i < storage->n_shards; i++) {
+        shard = &storage->shards[i];
 
-    file->data = NULL;
-    
-    for(i = 0; i < max; i++) {
-        file->metadata.opened[i] = -1;
-    }
+        // La dimensione iniziale è solo un suggerimento, la hash table cresce e si riduce in base al numero di file contenuti
+        if(init_ht(&shard->ht, size_n / storage->n_shards, &storage->arena) == -1 || init_owner_index(&shard->owners) == -1) {
+            return -1;
+        }
 
-    if(storage->size.size_n == storage->size.occupied_size_n) {
-        printf("WORKER: È necessario il rimpiazzamento di un file\n");
+        shard->occupied_bytes = 0;
+        shard->occupied_size_n = 0;
+        shard->lru.head = NULL;
+        shard->lru.tail = NULL;
 
-        victim = replace_file(storage);
+        pthread_rwlock_init(&shard->lock, NULL);
     }
 
-    if(insert(ht, storage->size.size_ht, file) == -1) {
-        return NULL;
-    }
+    storage->size.size_bytes = size_bytes;
+    storage->size.size_n = size_n;
+    atomic_init(&storage->size.occupied_bytes, 0);
+    atomic_init(&storage->size.occupied_size_n, 0);
 
-    storage->size.occupied_size_n += 1;
+    atomic_init(&storage->statistics.max_stored_bytes, 0);
+    atomic_init(&storage->statistics.max_stored_files, 0);
+    atomic_init(&storage->statistics.replaced_files, 0);
 
-    if(storage->size.occupied_size_n > storage->statistics.max_stored_files) {
-        storage->statistics.max_stored_files = storage->size.occupied_size_n;
-    }
+    storage->log = log;
+    storage->memfd = memfd;
 
-    return victim;
+    return 0;
 }
 
-int delete_file(storage *storage, f_el *victim) {
-    f_el **ht;
-
-    int file_size;
+void free_storage(storage *storage) {
+    int i;
 
-    if(storage == NULL || victim == NULL) {
-        errno = EINVAL;
+    for(i = 0; i < storage->n_shards; i++) {
+        free_owner_index(&storage->shards[i].owners);
+        free_ht(&storage->shards[i].ht);
 
-        return -1;
+        pthread_rwlock_destroy(&storage->shards[i].lock);
     }
 
-    ht = storage->ht;
+    free(storage->shards);
 
-    file_size = victim->metadata.size;
+    // I file sono già stati restituiti all'arena, i chunk possono essere restituiti al sistema operativo
+    free_slab_arena(&storage->arena);
+}
 
-    if(delete(ht, storage->size.size_ht, victim) == -1) {
-        return -1;
-    }
+void print_storage(storage *storage) {
+    int i;
 
-    storage->size.occupied_bytes -= file_size;
-    storage->size.occupied_size_n -= 1;
+    for(i = 0; i < storage->n_shards; i++) {
+        print_ht(&storage->shards[i].ht);
+    }
+}
 
-    return 0;
+shard *get_shard(storage *storage, uint64_t hash) {
+    // I bit bassi dell'hash selezionano la cella nella hash table della partizione, quindi la partizione è scelta con i bit alti
+    return &storage->shards[(hash >> 32) & (storage->n_shards - 1)];
 }
 
-int check_opened(f_el *file, int socket_fd, int max) {
+int storage_lock(storage *storage, shard *shard, int all) {
+    int result;
     int i;
 
-    if(file == NULL || socket_fd < 0 || max <= 0) {
-        errno = EINVAL;
-
-        return -1;
+    if(!all) {
+        return pthread_rwlock_wrlock(&shard->lock);
     }
 
-    for(i = 0; i < max; i++) {
-        if(file->metadata.opened[i] == socket_fd) {
-            return 1;
+    for(i = 0; i < storage->n_shards; i++) {
+        if((result = pthread_rwlock_wrlock(&storage->shards[i].lock)) != 0) {
+            // Rilascia le partizioni già acquisite
+            while(--i >= 0) {
+                pthread_rwlock_unlock(&storage->shards[i].lock);
+            }
+
+            return result;
         }
     }
 
     return 0;
 }
 
-int open_file(storage *storage, f_el *file, int socket_fd, int max, int log) {
-    FILE *log_file;
-
-    int opened = 0;
+int storage_rdlock(storage *storage, shard *shard, int all) {
+    int result;
     int i;
 
-    if(storage == NULL || file == NULL || socket_fd < 0 || max <= 0) {
-        errno = EINVAL;
-
-        return -1;
+    if(!all) {
+        return pthread_rwlock_rdlock(&shard->lock);
     }
 
-    for(i = 0; i < max; i++) {
-        if(file->metadata.opened[i] == -1) {
-            file->metadata.opened[i] = socket_fd;
-
-            if(log) {
-                log_file = fopen(storage->log_filename, "a");
-                fprintf(log_file, "openfile %s [%s]\n", file->metadata.filename, get_timestamp());
-                fclose(log_file);
+    for(i = 0; i < storage->n_shards; i++) {
+        if((result = pthread_rwlock_rdlock(&storage->shards[i].lock)) != 0) {
+            // Rilascia le partizioni già acquisite
+            while(--i >= 0) {
+                pthread_rwlock_unlock(&storage->shards[i].lock);
             }
 
-            opened = 1;
-
-            break;
+            return result;
         }
     }
 
-    return opened;
+    return 0;
 }
 
-int close_file(storage *storage, f_el *file, int socket_fd, int max) {
-    FILE *log_file;
-
+void storage_unlock(storage *storage, shard *shard, int all) {
     int i;
 
-    if(storage == NULL || file == NULL || socket_fd < 0 || max <= 0) {
-        errno = EINVAL;
+    if(!all) {
+        pthread_rwlock_unlock(&shard->lock);
 
-        return -1;
+        return;
     }
 
-    for(i = 0; i < max; i++) {
-        if(file->metadata.opened[i] == socket_fd) {
-            file->metadata.opened[i] = -1;
-
-            break;
-        }
-    }
-    
-    if(check_locked(file, socket_fd) == 1 && file->metadata.lock_type == 1) {
-        unlock_file(storage, file, socket_fd);
+    for(i = storage->n_shards - 1; i >= 0; i--) {
+        pthread_rwlock_unlock(&storage->shards[i].lock);
     }
+}
 
-    log_file = fopen(storage->log_filename, "a");
-    fprintf(log_file, "closefile:%s [%s]\n", file->metadata.filename, get_timestamp());
-    fclose(log_file);
+int reserve_bytes(storage *storage, long bytes) {
+    long occupied;
 
-    return 0;
-}
+    occupied = atomic_fetch_add(&storage->size.occupied_bytes, bytes) + bytes;
 
-int check_locked(f_el *file, int socket_fd) {
-    if(file == NULL || socket_fd < 0) {
-        errno = EINVAL;
+    if(occupied + slab_idle(&storage->arena) > storage->size.size_bytes) {
+        // Lo spazio non è sufficiente, annulla la prenotazione
+        atomic_fetch_sub(&storage->size.occupied_bytes, bytes);
 
-        return -1;
-    }
+        errno = EAGAIN;
 
-    if(file->metadata.acquired_by == -1) {
-        // La lock sul file non è posseduta da nessuno
-        return 0;
-    } else if(file->metadata.acquired_by == socket_fd){
-        // La lock sul file è posseduta da chi ha richiesto l'operazione
-        return 1;
-    } else {
-        // La lock sul file è posseduta da un altro utente
         return -1;
     }
+
+    update_max_long(&storage->statistics.max_stored_bytes, occupied);
+
+    return 0;
 }
 
-int lock_file(storage *storage, f_el *file, int socket_fd, int lock_type) {
-    FILE *log_file;
+long storage_available(storage *storage) {
+    return storage->size.size_bytes - atomic_load(&storage->size.occupied_bytes) - slab_idle(&storage->arena);
+}
 
-    if(storage == NULL || file == NULL || socket_fd < 0) {
-        errno = EINVAL;
+int reserve_file(storage *storage) {
+    int occupied;
 
-        return -1;
-    }
+    occupied = atomic_fetch_add(&storage->size.occupied_size_n, 1) + 1;
 
-    // Verifica se il file è già locked
-    if(check_locked(file, socket_fd) == -1) {
-        // Il file è locked
-        errno = EPERM;
+    if(occupied > storage->size.size_n) {
+        // Lo storage è pieno, annulla la prenotazione
+        atomic_fetch_sub(&storage->size.occupied_size_n, 1);
+
+        errno = EAGAIN;
 
         return -1;
     }
 
-    // Il file non è locked oppure la richiesta di lock è proveniente dallo stesso processo che possiede già la lock
-    file->metadata.acquired_by = socket_fd;
-    if(file->metadata.acquired_by == -1) {
-        file->metadata.lock_type = lock_type;
-    }
-    file->metadata.lock_type = lock_type;
+    update_max_int(&storage->statistics.max_stored_files, occupied);
 
-    log_file = fopen(storage->log_filename, "a");
-    switch(lock_type) {
-        case 0:
-            fprintf(log_file, "lockfile:%s [%s]\n", file->metadata.filename, get_timestamp());
+    return 0;
+}
 
-            break;
-        case 1:
-            fprintf(log_file, "openlock:%s [%s]\n", file->metadata.filename, get_timestamp());
+void update_max_long(atomic_long *max, long value) {
+    long act_max = atomic_load(max);
 
-            break;
-    }
-    fclose(log_file);
+    while(value > act_max && !atomic_compare_exchange_weak(max, &act_max, value));
+}
+
+void update_max_int(atomic_int *max, int value) {
+    int act_max = atomic_load(max);
+
+    while(value > act_max && !atomic_compare_exchange_weak(max, &act_max, value));
+}
+
+f_el *select_storage_victim(storage *storage, f_el *exonerated) {
+    f_el *victim = NULL;
+    f_el *candidate;
+
+    int i;
+
+    // Le vittime delle singole partizioni non sono state usate dopo l'ultimo spostamento, quindi la vittima globale è quella spostata meno di recente
+    for(i = 0; i < storage->n_shards; i++) {
+        candidate = select_victim(&storage->shards[i].lru, exonerated);
+
+        if(candidate != NULL && (victim == NULL || victim->metadata.lru_stamp > candidate->metadata.lru_stamp)) {
+            victim = candidate;
+        }
+    }
+
+    return victim;
+}
+
+void mark_used(f_el *file) {
+    struct timespec time;
+
+    clock_gettime(CLOCK_REALTIME, &time);
+
+    // Il valore è solo un indizio per la politica di rimpiazzamento, quindi non è necessario alcun ordinamento rispetto alle altre operazioni
+    atomic_store_explicit(&file->metadata.last_used, (long long int)time.tv_sec * 1000000000L + (long long int)time.tv_nsec, memory_order_relaxed);
+}
+
+/*
+ * Funzioni di supporto per l'api
+ */
+f_el *create_file(storage *storage, shard *shard, char *filename, uint64_t hash, int all) {
+    f_el *file;
+
+    f_el *victim = NULL;
+
+    struct timespec time;
+
+    if(storage == NULL || shard == NULL || filename == NULL) {
+        errno = EINVAL;
+
+        return NULL;
+    }
+
+    if(lookup(&shard->ht, filename, hash) != NULL) {
+        errno = EEXIST;
+
+        return NULL;
+    }
+
+    if(reserve_file(storage) == -1) {
+        if(!all) {
+            // Per espellere un file è necessario possedere tutte le partizioni, errno è già impostato a EAGAIN
+            return NULL;
+        }
+
+        printf("WORKER: È necessario il rimpiazzamento di un file\n");
+
+        if((victim = replace_file(storage)) == NULL) {
+            errno = ENOMEM;
+
+            return NULL;
+        }
+
+        // La vittima ha liberato un file e tutte le partizioni sono possedute, quindi la prenotazione non può fallire
+        reserve_file(storage);
+    }
+
+    if((file = slab_alloc(&storage->arena, sizeof(f_el))) == NULL) {
+        atomic_fetch_sub(&storage->size.occupied_size_n, 1);
+
+        return NULL;
+    }
+
+    strcpy(file->metadata.filename, filename);
+    file->metadata.size = 0;
+    file->metadata.charged = 0;
+    clock_gettime(CLOCK_REALTIME, &time);
+    atomic_init(&file->metadata.last_used, (long long int)time.tv_sec * 1000000000L + (long long int)time.tv_nsec);
+    file->metadata.lru_stamp = 0;
+    file->metadata.acquired_by = -1;
+    file->metadata.lock_type = 0;
+    file->metadata.shard = shard - storage->shards;
+    file->metadata.hash = hash;
+    file->metadata.lru_next = NULL;
+    file->metadata.lru_prev = NULL;
+    open_set_init(&file->metadata.owners);
+
+    file->data = NULL;
+
+    if(insert(&shard->ht, file) == -1) {
+        atomic_fetch_sub(&storage->size.occupied_size_n, 1);
+
+        slab_free(&storage->arena, file, sizeof(f_el));
+
+        return NULL;
+    }
+
+    shard->occupied_size_n += 1;
+
+    return victim;
+}
+
+int delete_file(storage *storage, f_el *victim) {
+    if(detach_file(storage, victim) == -1) {
+        return -1;
+    }
+
+    release_victims(storage, victim);
+
+    return 0;
+}
+
+int detach_file(storage *storage, f_el *victim) {
+    shard *shard;
+
+    long file_size;
+
+    if(storage == NULL || victim == NULL) {
+        errno = EINVAL;
+
+        return -1;
+    }
+
+    shard = &storage->shards[victim->metadata.shard];
+
+    file_size = victim->metadata.charged;
+
+    lru_remove(&shard->lru, victim);
+
+    // Le connessioni che hanno aperto il file non devono più farvi riferimento
+    owner_release_file(&shard->owners, victim);
+
+    if(detach(&shard->ht, victim) == -1) {
+        return -1;
+    }
+
+    open_set_free(&victim->metadata.owners);
+
+    // Il file non appartiene più ad alcuna lista LRU, il collegamento è riutilizzato per la lista delle vittime
+    victim->metadata.lru_next = NULL;
+
+    shard->occupied_bytes -= file_size;
+    shard->occupied_size_n -= 1;
+
+    atomic_fetch_sub(&storage->size.occupied_bytes, file_size);
+    atomic_fetch_sub(&storage->size.occupied_size_n, 1);
+
+    return 0;
+}
+
+void release_victims(storage *storage, f_el *victims) {
+    f_el *next;
+
+    while(victims != NULL) {
+        next = victims->metadata.lru_next;
+
+        data_release(&storage->arena, victims->data);
+        slab_free(&storage->arena, victims, sizeof(f_el));
+
+        victims = next;
+    }
+}
+
+f_data *alloc_content(storage *storage, int size) {
+    f_data *data;
+
+    if(storage->memfd && size >= DATA_MEMFD_MIN && (data = data_alloc_memfd(&storage->arena, size)) != NULL) {
+        return data;
+    }
+
+    return data_alloc(&storage->arena, size);
+}
+
+f_data *create_content(storage *storage, const char *content, int size) {
+    f_data *data;
+
+    if(content == NULL) {
+        errno = EINVAL;
+
+        return NULL;
+    }
+
+    if((data = alloc_content(storage, size)) == NULL) {
+        return NULL;
+    }
+
+    memcpy(data->base, content, size);
+
+    return data;
+}
+
+long content_footprint(storage *storage, int size) {
+    long arena;
+    long memfd;
+
+    arena = data_alloc_footprint(&storage->arena, size, 0);
+
+    if(storage->memfd && size >= DATA_MEMFD_MIN) {
+        memfd = data_alloc_footprint(&storage->arena, size, 1);
+
+        return memfd > arena ? memfd : arena;
+    }
+
+    return arena;
+}
+
+void touch_file(storage *storage, f_el *file) {
+    mark_used(file);
+
+    // Solo i file che occupano spazio lo liberano se espulsi, quindi un file diventato vuoto non può più essere scelto come vittima
+    if(file->metadata.charged != 0) {
+        lru_touch(&storage->shards[file->metadata.shard].lru, file);
+    } else {
+        lru_remove(&storage->shards[file->metadata.shard].lru, file);
+    }
+}
+
+int check_opened(f_el *file, int socket_fd) {
+    if(file == NULL || socket_fd < 0) {
+        errno = EINVAL;
+
+        return -1;
+    }
+
+    return owner_opened(file, socket_fd);
+}
+
+int open_file(storage *storage, f_el *file, int socket_fd, int log) {
+    owner *el;
+
+    if(storage == NULL || file == NULL || socket_fd < 0) {
+        errno = EINVAL;
+
+        return -1;
+    }
+
+    // L'apertura è registrata sia nell'insieme del file che nella lista della connessione, in modo che alla sua chiusura il file sia chiuso senza cercarlo
+    if((el = owner_get(&storage->shards[file->metadata.shard].owners, file, socket_fd, 1)) == NULL) {
+        return 0;
+    }
+
+    el->opened = 1;
+
+    if(log) {
+        log_printf(storage->log, "openfile %s [%s]\n", file->metadata.filename, get_timestamp());
+    }
+
+    return 1;
+}
+
+int close_file(storage *storage, f_el *file, int socket_fd) {
+    owner *el;
+
+    if(storage == NULL || file == NULL || socket_fd < 0) {
+        errno = EINVAL;
+
+        return -1;
+    }
+
+    if((el = owner_get(&storage->shards[file->metadata.shard].owners, file, socket_fd, 0)) != NULL) {
+        el->opened = 0;
+
+        owner_put(&storage->shards[file->metadata.shard].owners, el);
+    }
+    
+    if(check_locked(file, socket_fd) == 1 && file->metadata.lock_type == 1) {
+        unlock_file(storage, file, socket_fd);
+    }
+
+    log_printf(storage->log, "closefile:%s [%s]\n", file->metadata.filename, get_timestamp());
+
+    return 0;
+}
+
+int check_locked(f_el *file, int socket_fd) {
+    if(file == NULL || socket_fd < 0) {
+        errno = EINVAL;
+
+        return -1;
+    }
+
+    if(file->metadata.acquired_by == -1) {
+        // La lock sul file non è posseduta da nessuno
+        return 0;
+    } else if(file->metadata.acquired_by == socket_fd){
+        // La lock sul file è posseduta da chi ha richiesto l'operazione
+        return 1;
+    } else {
+        // La lock sul file è posseduta da un altro utente
+        return -1;
+    }
+}
+
+int lock_file(storage *storage, f_el *file, int socket_fd, int lock_type) {
+    owner *el;
+
+    if(storage == NULL || file == NULL || socket_fd < 0) {
+        errno = EINVAL;
+
+        return -1;
+    }
+
+    // Verifica se il file è già locked
+    if(check_locked(file, socket_fd) == -1) {
+        // Il file è locked
+        errno = EPERM;
+
+        return -1;
+    }
+
+    if((el = owner_get(&storage->shards[file->metadata.shard].owners, file, socket_fd, 1)) == NULL) {
+        return -1;
+    }
+
+    el->locked = 1;
+
+    // Il file non è locked oppure la richiesta di lock è proveniente dallo stesso processo che possiede già la lock
+    file->metadata.acquired_by = socket_fd;
+    if(file->metadata.acquired_by == -1) {
+        file->metadata.lock_type = lock_type;
+    }
+    file->metadata.lock_type = lock_type;
+
+    switch(lock_type) {
+        case 0:
+            log_printf(storage->log, "lockfile:%s [%s]\n", file->metadata.filename, get_timestamp());
+
+            break;
+        case 1:
+            log_printf(storage->log, "openlock:%s [%s]\n", file->metadata.filename, get_timestamp());
+
+            break;
+    }
+
+    return 0;
+}
+
+int unlock_file(storage *storage, f_el *file, int socket_fd) {
+    owner *el;
+
+    if(storage == NULL || file == NULL || socket_fd < 0) {
+        errno = EINVAL;
+
+        return -1;
+    }
+
+    // Verifica se il file è già locked
+    if(check_locked(file, socket_fd) != 1) {
+        // Il file non è locked
+        errno = EPERM;
+
+        return -1;
+    }
+
+    // Il file è locked e la lock è posseduta da chi ha richiesto l'operazione 
+    file->metadata.acquired_by = -1;
+
+    if((el = owner_get(&storage->shards[file->metadata.shard].owners, file, socket_fd, 0)) != NULL) {
+        el->locked = 0;
+
+        owner_put(&storage->shards[file->metadata.shard].owners, el);
+    }
+
+    log_printf(storage->log, "unlockfile:%s [%s]\n", file->metadata.filename, get_timestamp());
+
+    return 0;
+}
+
+f_el *replace_files(storage *storage, long required_space, f_el *exonerated) {
+    f_el *victim;
+    f_el *victims = NULL;
+    f_el *tail = NULL;
+
+    if(storage == NULL || required_space <= 0) {
+        errno = EINVAL;
+
+        return NULL;
+    }
+
+    if(storage->shards == NULL) {
+        errno = EINVAL;
+
+        return NULL;
+    }
+
+    if(required_space > storage->size.size_bytes) {
+        errno = ENOMEM;
+
+        return NULL;
+    }
+
+    errno = 0;
+
+    // Espelle i file usati meno di recente fino a liberare lo spazio richiesto, ogni vittima è selezionata in O(1) dalla lista LRU
+    while(required_space > storage_available(storage)) {
+        victim = select_storage_victim(storage, exonerated);
+
+        if(victim == NULL) {
+            // Non esistono altri file che possono essere espulsi
+            break;
+        }
+
+        printf("WORKER: il file %s, di dimensione %dbytes, verrà rimpiazzato\n", victim->metadata.filename, victim->metadata.size);
+
+        log_printf(storage->log, "replacefile:%s,%dbytes [%s]\n", victim->metadata.filename, victim->metadata.size, get_timestamp());
+
+        // Il file è solo rimosso dallo storage, il suo buffer passa alla risposta senza essere copiato
+        if(detach_file(storage, victim) == -1) {
+            release_victims(storage, victims);
+
+            return NULL;
+        }
+
+        if(tail == NULL) {
+            victims = victim;
+        } else {
+            tail->metadata.lru_next = victim;
+        }
+
+        tail = victim;
+
+        atomic_fetch_add(&storage->statistics.replaced_files, 1);
+    }
+
+    return victims;
+}
+
+f_el *replace_file(storage *storage) {
+    f_el *victim;
+
+    if(storage == NULL) {
+        errno = EINVAL;
+
+        return NULL;
+    }
+
+    if(storage->shards == NULL) {
+        errno = EINVAL;
+
+        return NULL;
+    }
+
+    victim = select_storage_victim(storage, NULL);
+    
+    if(victim == NULL) {
+        errno = EPERM;
+
+        return NULL;
+    }
+
+    printf("WORKER: il file %s, di dimensione %dbytes, verrà rimpiazzato\n", victim->metadata.filename, victim->metadata.size);
+
+    log_printf(storage->log, "replacefile:%s,%dbytes [%s]\n", victim->metadata.filename, victim->metadata.size, get_timestamp());
+
+    // Il file è solo rimosso dallo storage, il suo buffer passa alla risposta senza essere copiato
+    if(detach_file(storage, victim) == -1) {
+        return NULL;
+    }
+
+    atomic_fetch_add(&storage->statistics.replaced_files, 1);
+
+    return victim;
+}
+
+void read_cursor_init(read_cursor *cursor, int n) {
+    cursor->shard = 0;
+    cursor->remaining = n == 0 ? -1 : n;
+}
+
+int read_cursor_next(storage *storage, read_cursor *cursor, int socket_fd, f_el ***tail) {
+    shard *shard;
+    f_el *iterator;
+    f_el *pinned;
+    ht_iter it;
+
+    int result = 0;
+
+    if(storage == NULL || cursor == NULL || socket_fd < 0 || tail == NULL) {
+        errno = EINVAL;
+
+        return -1;
+    }
+
+    if(cursor->remaining == 0 || cursor->shard >= storage->n_shards) {
+        return 0;
+    }
+
+    shard = &storage->shards[cursor->shard];
+
+    // La lettura non modifica la partizione, quindi può essere eseguita in parallelo con altre letture
+    if((errno = storage_rdlock(storage, shard, 0)) != 0) {
+        return -1;
+    }
+
+    // L'iteratore resta valido solo finchè la partizione è posseduta, quindi la partizione viene visitata per intero
+    ht_iter_init(&it, &shard->ht);
+
+    while(cursor->remaining != 0 && (iterator = ht_iter_next(&it)) != NULL) {
+        // Verifica se il file è in stato locked
+        if(check_locked(iterator, socket_fd) == -1) {
+            continue;
+        }
+
+        if((pinned = slab_alloc(&storage->arena, sizeof(f_el))) == NULL) {
+            errno = ENOMEM;
+
+            result = -1;
+
+            break;
+        }
+
+        // La copia contiene solo il filename e il riferimento al buffer, come un file espulso
+        memset(pinned, 0, sizeof(f_el));
+        strcpy(pinned->metadata.filename, iterator->metadata.filename);
+        pinned->metadata.size = iterator->metadata.size;
+        pinned->data = iterator->data != NULL ? data_acquire(iterator->data) : NULL;
+
+        **tail = pinned;
+        *tail = &pinned->metadata.lru_next;
+
+        mark_used(iterator);
+
+        log_printf(storage->log, "readinfo:%s,%d [%s]\nread:%d\n", iterator->metadata.filename, iterator->metadata.size, get_timestamp(), iterator->metadata.size);
+
+        if(cursor->remaining > 0) {
+            cursor->remaining--;
+        }
+    }
+
+    storage_unlock(storage, shard, 0);
+
+    if(result == -1) {
+        return -1;
+    }
+
+    cursor->shard++;
+
+    return cursor->remaining != 0 && cursor->shard < storage->n_shards;
+}
+
+int clean_closed_conn(storage *storage, int socket_fd) {
+    shard *shard;
+
+    int i;
+
+    if(storage == NULL || storage->shards == NULL || socket_fd < 0) {
+        errno = EINVAL;
+        
+        return -1;
+    }
+
+    // Le partizioni sono indipendenti, quindi sono ripristinate una alla volta senza bloccare l'intero storage
+    for(i = 0; i < storage->n_shards; i++) {
+        shard = &storage->shards[i];
+
+        if((errno = storage_lock(storage, shard, 0)) != 0) {
+            return -1;
+        }
+
+        owner_release_conn(&shard->owners, socket_fd);
+
+        storage_unlock(storage, shard, 0);
+    }
+
+    return 0;
+}
+
+void write_no_content(storage *storage) {
+    log_printf(storage->log, "write:0\n");
+}
+
+char *get_timestamp() {
+    static __thread char result[26];                        // Buffer privato di ogni thread, ctime_r vi scrive al più 26 byte
+
+    time_t act_time = time(NULL);
+
+    ctime_r(&act_time, result);
+
+    result[strlen(result) - 1] = '\0';
+
+    return result;
+}
+/*
+ * Funzioni dell'api
+ */
+f_el *openFile(storage *storage, char *filename, int flags, int socket_fd) {
+    shard *shard;
+    uint64_t hash;
+
+    f_el *file;
+
+    f_el *victim = NULL;
+
+    int created = 0;
+    int all = 0;
+
+    // Verifica se filename e storage sono validi
+    if(storage == NULL || storage->shards == NULL || filename == NULL || socket_fd < 0) {
+        errno = EINVAL;
+
+        return NULL;
+    }
+
+    if(strlen(filename) > UNIX_PATH_MAX) {
+        errno = ENAMETOOLONG;
+
+        return NULL;
+    }
+
+    // Filename è valido
+
+    hash = hash_filename(filename);
+    shard = get_shard(storage, hash);
+
+    while(1) {
+        if((errno = storage_lock(storage, shard, all)) != 0) {
+
+            return NULL;
+        }
+
+        // Verifica se esiste già un file t.c file->filename == filename
+        if((file = lookup(&shard->ht, filename, hash)) == NULL) {
+            // Il file non esiste verifica se il flag O_CREATE è impostato
+            if((flags & O_CREATE) == 0) {
+                // Il flag non è impostato, l'operazione fallisce
+                errno = ENOENT;
+
+                storage_unlock(storage, shard, all);
+
+                return NULL;
+            }
+
+            errno = 0;
+            // Il file non esiste ma il flag O_CREATE è impostato, quindi crea un nuovo file
+            if((victim = create_file(storage, shard, filename, hash, all)) == NULL && errno != 0) {
+
+                storage_unlock(storage, shard, all);
+
+                if(errno == EAGAIN) {
+                    // Lo storage è pieno, ripete l'operazione possedendo tutte le partizioni per poter espellere un file
+                    all = 1;
+
+                    continue;
+                }
+
+                return NULL;
+            }
+
+            created = 1;
+        }
+
+        break;
+    }
+
+    // Il file esiste oppure è stato creato, verifica se il file è stato creato o era già esistente
+
+    if(created == 0) {
+        // Il file era già esistente, verifica se il flag O_CREATE è impostato
+        if((flags & O_CREATE) != 0) {
+            // Il flag è impostato, l'operazione fallisce
+            errno = EEXIST;
+
+            storage_unlock(storage, shard, all);
+
+            return NULL;
+        }
+    } else {
+        file = lookup(&shard->ht, filename, hash);
+    }
+
+    // Il file è stato creato, oppure era già esistente e il flag O_CREATE non è impostato
+
+    // Verifica se il file è stato già aperto dall'utente che ha richiesto l'operazione
+    if(check_opened(file, socket_fd) == 1) {
+        errno = EBADR;
+
+        storage_unlock(storage, shard, all);
+
+        return NULL;
+    }
+
+    // Il file non è stato ancora aperto
+
+    // Verifica se il flag O_LOCK è impostato
+    if(flags & O_LOCK) {
+        // Il flag è impostato, esegue il lock del file
+        if(lock_file(storage, file, socket_fd, 1) == -1) {
+            errno = EPERM;
+
+            storage_unlock(storage, shard, all);
+
+            return NULL;
+        }
+
+        open_file(storage, file, socket_fd, 0);
+    } else {
+        open_file(storage, file, socket_fd, 1);
+    }
+
+    storage_unlock(storage, shard, all);
 
-    return 0;
+    return victim;
 }
 
-int unlock_file(storage *storage, f_el *file, int socket_fd) {
-    FILE *log_file;
+int closeFile(storage *storage, char *filename, int socket_fd) {
+    shard *shard;
+    uint64_t hash;
+    f_el *file;
 
-    if(storage == NULL || file == NULL || socket_fd < 0) {
+    if(storage == NULL || storage->shards == NULL || filename == NULL || socket_fd < 0) {
         errno = EINVAL;
 
         return -1;
     }
 
-    // Verifica se il file è già locked
-    if(check_locked(file, socket_fd) != 1) {
-        // Il file non è locked
-        errno = EPERM;
+    if(strlen(filename) > UNIX_PATH_MAX) {
+        errno = ENAMETOOLONG;
 
         return -1;
     }
 
-    // Il file è locked e la lock è posseduta da chi ha richiesto l'operazione 
-    file->metadata.acquired_by = -1;
+    // Filename è valido
+
+    hash = hash_filename(filename);
+    shard = get_shard(storage, hash);
+
+    if((errno = storage_lock(storage, shard, 0)) != 0) {
+        return -1;
+    }
+
+    // Verifica se esiste un file t.c file->filename == filename
+    if((file = lookup(&shard->ht, filename, hash)) == NULL) {
+        // Il file non esiste, l'operazione fallisce
+        errno = ENOENT;
+
+        storage_unlock(storage, shard, 0);
+
+        return -1;
+    }
+
+    if(close_file(storage, file, socket_fd) == -1) {
+        storage_unlock(storage, shard, 0);
+
+        return -1;
+    }
 
-    log_file = fopen(storage->log_filename, "a");
-    fprintf(log_file, "unlockfile:%s [%s]\n", file->metadata.filename, get_timestamp());
-    fclose(log_file);
+    storage_unlock(storage, shard, 0);
 
     return 0;
 }
 
-f_el *replace_files(storage *storage, long required_space, char *exonerated) {
-    FILE *log_file;
+f_el *writeFile(storage *storage, char *filename, int socket_fd, char *content, long size, f_data *data) {
+    shard *shard;
+    uint64_t hash;
+    f_el *victims = NULL;
+    f_el *file;
+
+    f_data *file_content = NULL;
 
-    f_el **ht;
-    f_el *victim;
-    f_el *victims;
+    long content_size;
+    long charge;
+    long delta;
 
-    int i;
-    int result_size;
-    int free_bytes;
+    int all = 0;
 
-    if(storage == NULL || required_space <= 0) {
+    // Verifica se i parametri sono validi
+    if(storage == NULL || storage->shards == NULL || filename == NULL || socket_fd < 0 || (content == NULL && data == NULL) || size < 0) {
         errno = EINVAL;
 
         return NULL;
     }
 
-    if(storage->ht == NULL) {
-        errno = EINVAL;
+    if(strlen(filename) > UNIX_PATH_MAX) {
+        errno = ENAMETOOLONG;
 
         return NULL;
     }
 
-    ht = storage->ht;
-
-    if(required_space > storage->size.size_bytes) {
+    // Verifica se c'è sufficiente spazio nello storage
+    if(size > storage->size.size_bytes) {
         errno = ENOMEM;
 
         return NULL;
     }
 
-    result_size = 0;
-    free_bytes = 0;
-    while(required_space > free_bytes) {
-        victim = select_victim(ht, storage->size.size_ht, exonerated);
+    // Il buffer è allocato prima di acquisire la lock, il contenuto ricevuto direttamente nel buffer non viene copiato
+    if(size > 0 && (file_content = data != NULL ? data_acquire(data) : create_content(storage, content, size)) == NULL) {
+        errno = ENOMEM;
+
+        return NULL;
+    }
 
-        printf("WORKER: il file %s, di dimensione %dbytes, verrà rimpiazzato\n", victim->metadata.filename, victim->metadata.size);
+    // Lo storage è occupato dai blocchi del contenuto, che possono superare la sua dimensione
+    if((charge = data_footprint(&storage->arena, file_content)) > storage->size.size_bytes) {
+        errno = ENOMEM;
 
-        log_file = fopen(storage->log_filename, "a");
-        fprintf(log_file, "replacefile:%s,%dbytes [%s]\n", victim->metadata.filename, victim->metadata.size, get_timestamp());
-        fclose(log_file);
+        data_release(&storage->arena, file_content);
 
-        free_bytes = storage->size.size_bytes - storage->size.occupied_bytes + victim->metadata.size;
-        result_size++;
+        return NULL;
     }
 
-    result_size++;
+    hash = hash_filename(filename);
+    shard = get_shard(storage, hash);
+    content_size = size;
 
-    victims = malloc(result_size * sizeof(f_el));
-    memset(victims, 0, sizeof(f_el));
+    while(1) {
+        if((errno = storage_lock(storage, shard, all)) != 0) {
+            data_release(&storage->arena, file_content);
 
-    for(i = 0; i < result_size - 1; i++) {
-        victim = select_victim(ht, storage->size.size_ht, exonerated);
+            return NULL;
+        }
 
-        strcpy(victims[i].metadata.filename, victim->metadata.filename);
+        // Verifica se il file con file->filename == filename esiste
+        if((file = lookup(&shard->ht, filename, hash)) == NULL) {
+            errno = ENOENT;
 
-        if(victim->data != NULL) {
-            victims[i].data = malloc((strlen(victim->data) + 1) * sizeof(char));
+            storage_unlock(storage, shard, all);
+            data_release(&storage->arena, file_content);
 
-            strcpy(victims[i].data, victim->data);
-        } else {
-            victims[i].data = malloc(2 * sizeof(char));
+            return NULL;
+        }
 
-            strcpy(victims[i].data, " ");
+        // Verifica se il file è in stato locked
+        if(check_locked(file, socket_fd) == -1) {
+            errno = EPERM;
+
+            storage_unlock(storage, shard, all);
+            data_release(&storage->arena, file_content);
+
+            return NULL;
         }
 
-        if(delete_file(storage, victim) == -1) {
+        // Verifica se il file è stato aperto dall'utente che ha richiesto l'operazione
+        if(check_opened(file, socket_fd) == 0) {
+            // Il file non è stato aperto
+            errno = EBADF;
+
+            storage_unlock(storage, shard, all);
+            data_release(&storage->arena, file_content);
+
             return NULL;
         }
 
-        storage->statistics.replaced_files += 1;
+        // Il contenuto precedente viene sostituito, quindi è necessario prenotare solo la differenza
+        delta = charge - file->metadata.charged;
+
+        if(all || delta <= 0 || reserve_bytes(storage, delta) == 0) {
+            break;
+        }
+
+        // Lo spazio non è sufficiente, ripete l'operazione possedendo tutte le partizioni per poter espellere dei file
+        storage_unlock(storage, shard, all);
+
+        all = 1;
+    }
+
+    if(all && delta > 0) {
+        if(delta > storage_available(storage)) {
+            printf("WORKER: È necessario il rimpiazzamento di uno o più file, spazio richiesto: %ld\n", delta);
+            victims = replace_files(storage, delta, file);
+        }
+
+        update_max_long(&storage->statistics.max_stored_bytes, atomic_fetch_add(&storage->size.occupied_bytes, delta) + delta);
+    }
+
+    // Il contenuto precedente è deallocato solo quando anche l'ultima lettura in corso lo rilascia
+    data_release(&storage->arena, file->data);
+
+    file->data = file_content;
+    file->metadata.size = content_size;
+    file->metadata.charged = charge;
+    touch_file(storage, file);
+
+    shard->occupied_bytes += delta;
+
+    if(delta < 0) {
+        atomic_fetch_add(&storage->size.occupied_bytes, delta);
     }
 
-    victims[result_size - 1].data = NULL;
+    log_printf(storage->log, "writeinfo:%s,%d [%s]\nwrite:%d\n", file->metadata.filename, file->metadata.size, get_timestamp(), file->metadata.size);
+
+    storage_unlock(storage, shard, all);
 
     return victims;
 }
 
-f_el *replace_file(storage *storage) {
-    FILE *log_file;
-
-    f_el **ht;
-    f_el *victim;
+f_data *readFile(storage *storage, char *filename, int socket_fd) {
+    shard *shard;
+    uint64_t hash;
+    f_el *file;
 
-    f_el *result;
+    f_data *result;
 
-    if(storage == NULL) {
+    if(storage == NULL || storage->shards == NULL || filename == NULL || socket_fd < 0) {
         errno = EINVAL;
 
+        return 0;
+    }
+
+    if(strlen(filename) > UNIX_PATH_MAX) {
+        errno = ENAMETOOLONG;
+
         return NULL;
     }
 
-    if(storage->ht == NULL) {
-        errno = EINVAL;
+    hash = hash_filename(filename);
+    shard = get_shard(storage, hash);
 
+    // La lettura non modifica la partizione, quindi può essere eseguita in parallelo con altre letture
+    if((errno = storage_rdlock(storage, shard, 0)) != 0) {
         return NULL;
     }
 
-    ht = storage->ht;
+    // Verifica se il file con file->filename == filename esiste
+    if((file = lookup(&shard->ht, filename, hash)) == NULL) {
+        errno = ENOENT;
+
+        storage_unlock(storage, shard, 0);
 
-    victim = select_victim(ht, storage->size.size_ht, NULL);
-    
-    if(victim == NULL) {
+        return NULL;
+    }
+
+    // Verifica se il file è in stato locked
+    if(check_locked(file, socket_fd) == -1) {
         errno = EPERM;
 
+        storage_unlock(storage, shard, 0);
+
         return NULL;
     }
 
-    printf("WORKER: il file %s, di dimensione %dbytes, verrà rimpiazzato\n", victim->metadata.filename, victim->metadata.size);
+    log_printf(storage->log, "readinfo:%s,%d [%s]\nread:%d\n", file->metadata.filename, file->metadata.size, get_timestamp(), file->metadata.size);
+
+    mark_used(file);
+
+    // Il file esiste, il riferimento è acquisito prima del rilascio della lock in modo che una scrittura concorrente non possa deallocare il buffer
+    // Un file vuoto non ha un buffer, la risposta non ha contenuto
+    result = file->data != NULL ? data_acquire(file->data) : NULL;
+    errno = 0;
 
-    log_file = fopen(storage->log_filename, "a");
-    fprintf(log_file, "replacefile:%s,%dbytes [%s]\n", victim->metadata.filename, victim->metadata.size, get_timestamp());
-    fclose(log_file);
+    storage_unlock(storage, shard, 0);
 
-    result = malloc(sizeof(f_el));
+    return result;
+}
 
-    strcpy(result->metadata.filename, victim->metadata.filename);
+f_el *readNFiles(storage *storage, read_cursor *cursor, int socket_fd, int *more) {
+    f_el *result = NULL;
+    f_el **tail = &result;
 
-    if(victim->data != NULL) {
-        result->data = malloc((strlen(victim->data) + 1) * sizeof(char));
+    int next;
 
-        strcpy(result->data, victim->data);
-    } else {
-        result->data = malloc(2 * sizeof(char));
+    if(storage == NULL || storage->shards == NULL || cursor == NULL || socket_fd < 0 || more == NULL) {
+        errno = EINVAL;
 
-        strcpy(result->data, " ");
+        return NULL;
     }
 
-    if(delete_file(storage, victim) == -1) {
+    // Ogni partizione è posseduta solo durante la propria visita, mai insieme alle altre, le partizioni senza file leggibili non terminano il passo
+    while((next = read_cursor_next(storage, cursor, socket_fd, &tail)) == 1 && result == NULL);
+
+    if(next == -1) {
+        release_victims(storage, result);
 
         return NULL;
     }
 
-    storage->statistics.replaced_files += 1;
+    *more = next;
+    errno = 0;
 
     return result;
 }
 
-int read_n_files_size(f_el **ht, int size, int n, int socket_fd) {
-    f_el *iterator;
+f_el *appendToFile(storage *storage, char *filename, int socket_fd, char *content, long size) {
+    shard *shard;
+    uint64_t hash;
+    f_el *victims = NULL;
+    f_el *file;
+    f_data *file_content;
+
+    long content_size;
+    long cost;
+    long charge;
 
-    int index;
+    int all = 0;
     int result = 0;
-    int remaining = n;
 
-    if(ht == NULL || size <= 0 || n < 0 || socket_fd < 0) {
+    // Verifica se i parametri sono validi
+    if(storage == NULL || storage->shards == NULL || filename == NULL || socket_fd < 0 || content == NULL || size < 0) {
         errno = EINVAL;
 
-        return -1;
-    }
-
-    if(n == 0) {
-        remaining = 1;
+        return NULL;
     }
 
-    for(index = 0; index < size; index++) {
-        iterator = ht[index];
+    if(strlen(filename) > UNIX_PATH_MAX) {
+        errno = ENAMETOOLONG;
 
-        while(iterator != NULL && remaining > 0) {
-            // Verifica se il file è in stato locked
-            if(check_locked(iterator, socket_fd) != -1) {
-                if(iterator->data != NULL) {
-                    result += strlen(iterator->metadata.filename) + 1 + strlen(iterator->data) + 1;
-                } else {
-                    result += strlen(iterator->metadata.filename) + 3;
-                }
+        return NULL;
+    }
 
-                if(n != 0) {
-                    remaining--;
-                }
-            }
+    hash = hash_filename(filename);
+    shard = get_shard(storage, hash);
+    content_size = size;
 
-            iterator = iterator->metadata.next_file;
+    while(1) {
+        if((errno = storage_lock(storage, shard, all)) != 0) {
+            return NULL;
         }
-    }
 
-    return result;
-}
+        // Verifica se il file con file->filename == filename esiste
+        if((file = lookup(&shard->ht, filename, hash)) == NULL) {
+            errno = ENOENT;
 
-int set_read_n_files(f_el **ht, int size, int n, char *result, FILE *log_file, int socket_fd) {
-    f_el *iterator;
+            storage_unlock(storage, shard, all);
 
-    struct timespec time;
+            return NULL;
+        }
 
-    int index;
-    int remaining = n;
-    int first = 1;
+        // Verifica se il file è in stato locked
+        if(check_locked(file, socket_fd) == -1) {
+            errno = EPERM;
 
-    char delimiter[2] = {1, '\0'};
+            storage_unlock(storage, shard, all);
 
-    if(ht == NULL || size <= 0 || n < 0 || log_file == NULL || socket_fd < 0) {
-        errno = EINVAL;
+            return NULL;
+        }
 
-        return -1;
-    }
+        // Verifica se il file è stato aperto dall'utente che ha richiesto l'operazione
+        if(check_opened(file, socket_fd) == 0) {
+            // Il file non è stato aperto
+            errno = EBADF;
 
-    if(n == 0) {
-        remaining = 1;
-    }
+            storage_unlock(storage, shard, all);
 
-    for(index = 0; index < size; index++) {
-        iterator = ht[index];
+            return NULL;
+        }
 
-        while(iterator != NULL && remaining > 0) {
-            if(check_locked(iterator, socket_fd) != -1) {
-                if(first) {
-                    strcpy(result, iterator->metadata.filename);
+        // Lo storage è occupato dai blocchi allocati per il contenuto, che può restare nello spazio libero dell'ultimo chunk
+        cost = file->data != NULL ? data_append_footprint(&storage->arena, file->data, content_size) : content_footprint(storage, content_size);
 
-                    first = 0;
-                } else {
-                    strcat(result, delimiter);
-                    strcat(result, iterator->metadata.filename);
-                }
+        // Verifica se c'è sufficiente spazio nello storage
+        if(file->metadata.size + content_size > storage->size.size_bytes || file->metadata.charged + cost > storage->size.size_bytes) {
+            errno = ENOMEM;
 
-                if(iterator->data != NULL) {
-                    strcat(result, delimiter);
-                    strcat(result, iterator->data);
-                } else {
-                    strcat(result, delimiter);
-                    strcat(result, " ");
-                }
+            storage_unlock(storage, shard, all);
 
-                clock_gettime(CLOCK_REALTIME, &time);
-                iterator->metadata.last_used = (long long int)time.tv_sec * 1000000000L + (long long int)time.tv_nsec;
+            return NULL;
+        }
 
-                fprintf(log_file, "readinfo:%s,%d [%s]\n", iterator->metadata.filename, iterator->metadata.size, get_timestamp());
-                fprintf(log_file, "read:%d\n", iterator->metadata.size);
+        if(all || reserve_bytes(storage, cost) == 0) {
+            break;
+        }
 
-                if(n != 0) {
-                    remaining--;
-                }
-            }
+        // Lo spazio non è sufficiente, ripete l'operazione possedendo tutte le partizioni per poter espellere dei file
+        storage_unlock(storage, shard, all);
 
-            iterator = iterator->metadata.next_file;
-        }
+        all = 1;
     }
 
-    return 0;
-}
+    if(all) {
+        if(cost > storage_available(storage)) {
+            printf("È necessario un rimpiazzamento del file, spazio richiesto: %ld\n", cost);
+            victims = replace_files(storage, cost, file);
+        }
 
-int clean_closed_conn(storage *storage, int socket_fd, int max) {
-    f_el **ht;
-    int size;
+        update_max_long(&storage->statistics.max_stored_bytes, atomic_fetch_add(&storage->size.occupied_bytes, cost) + cost);
+    }
 
-    if(storage == NULL || storage->ht == NULL || socket_fd < 0 || max <= 0) {
-        errno = EINVAL;
-        
-        return -1;
+    // Il contenuto è concatenato nei chunk del buffer, senza copiare i byte già presenti
+    if(file->data != NULL) {
+        result = data_append(&storage->arena, file->data, content, content_size);
+    } else if((file_content = create_content(storage, content, content_size)) != NULL) {
+        file->data = file_content;
+    } else {
+        result = -1;
     }
 
-    ht = storage->ht;
-    size = storage->size.size_ht;
+    if(result == -1) {
+        // Lo spazio riservato viene restituito, gli eventuali file espulsi sono già stati rimossi dallo storage
+        atomic_fetch_sub(&storage->size.occupied_bytes, cost);
 
-    if((errno = pthread_mutex_lock(&lock_storage)) != 0) {
-        return -1;
-    }
-    
-    clean_ht(ht, size, socket_fd, max);
+        storage_unlock(storage, shard, all);
 
-    pthread_mutex_unlock(&lock_storage);
+        release_victims(storage, victims);
 
-    return 0;
-}
+        errno = ENOMEM;
 
-void write_no_content(storage *storage) {
-    FILE *log_file;
+        return NULL;
+    }
 
-    if((errno = pthread_mutex_lock(&lock_storage)) != 0) {
-        return;
+    // Se il memfd non è stato creato il buffer è nell'arena, la memoria riservata in più viene restituita
+    charge = data_footprint(&storage->arena, file->data) - file->metadata.charged;
+
+    if(charge < cost) {
+        atomic_fetch_sub(&storage->size.occupied_bytes, cost - charge);
     }
 
-    log_file = fopen(storage->log_filename, "a");
-    fprintf(log_file, "write:0\n");
-    fclose(log_file);
+    file->metadata.size = data_size(file->data);
+    file->metadata.charged += charge;
+    touch_file(storage, file);
 
-    pthread_mutex_unlock(&lock_storage);
-}
+    shard->occupied_bytes += charge;
 
-char *get_timestamp() {
-    time_t act_time = time(NULL);
-    char *result = ctime(&act_time);
+    log_printf(storage->log, "writeinfo:%s,%d [%s]\nwrite:%d\n", file->metadata.filename, file->metadata.size, get_timestamp(), file->metadata.size);
 
-    result[strlen(result) - 1] = '\0';
+    storage_unlock(storage, shard, all);
 
-    return result;
+    return victims;
 }
-/*
- * Funzioni dell'api 
- */
-f_el *openFile(storage *storage, char *filename, int flags, int socket_fd, int max) {
-    f_el **ht;
 
+int lockFile(storage *storage, char *filename, int socket_fd) {
+    shard *shard;
+    uint64_t hash;
     f_el *file;
 
-    f_el *victim = NULL;
-
-    int created = 0;
+    int check;
 
-    // Verifica se filename e storage sono validi
-    if(storage == NULL || storage->ht == NULL || filename == NULL || socket_fd < 0 || max <= 0) {
+    if(storage == NULL || storage->shards == NULL || filename == NULL || socket_fd < 0) {
         errno = EINVAL;
 
-        return NULL;
+        return -1;
     }
 
-    ht = storage->ht;
-
-    if(strlen(filename) > UNIX_PATH_MAX) {
-        errno = ENAMETOOLONG;
+    hash = hash_filename(filename);
+    shard = get_shard(storage, hash);
 
-        return NULL;
+    if((errno = storage_lock(storage, shard, 0)) != 0) {
+        return -1;
     }
 
-    // Filename è valido
+    file = lookup(&shard->ht, filename, hash);
+
+    // Verifica se il file esiste
+    if(file == NULL) {
+        // Il file non esiste
+        errno = ENOENT;
 
-    if((errno = pthread_mutex_lock(&lock_storage)) != 0) {
+        storage_unlock(storage, shard, 0);
 
-        return NULL;
+        return -1;
     }
 
-    // Verifica se esiste già un file t.c file->filename == filename
-    if((file = lookup(ht, storage->size.size_ht, filename)) == NULL) {
-        // Il file non esiste verifica se il flag O_CREATE è impostato
-        if((flags & O_CREATE) == 0) {
-            // Il flag non è impostato, l'operazione fallisce
-            errno = ENOENT;
+    // Il file esiste
 
-            pthread_mutex_unlock(&lock_storage);
+    if((check = check_locked(file, socket_fd)) == -1) {
+        errno = EPERM;
 
-            return NULL;
-        }
+        storage_unlock(storage, shard, 0);
 
-        errno = 0;
-        // Il file non esiste ma il flag O_CREATE è impostato, quindi crea un nuovo file
-        if((victim = create_file(storage, filename, max)) == NULL && errno != 0) {
+        return -1;
+    }
 
-            pthread_mutex_unlock(&lock_storage);
+    if(check == 0) {
+        if(lock_file(storage, file, socket_fd, 0) == -1) {
+            storage_unlock(storage, shard, 0);
 
-            return NULL;
+            return -1;
         }
-
-        created = 1;
     }
 
-    // Il file esiste oppure è stato creato, verifica se il file è stato creato o era già esistente 
+    touch_file(storage, file);
 
-    if(created == 0) {
-        // Il file era già esistente, verifica se il flag O_CREATE è impostato 
-        if((flags & O_CREATE) != 0) {
-            // Il flag è impostato, l'operazione fallisce
-            errno = EEXIST;
+    storage_unlock(storage, shard, 0);
 
-            pthread_mutex_unlock(&lock_storage);
+    return 0;
+}
 
-            return NULL;
-        }
-    } else {
-        file = lookup(ht, storage->size.size_ht, filename);
+int unlockFile(storage *storage, char *filename, int socket_fd) {
+    shard *shard;
+    uint64_t hash;
+    f_el *file;
+
+    if(storage == NULL || storage->shards == NULL || filename == NULL || socket_fd < 0) {
+        errno = EINVAL;
+
+        return -1;
     }
 
-    // Il file è stato creato, oppure era già esistente e il flag O_CREATE non è impostato   
+    hash = hash_filename(filename);
+    shard = get_shard(storage, hash);
 
-    // Verifica se il file è stato già aperto dall'utente che ha richiesto l'operazione
-    if(check_opened(file, socket_fd, max) == 1) {
-        errno = EBADR;
+    if((errno = storage_lock(storage, shard, 0)) != 0) {
+        return -1;
+    }
 
-        pthread_mutex_unlock(&lock_storage);
+    file = lookup(&shard->ht, filename, hash);
 
-        return NULL;
+    // Verifica se il file esiste
+    if(file == NULL) {
+        // Il file non esiste
+        errno = ENOENT;
+
+        storage_unlock(storage, shard, 0);
+
+        return -1;
     }
 
-    // Il file non è stato ancora aperto
+    // Il file esiste
 
-    // Verifica se il flag O_LOCK è impostato
-    if(flags & O_LOCK) {
-        // Il flag è impostato, esegue il lock del file
-        if(lock_file(storage, file, socket_fd, 1) == -1) {
-            errno = EPERM;
+    if(check_locked(file, socket_fd) != 1) {
+        errno = EPERM;
 
-            pthread_mutex_unlock(&lock_storage);
+        storage_unlock(storage, shard, 0);
 
-            return NULL;
-        }
+        return -1;
+    }
 
-        open_file(storage, file, socket_fd, max, 0);
-    } else {
-        open_file(storage, file, socket_fd, max, 1);
+    if(unlock_file(storage, file, socket_fd) == -1) {
+        storage_unlock(storage, shard, 0);
+
+        return -1;
     }
 
-    pthread_mutex_unlock(&lock_storage);
+    touch_file(storage, file);
 
-    return victim;
+    storage_unlock(storage, shard, 0);
+
+    return 0;
 }
 
-int closeFile(storage *storage, char *filename, int socket_fd, int max) {
-    f_el **ht;
+int removeFile(storage *storage, char *filename, int socket_fd) {
+    shard *shard;
+    uint64_t hash;
     f_el *file;
 
-    if(storage == NULL || storage->ht == NULL || filename == NULL || socket_fd < 0 || max < 0) {
+    if(storage == NULL || storage->shards == NULL || filename == NULL || socket_fd < 0) {
         errno = EINVAL;
 
         return -1;
     }
 
-    ht = storage->ht;
-
-    if(strlen(filename) > UNIX_PATH_MAX) {
-        errno = ENAMETOOLONG;
+    hash = hash_filename(filename);
+    shard = get_shard(storage, hash);
 
+    if((errno = storage_lock(storage, shard, 0)) != 0) {
         return -1;
     }
 
-    // Filename è valido
+    file = lookup(&shard->ht, filename, hash);
+
+    // Verifica se il file esiste
+    if(file == NULL) {
+        // Il file non esiste
+        errno = ENOENT;
+
+        storage_unlock(storage, shard, 0);
 
-    if((errno = pthread_mutex_lock(&lock_storage)) != 0) {
         return -1;
     }
 
-    // Verifica se esiste un file t.c file->filename == filename
-    if((file = lookup(ht, storage->size.size_ht, filename)) == NULL) {
-        // Il file non esiste, l'operazione fallisce
-        errno = ENOENT;
+    // Verifica se il file è già locked
+    if(check_locked(file, socket_fd) != 1) {
+        errno = EPERM;
 
-        pthread_mutex_unlock(&lock_storage);
+        storage_unlock(storage, shard, 0);
 
         return -1;
     }
 
-    if(close_file(storage, file, socket_fd, max) == -1) {
+    if(delete_file(storage, file) == -1) {
+        storage_unlock(storage, shard, 0);
 
         return -1;
-    } 
+    }
 
-    pthread_mutex_unlock(&lock_storage);
+    log_printf(storage->log, "removefile:%s [%s]\n", filename, get_timestamp());
+
+    storage_unlock(storage, shard, 0);
 
     return 0;
 }
 
-f_el *writeFile(storage *storage, char *filename, int socket_fd, char *content, int max) {
-    FILE *log_file;
-
-    f_el **ht;
+f_el *putFile(storage *storage, char *filename, int socket_fd, char *content, long size, f_data *data) {
+    shard *shard;
+    uint64_t hash;
     f_el *victims = NULL;
     f_el *file;
 
-    struct timespec time;
+    f_data *file_content = NULL;
+
+    long charge;
 
-    char *file_content;
+    int all = 0;
 
     // Verifica se i parametri sono validi
-    if(storage == NULL || storage->ht == NULL || filename == NULL || socket_fd < 0 || content == NULL || max <= 0) {
+    if(storage == NULL || storage->shards == NULL || filename == NULL || socket_fd < 0 || (content == NULL && data == NULL) || size < 0) {
         errno = EINVAL;
 
         return NULL;
     }
 
-    ht = storage->ht;
-
     if(strlen(filename) > UNIX_PATH_MAX) {
         errno = ENAMETOOLONG;
 
         return NULL;
     }
 
-    if((errno = pthread_mutex_lock(&lock_storage)) != 0) {
+    if(size > storage->size.size_bytes) {
+        errno = ENOMEM;
+
         return NULL;
     }
 
-    // Verifica se il file con file->filename == filename esiste
-    if((file = lookup(ht, storage->size.size_ht, filename)) == NULL) {
-        errno = ENOENT;
-
-        pthread_mutex_unlock(&lock_storage);
+    // Il buffer è allocato prima di acquisire la lock, in modo che la partizione sia posseduta solo per l'inserimento del file
+    if(size > 0 && (file_content = data != NULL ? data_acquire(data) : create_content(storage, content, size)) == NULL) {
+        errno = ENOMEM;
 
         return NULL;
     }
 
-    // Verifica se il file è in stato locked
-    if(check_locked(file, socket_fd) == -1) {
-        errno = EPERM;
+    // Lo storage è occupato dai blocchi del contenuto, che possono superare la sua dimensione
+    if((charge = data_footprint(&storage->arena, file_content)) > storage->size.size_bytes) {
+        errno = ENOMEM;
 
-        pthread_mutex_unlock(&lock_storage);
+        data_release(&storage->arena, file_content);
 
         return NULL;
     }
 
-    // Verifica se il file è stato aperto dall'utente che ha richiesto l'operazione
-    if(check_opened(file, socket_fd, max) == 0) {
-        // Il file non è stato aperto 
-        errno = EBADF;
+    hash = hash_filename(filename);
+    shard = get_shard(storage, hash);
 
-        pthread_mutex_unlock(&lock_storage);
+    while(1) {
+        if((errno = storage_lock(storage, shard, all)) != 0) {
+            data_release(&storage->arena, file_content);
 
-        return NULL;
-    }
+            return NULL;
+        }
 
-    // Verifica se c'è sufficiente spazio nello storage
-    if(strlen(content) > storage->size.size_bytes) {
-        errno = ENOMEM;
+        if(lookup(&shard->ht, filename, hash) != NULL) {
+            errno = EEXIST;
 
-        pthread_mutex_unlock(&lock_storage);
+            storage_unlock(storage, shard, all);
+            data_release(&storage->arena, file_content);
 
-        return NULL;
-    }
+            return NULL;
+        }
+
+        // Senza tutte le partizioni non è possibile espellere file, quindi lo spazio per il contenuto deve essere disponibile
+        if(all || charge == 0 || reserve_bytes(storage, charge) == 0) {
+            errno = 0;
+
+            if((victims = create_file(storage, shard, filename, hash, all)) != NULL || errno == 0) {
+                break;
+            }
+
+            if(!all && charge > 0) {
+                atomic_fetch_sub(&storage->size.occupied_bytes, charge);
+            }
+
+            storage_unlock(storage, shard, all);
+
+            if(errno != EAGAIN) {
+                data_release(&storage->arena, file_content);
+
+                return NULL;
+            }
+        } else {
+            storage_unlock(storage, shard, all);
+        }
 
-    if(strlen(content) > (storage->size.size_bytes - storage->size.occupied_bytes)) {
-        printf("WORKER: È necessario il rimpiazzamento di uno o più file, spazio richiesto: %ld\n", strlen(content));
-        victims = replace_files(storage, strlen(content), file->metadata.filename);
+        // Lo storage è pieno, ripete l'operazione possedendo tutte le partizioni per poter espellere dei file
+        all = 1;
     }
 
-    // Alloca la stringa per contenere il contenuto del file
-    file_content = malloc((strlen(content) + 1) * sizeof(char));
+    file = lookup(&shard->ht, filename, hash);
 
-    strcpy(file_content, content);
+    log_printf(storage->log, "openlock:%s [%s]\n", filename, get_timestamp());
 
-    // Verifica se il file aveva già un contenuto
-    if(file->data != NULL) {
-        storage->size.occupied_bytes = storage->size.occupied_bytes - strlen(file->data);
+    if(all && charge > 0) {
+        if(charge > storage_available(storage)) {
+            printf("WORKER: È necessario il rimpiazzamento di uno o più file, spazio richiesto: %ld\n", charge);
 
-        free(file->data);
+            // Le vittime del contenuto seguono l'eventuale vittima della creazione
+            if(victims == NULL) {
+                victims = replace_files(storage, charge, file);
+            } else {
+                victims->metadata.lru_next = replace_files(storage, charge, file);
+            }
+        }
+
+        update_max_long(&storage->statistics.max_stored_bytes, atomic_fetch_add(&storage->size.occupied_bytes, charge) + charge);
     }
 
     file->data = file_content;
-    clock_gettime(CLOCK_REALTIME, &time);
-    file->metadata.last_used = (long long int)time.tv_sec * 1000000000L + (long long int)time.tv_nsec;
-    file->metadata.last_used = (long long int)time.tv_sec * 1000000000L + (long long int)time.tv_nsec;
-    file->metadata.size = strlen(file->data);
+    file->metadata.size = size;
+    file->metadata.charged = charge;
+    touch_file(storage, file);
 
-    log_file = fopen(storage->log_filename, "a");
-    fprintf(log_file, "writeinfo:%s,%d [%s]\n", file->metadata.filename, file->metadata.size, get_timestamp());
-    fprintf(log_file, "write:%d\n", file->metadata.size);
-    fclose(log_file);
+    shard->occupied_bytes += charge;
 
-    storage->size.occupied_bytes += strlen(file->data);
-    if(storage->size.occupied_bytes > storage->statistics.max_stored_bytes) {
-        storage->statistics.max_stored_bytes = storage->size.occupied_bytes;
+    if(size > 0) {
+        log_printf(storage->log, "writeinfo:%s,%d [%s]\nwrite:%d\n", file->metadata.filename, file->metadata.size, get_timestamp(), file->metadata.size);
+    } else {
+        write_no_content(storage);
     }
 
-    pthread_mutex_unlock(&lock_storage);
+    log_printf(storage->log, "closefile:%s [%s]\n", filename, get_timestamp());
+
+    storage_unlock(storage, shard, all);
 
     return victims;
 }
 
-char *readFile(storage *storage, char *filename, int socket_fd) {
-    FILE *log_file;
+f_data *getFile(storage *storage, char *filename, int socket_fd) {
+    f_data *result;
 
-    struct timespec time;
+    // La ricerca, la verifica della lock e l'acquisizione del riferimento al contenuto sono eseguite con una sola lock in lettura
+    if((result = readFile(storage, filename, socket_fd)) != NULL || errno == 0) {
+        log_printf(storage->log, "openlock:%s [%s]\n", filename, get_timestamp());
+        log_printf(storage->log, "closefile:%s [%s]\n", filename, get_timestamp());
+    }
 
+    return result;
+}
+
+f_data *readFileRange(storage *storage, char *filename, int socket_fd, long offset, long length, long *size) {
+    shard *shard;
+    uint64_t hash;
     f_el *file;
+    f_data *result = NULL;
 
-    char *result;
+    long file_size;
 
-    if(storage == NULL || storage->ht == NULL || filename == NULL || socket_fd < 0) {
+    if(storage == NULL || storage->shards == NULL || filename == NULL || socket_fd < 0 || offset < 0 || length < 0 || size == NULL) {
         errno = EINVAL;
 
-        return 0;
+        return NULL;
     }
 
     if(strlen(filename) > UNIX_PATH_MAX) {
@@ -1175,15 +2298,19 @@ char *readFile(storage *storage, char *filename, int socket_fd) {
         return NULL;
     }
 
-    if((errno = pthread_mutex_lock(&lock_storage)) != 0) {
+    hash = hash_filename(filename);
+    shard = get_shard(storage, hash);
+
+    // La lettura non modifica la partizione, quindi può essere eseguita in parallelo con altre letture
+    if((errno = storage_rdlock(storage, shard, 0)) != 0) {
         return NULL;
     }
 
     // Verifica se il file con file->filename == filename esiste
-    if((file = lookup(storage->ht, storage->size.size_ht, filename)) == NULL) {
+    if((file = lookup(&shard->ht, filename, hash)) == NULL) {
         errno = ENOENT;
 
-        pthread_mutex_unlock(&lock_storage);
+        storage_unlock(storage, shard, 0);
 
         return NULL;
     }
@@ -1192,74 +2319,50 @@ char *readFile(storage *storage, char *filename, int socket_fd) {
     if(check_locked(file, socket_fd) == -1) {
         errno = EPERM;
 
-        pthread_mutex_unlock(&lock_storage);
+        storage_unlock(storage, shard, 0);
 
         return NULL;
     }
 
-    log_file = fopen(storage->log_filename, "a");
-    fprintf(log_file, "readinfo:%s,%d [%s]\n", file->metadata.filename, file->metadata.size, get_timestamp());
-    fprintf(log_file, "read:%d\n", file->metadata.size);
-    fclose(log_file);
-
-    pthread_mutex_unlock(&lock_storage);
-
-    clock_gettime(CLOCK_REALTIME, &time);
-    file->metadata.last_used = (long long int)time.tv_sec * 1000000000L + (long long int)time.tv_nsec;
-
-    // Il file esiste
-    if(file->data != NULL) {
-        result = file->data;
-    } else {
-        result = " ";
-    }
-
-    return result;
-}
-
-char *readNFiles(storage *storage, int n, int socket_fd) {
-    FILE *log_file;
+    file_size = file->data != NULL ? data_size(file->data) : 0;
 
-    char *result;
-    int result_size = 0;
+    // L'intervallo è limitato alla fine del file
+    *size = offset < file_size ? (file_size - offset < length ? file_size - offset : length) : 0;
 
-    if(storage == NULL || storage->ht == NULL || n < 0 || socket_fd < 0) {
-        errno = EINVAL;
+    log_printf(storage->log, "readinfo:%s,%ld [%s]\nread:%ld\n", file->metadata.filename, *size, get_timestamp(), *size);
 
-        return NULL;
-    }
+    mark_used(file);
 
-    if((errno = pthread_mutex_lock(&lock_storage)) != 0) {
-        return NULL;
+    // Il riferimento è acquisito prima del rilascio della lock, una scrittura concorrente copia il buffer invece di modificarlo
+    if(*size > 0) {
+        result = data_acquire(file->data);
     }
 
-    result_size = read_n_files_size(storage->ht, storage->size.size_ht, n, socket_fd);
-
-    result = malloc((result_size + 1) * sizeof(char));
-
-    strcpy(result, "");
+    storage_unlock(storage, shard, 0);
 
-    log_file = fopen(storage->log_filename, "a");
-    set_read_n_files(storage->ht, storage->size.size_ht, n, result, log_file, socket_fd);
-    fclose(log_file);
-
-    pthread_mutex_unlock(&lock_storage);
+    errno = 0;
 
     return result;
 }
 
-f_el *appendToFile(storage *storage, char *filename, int socket_fd, char *content, int max) {
-    FILE *log_file;
-    f_el **ht;
-
+f_el *writeFileAt(storage *storage, char *filename, int socket_fd, long offset, char *content, long size) {
+    shard *shard;
+    uint64_t hash;
     f_el *victims = NULL;
     f_el *file;
-    char *file_content;
+    f_data *file_content;
 
-    struct timespec time;
+    long file_size;
+    long extra;
+    long cost;
+    long charge;
+
+    int all = 0;
+    int clone = 0;
+    int result = 0;
 
     // Verifica se i parametri sono validi
-    if(storage == NULL || storage->ht == NULL || filename == NULL || socket_fd < 0 || content == NULL || max <= 0) {
+    if(storage == NULL || storage->shards == NULL || filename == NULL || socket_fd < 0 || content == NULL || size < 0 || offset < 0) {
         errno = EINVAL;
 
         return NULL;
@@ -1271,249 +2374,156 @@ f_el *appendToFile(storage *storage, char *filename, int socket_fd, char *conten
         return NULL;
     }
 
-    ht = storage->ht;
-
-    if((errno = pthread_mutex_lock(&lock_storage)) != 0) {
-        return NULL;
-    }
-
-    // Verifica se il file con file->filename == filename esiste
-    if((file = lookup(ht, storage->size.size_ht, filename)) == NULL) {
-        errno = ENOENT;
-
-        return NULL;
-    }
-
-    // Verifica se il file è in stato locked
-    if(check_locked(file, socket_fd)) {
-        errno = EPERM;
+    hash = hash_filename(filename);
+    shard = get_shard(storage, hash);
 
-        pthread_mutex_unlock(&lock_storage);
+    while(1) {
+        if((errno = storage_lock(storage, shard, all)) != 0) {
+            return NULL;
+        }
 
-        return NULL;
-    }
+        // Verifica se il file con file->filename == filename esiste
+        if((file = lookup(&shard->ht, filename, hash)) == NULL) {
+            errno = ENOENT;
 
-    // Verifica se il file è stato aperto dall'utente che ha richiesto l'operazione
-    if(check_opened(file, socket_fd, max)) {
-        // Il file non è stato aperto 
-        errno = EBADF;
+            storage_unlock(storage, shard, all);
 
-        pthread_mutex_unlock(&lock_storage);
+            return NULL;
+        }
 
-        return NULL;
-    }
+        // Verifica se il file è in stato locked
+        if(check_locked(file, socket_fd) == -1) {
+            errno = EPERM;
 
-    // Verifica se c'è sufficiente spazio nello storage
-    if(file->data != NULL) {
-        if(strlen(file->data) + strlen(content) > storage->size.size_bytes){
-            errno = ENOMEM;
+            storage_unlock(storage, shard, all);
 
             return NULL;
         }
-    }
-
-    if(strlen(content) >= (storage->size.size_bytes - storage->size.occupied_bytes)) {
-        printf("È necessario un rimpiazzamento del file, spazio richiesto: %ld\n", strlen(content));
-        victims = replace_files(storage, strlen(content), file->metadata.filename);
-    }
-
-    // Alloca la stringa per contenere il contenuto del file
 
-    if(file->data != NULL) {
-        file_content = malloc((strlen(file->data) + strlen(content) + 1) * sizeof(char));
-    } else {
-        file_content = malloc((strlen(content) + 1) * sizeof(char));
-    }
+        // Verifica se il file è stato aperto dall'utente che ha richiesto l'operazione
+        if(check_opened(file, socket_fd) == 0) {
+            errno = EBADF;
 
-    strcpy(file_content, file->data);
-    strcat(file_content, content);
+            storage_unlock(storage, shard, all);
 
-    if(file->data != NULL) {
-        free(file->data);
-    }
+            return NULL;
+        }
 
-    file->data = file_content;
-    clock_gettime(CLOCK_REALTIME, &time);
-    file->metadata.last_used = (long long int)time.tv_sec * 1000000000L + (long long int)time.tv_nsec;
-    file->metadata.size = strlen(file->data);
+        file_size = file->metadata.size;
 
-    log_file = fopen(storage->log_filename, "a");
-    fprintf(log_file, "writeinfo:%s,%d [%s]\n", file->metadata.filename, file->metadata.size, get_timestamp());
-    fprintf(log_file, "write:%d\n", file->metadata.size);
-    fclose(log_file);
+        // Il file non può contenere buchi, quindi la scrittura deve iniziare al più alla fine del contenuto
+        if(offset > file_size) {
+            errno = EINVAL;
 
-    storage->size.occupied_bytes = storage->size.occupied_bytes + strlen(file->data);
-    if(storage->size.occupied_bytes > storage->statistics.max_stored_bytes) {
-        storage->statistics.max_stored_bytes = storage->size.occupied_bytes;
-    }
+            storage_unlock(storage, shard, all);
 
-    pthread_mutex_unlock(&lock_storage);
+            return NULL;
+        }
 
-    return victims;
-}
+        // Solo i byte oltre la fine del file occupano nuovo spazio nello storage
+        extra = offset + size > file_size ? offset + size - file_size : 0;
 
-int lockFile(storage *storage, char *filename, int socket_fd) {
-    f_el **ht;
-    f_el *file;
+        // Una risposta in corso di invio possiede il buffer, i byte che sta inviando non possono essere sovrascritti
+        clone = file->data != NULL && offset < file_size && data_shared(file->data);
 
-    struct timespec time;
+        // Lo storage è occupato dai blocchi allocati per il contenuto: un nuovo buffer, la copia che sostituisce il buffer oppure il chunk dei byte oltre la fine del file
+        if(file->data == NULL) {
+            cost = content_footprint(storage, size);
+        } else if(clone) {
+            cost = file->data->fd != -1 ? content_footprint(storage, file_size + extra) : data_alloc_footprint(&storage->arena, file_size + extra, 0);
+            cost -= file->metadata.charged;
+        } else {
+            cost = data_append_footprint(&storage->arena, file->data, extra);
+        }
 
-    int check;
+        // La copia può occupare meno memoria del buffer, la differenza è restituita dopo la scrittura
+        cost = cost > 0 ? cost : 0;
 
-    if(storage == NULL || storage->ht == NULL || filename == NULL || socket_fd < 0) {
-        errno = EINVAL;
+        // Verifica se c'è sufficiente spazio nello storage
+        if(file_size + extra > storage->size.size_bytes || file->metadata.charged + cost > storage->size.size_bytes) {
+            errno = ENOMEM;
 
-        return -1;
-    }
+            storage_unlock(storage, shard, all);
 
-    ht = storage->ht;
- 
-    if((errno = pthread_mutex_lock(&lock_storage)) != 0) {
-        return -1;
-    }
-    
-    file = lookup(ht, storage->size.size_ht, filename);
+            return NULL;
+        }
 
-    // Verifica se il file esiste
-    if(file == NULL) {
-        // Il file non esiste
-        errno = ENOENT;
+        if(all || reserve_bytes(storage, cost) == 0) {
+            break;
+        }
 
-        pthread_mutex_unlock(&lock_storage);
+        // Lo spazio non è sufficiente, ripete l'operazione possedendo tutte le partizioni per poter espellere dei file
+        storage_unlock(storage, shard, all);
 
-        return -1;
+        all = 1;
     }
-    
-    // Il file esiste
 
-    if((check = check_locked(file, socket_fd)) == -1) {
-        errno = EPERM;
-
-        pthread_mutex_unlock(&lock_storage);
+    if(all) {
+        if(cost > storage_available(storage)) {
+            printf("È necessario un rimpiazzamento del file, spazio richiesto: %ld\n", cost);
+            victims = replace_files(storage, cost, file);
+        }
 
-        return -1;
+        update_max_long(&storage->statistics.max_stored_bytes, atomic_fetch_add(&storage->size.occupied_bytes, cost) + cost);
     }
 
-    if(check == 0) {
-        if(lock_file(storage, file, socket_fd, 0) == -1) {
-            pthread_mutex_unlock(&lock_storage);
+    if(file->data == NULL) {
+        // Il file è vuoto, quindi offset == 0
+        if((file_content = create_content(storage, content, size)) != NULL) {
+            file->data = file_content;
+        } else {
+            result = -1;
+        }
+    } else {
+        // La copia ha già spazio per i byte oltre la fine del file, che non richiedono nuovi chunk
+        if(clone) {
+            if((file_content = data_clone(&storage->arena, file->data, file_size + extra)) != NULL) {
+                data_release(&storage->arena, file->data);
+
+                file->data = file_content;
+            } else {
+                result = -1;
+            }
+        }
 
-            return -1;
+        if(result == 0) {
+            result = data_write(&storage->arena, file->data, offset, content, size);
         }
     }
 
-    clock_gettime(CLOCK_REALTIME, &time);
-    file->metadata.last_used = (long long int)time.tv_sec * 1000000000L + (long long int)time.tv_nsec;
-
-    pthread_mutex_unlock(&lock_storage);
-
-    return 0;
-}
-
-int unlockFile(storage *storage, char *filename, int socket_fd) {
-    f_el **ht;
-    f_el *file;
+    if(result == -1) {
+        // Lo spazio riservato viene restituito, gli eventuali file espulsi sono già stati rimossi dallo storage
+        atomic_fetch_sub(&storage->size.occupied_bytes, cost);
 
-    struct timespec time;
+        storage_unlock(storage, shard, all);
 
-    if(storage == NULL || storage->ht == NULL || filename == NULL || socket_fd < 0) {
-        errno = EINVAL;
+        release_victims(storage, victims);
 
-        return -1;
-    }
+        errno = ENOMEM;
 
-    ht = storage->ht;
- 
-    if((errno = pthread_mutex_lock(&lock_storage)) != 0) {
-        return -1;
+        return NULL;
     }
-    
-    file = lookup(ht, storage->size.size_ht, filename);
-
-    // Verifica se il file esiste
-    if(file == NULL) {
-        // Il file non esiste
-        errno = ENOENT;
 
-        pthread_mutex_unlock(&lock_storage);
+    // La memoria riservata è corretta con quella occupata, ad esempio se il memfd non è stato creato oppure la copia occupa meno blocchi
+    charge = data_footprint(&storage->arena, file->data) - file->metadata.charged;
 
-        return -1;
+    if(charge != cost) {
+        atomic_fetch_add(&storage->size.occupied_bytes, charge - cost);
     }
-    
-    // Il file esiste
-
-    if(check_locked(file, socket_fd) != 1) {
-        errno = EPERM;
 
-        pthread_mutex_unlock(&lock_storage);
+    file->metadata.size = data_size(file->data);
+    file->metadata.charged += charge;
+    touch_file(storage, file);
 
-        return -1;
-    }
-
-    if(unlock_file(storage, file, socket_fd) == -1) {
-        pthread_mutex_unlock(&lock_storage);
+    shard->occupied_bytes += charge;
 
-        return -1;
-    }
+    log_printf(storage->log, "writeinfo:%s,%ld [%s]\nwrite:%ld\n", file->metadata.filename, size, get_timestamp(), size);
 
-    clock_gettime(CLOCK_REALTIME, &time);
-    file->metadata.last_used = (long long int)time.tv_sec * 1000000000L + (long long int)time.tv_nsec;
+    storage_unlock(storage, shard, all);
 
-    pthread_mutex_unlock(&lock_storage);
+    errno = 0;
 
-    return 0;
+    return victims;
 }
 
-int removeFile(storage *storage, char *filename, int socket_fd) {
-    FILE *log_file;
-
-    f_el **ht;
-    f_el *file;
-    
-    if(storage == NULL || storage->ht == NULL || filename == NULL || socket_fd < 0) {
-        errno = EINVAL;
-
-        return -1;
-    }
-
-    ht = storage->ht;
-
-    if((errno = pthread_mutex_lock(&lock_storage)) != 0) {
-        return -1;
-    }
-
-    file = lookup(ht, storage->size.size_ht, filename);
-
-    // Verifica se il file esiste
-    if(file == NULL) {
-        // Il file non esiste
-        errno = ENOENT;
-        
-        pthread_mutex_unlock(&lock_storage);
-
-        return -1;
-    }
-
-    // Verifica se il file è già locked
-    if(check_locked(file, socket_fd) != 1) {
-        errno = EPERM;
-
-        pthread_mutex_unlock(&lock_storage);
-
-        return -1;
-    }
-
-    if(delete_file(storage, file) == -1) {
-        pthread_mutex_unlock(&lock_storage);
-
-        return -1;
-    }
-
-    log_file = fopen(storage->log_filename, "a");
-    fprintf(log_file, "removefile:%s [%s]\n", filename, get_timestamp());
-    fclose(log_file);
-
-    pthread_mutex_unlock(&lock_storage);
-
-    return 0;
-}
\ No newline at end of file
+#endif
@@ -1,13 +1,13 @@
 #include <limits.h>
+#include "io_utils.h"
 #define UNIX_PATH_MAX 108
+#define WORKER_BATCH 4                          // Numero massimo di richieste estratte insieme dalla queue delle richieste
 
 struct worker_arg{
-    request_queue_el **head_request;            // Il puntatore al puntatore alla testa della queue da cui ottenere i file descriptor pronti per la lettura
-    resolved_queue_el **head_resolved;          // Il puntatore al puntatore alla testa della queue in cui inserire i file descriptor riguardanti richieste elaborate
-    resolved_queue_el **tail_resolved;          // Il puntatore al puntatore alla coda della queue in cui inserire i file descriptor riguardanti richieste elaborate
+    request_queue *requests;                    // Il puntatore alla queue da cui ottenere le richieste ricevute per intero dal manager
+    resolved_queue *resolved;                   // Il puntatore alla queue in cui inserire i file descriptor riguardanti richieste elaborate
     storage *storage;                           // Il puntatore alla struct che modella lo storage
     int thread_n;                               // Il numero identificativo del worker
-    int max_conn;                               // Il numero massimo di connessioni che possono essere attive contemporaneamente
     int *served_request;                        // Il puntatore al contatore di richieste elaborate dal worker
 };
 
@@ -25,31 +25,50 @@ void *main_worker(void *arg);
  * Verifica la tipologia di richiesta ricevuta e la gestisce in modo appropriato
  * Parametri: 
  *      storage: il puntatore allo storage su cui eseguire le operazioni richieste
- *      request: la richiesta ricevuta dal client
+ *      header: l'intestazione della richiesta ricevuta dal client
+ *      request: il corpo della richiesta, contiene il filename terminato da '\0' seguito dal payload terminato da '\0'
+ *      data: il buffer in cui è stato ricevuto il payload, passato allo storage senza copiarlo, NULL se il payload è nel corpo della richiesta; resta posseduto dal chiamante
+ *      cursor: il cursore di una lettura di n file, inizializzato dal primo passo e avanzato da ogni passo successivo
  *      socket_fd: il file descriptor del socket da cui si è ricevuta la richiesta
- *      max: il numero massimo di connessioni che possono essere attive contemporaneamente
- * Ritorna: 0 se la richiesta è soddisfatta correttamente, -1 in caso di errore,  imposta errno adeguatamente
+ *      resp: il puntatore in cui memorizzare la risposta da inviare, che il manager invia e dealloca, NULL se non è stato possibile allocarla
+ *            Se la risposta ha il flag MORE_FRAMES la lettura di n file non è terminata e la richiesta deve essere elaborata di nuovo dopo l'invio della risposta
+ * Ritorna: 0 se la richiesta è soddisfatta correttamente, 1 se la connessione deve essere chiusa, -1 in caso di errore,  imposta errno adeguatamente
  */
-int check_request(storage *storage, char *request, int socket_fd, int max);
+int check_request(storage *storage, frame_header *header, char *request, f_data *data, read_cursor *cursor, int socket_fd, response **resp);
 
-static void cleanup_handler(void *arg);
+/*
+ * Descrive i file espulsi dallo storage, oppure i file fissati da readNFiles, come sequenza di frame da inviare come payload della risposta, senza copiarne il contenuto
+ * Ogni frame occupa tre buffer: l'intestazione, il filename e il contenuto, che restano nel file espulso fino al termine dell'invio
+ * L'origine dei buffer è allocata nello stesso blocco dell'array di buffer, subito dopo l'ultimo buffer
+ * Parametri:
+ *      victims: la lista dei file espulsi, collegati tramite metadata.lru_next
+ *      discard: 1 se il client ha richiesto DISCARD_VICTIMS, in tal caso i frame contengono solo il filename e la dimensione
+ *      headers: il puntatore in cui memorizzare l'array delle intestazioni dei frame, da deallocare dopo l'invio
+ *      src: il puntatore in cui memorizzare l'array delle origini dei buffer, parallelo all'array di buffer
+ *      iovcnt: il puntatore in cui memorizzare il numero di buffer, inclusa l'intestazione della risposta
+ *      size: il puntatore in cui memorizzare la dimensione del payload
+ * Errno:
+ *      ENOMEM: se non è possibile allocare i buffer
+ * Ritorna: l'array di buffer da deallocare dopo l'invio, il primo elemento è riservato all'intestazione della risposta, NULL in caso di errore
+ */
+struct iovec *encode_victims(f_el *victims, int discard, frame_header **headers, data_source **src, int *iovcnt, long *size);
 
 void *main_worker(void *arg) {
     worker_arg *args = (worker_arg *)arg;
 
-    request_queue_el **head_request = args->head_request;
-    resolved_queue_el **head_resolved = args->head_resolved;
-    resolved_queue_el **tail_resolved = args->tail_resolved;
+    request_queue *requests = args->requests;
+    resolved_queue *resolved = args->resolved;
     storage *storage = args->storage;
     int *served_request = (int *)args->served_request;
     int thread_n = args->thread_n;
-    int max_conn = args->max_conn;
 
-    int request_size;
-    void *request;
+    request *reqs[WORKER_BATCH];
+    request *req;
+    response *resp;
     int socket_fd;
+    int n_reqs;
     int result;
-    int o_state;
+    int i;
     
     struct sigaction sigpipe;
     memset(&sigpipe, 0, sizeof(sigpipe));
@@ -61,379 +80,292 @@ void *main_worker(void *arg) {
         pthread_exit((void *)1);
     }
 
-    pthread_cleanup_push(cleanup_handler, NULL);
+    // Le operazioni eseguite dal worker sono registrate sul suo buffer dedicato del logger
+    log_register(storage->log, thread_n);
 
     while(1) {
-        result = 0;
+        // Ottiene fino a WORKER_BATCH richieste già ricevute per intero dal manager, oppure si mette in attesa che una diventi pronta
+        if((n_reqs = pop_requests(requests, reqs, WORKER_BATCH)) == -1) {
+            if(errno == ESHUTDOWN) {
+                // La queue è stata chiusa, il server sta terminando
+                break;
+            }
 
-        // Ottiene un file descriptor pronto per essere letto, oppure si mette in attesa in attesa che uno diventi pronto
-        if((socket_fd = pop_request(head_request)) == -1) {
             printf("WORKER %d:", thread_n);
             perror("Ottenendo la richiesta: ");
-        } else {
-            // Disattiva la possibilità di interrompere il worker fino a che la richiesta non è soddisfatta completamente, necessario per evitare che il sistema venga lasciato in uno stato inconsistente
-            pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &o_state);
 
-            // Legge la dimensione della richiesta
-            if(read(socket_fd, &request_size, sizeof(int)) == -1) {
-                printf("WORKER %d: ERRORE socket: %d", thread_n, socket_fd);
-                perror("Leggendo dal socket");
-
-                result = 1;
-            } else {
-                request = malloc(request_size * sizeof(char));
-                memset(request, 0, request_size);
+            continue;
+        }
 
-                // Legge la richiesta
-                if(read(socket_fd, request, request_size) == -1) {
-                    printf("WORKER %d:", thread_n);
-                    perror("Leggendo dal socket");
+        for(i = 0; i < n_reqs; i++) {
+            req = reqs[i];
+            socket_fd = req->fd;
 
-                    result = 1;
-                }
-            }
+            printf("WORKER %d: ha ricevuto la richiesta %d, dal socket: %d \n", thread_n, req->header.opcode, socket_fd);
 
-            printf("WORKER %d: ha ricevuto la richiesta %c, dal socket: %d \n", thread_n, ((char *)request)[0], socket_fd);
+            // Elabora la richiesta, il worker non legge né scrive mai sul socket e quindi non attende client lenti
+            result = check_request(storage, &req->header, req->body, req->data, &req->cursor, socket_fd, &resp);
 
-            if(result != 1) {
-                // Elabora la richiesta
-                result = check_request(storage, (char *)request, socket_fd, max_conn);
+            *served_request += 1;
 
-                *served_request += 1;
+            if(resp != NULL) {
+                // Il manager usa la chiave per assegnare ai worker le richieste sullo stesso file rimaste in attesa
+                resp->key = req->key;
+            }
 
-                free(request);
+            if(resp != NULL && (resp->header.flags & MORE_FRAMES)) {
+                // La lettura di n file prosegue con il cursore della richiesta, che il manager assegna di nuovo ai worker dopo l'invio della risposta
+                req->header.flags |= MORE_FRAMES;
+                resp->resume = req;
+            } else {
+                // Se il payload è passato allo storage viene rilasciato solo il riferimento della richiesta
+                free_request(req);
             }
 
             if(result == -1) {
-                // Si è verificato un errore 
+                // Si è verificato un errore, la risposta viene comunque consegnata e la connessione rimane aperta
 
                 printf("WORKER %d:", thread_n);
                 perror("Elaborando la richiesta");
-            } else if(result == 0) {
-                // Richiesta soddisfatta, la connessione rimane aperta per altre richieste
-
-                if(push_resolved(head_resolved, tail_resolved, socket_fd, 0) == NULL) {
-                    printf("WORKER %d:", thread_n);
-                    perror("Inserendo la richiesta soddisfatta");
-                }
-            } else if(result == 1) {
-                // È arrivata una richiesta di chiusura della connessione, la connessione deve essere chiusa
-                if(push_resolved(head_resolved, tail_resolved, socket_fd, 1) == NULL) {
-                    printf("WORKER %d:", thread_n);
-                    perror("Inserendo la richiesta soddisfatta");
-                }
+
+                result = 0;
             }
 
-            // Ripristina la possibilità di cancellare il worker, ora lo stato rimane consistente
-            pthread_setcancelstate(o_state, &o_state);
+            // La risposta passa al manager, che la invia senza bloccarsi e chiude la connessione se result == 1
+            if(push_resolved(resolved, socket_fd, result, resp) == -1) {
+                printf("WORKER %d:", thread_n);
+                perror("Inserendo la richiesta soddisfatta");
+
+                response_free(resp);
+            }
         }
     }
 
-    pthread_cleanup_pop(1);
-}
+    // I blocchi rimasti nella cache del worker tornano all'arena, in modo che possano essere riutilizzati o deallocati
+    slab_thread_flush(&storage->arena);
 
-int check_request(storage *storage, char *request_m, int socket_fd, int max) {
-    f_el *victims;
-    f_el *victim;
+    return NULL;
+}
 
-    char *request_code;
+int check_request(storage *storage, frame_header *header, char *request_m, f_data *data, read_cursor *cursor, int socket_fd, response **resp) {
+    f_el *victims = NULL;
+    f_data *read_data = NULL;
 
     char *pathname;
     char *content;
-    char *flags_string;
+    long content_size;
     int flags;
     int n;
-    char *read_file;
+    int more = 0;
 
-    char *response_m;
-    int response_size = 0;
-    int result;
-    char *save_tok;
+    file_range range;
+    long read_offset = 0;
 
-    char delimiter[2] = {1, '\0'};
+    char *response_m = NULL;
+    long response_size = 0;
+    int response_code = UNKNOWN;
+    int result;
 
-    // Estrae la tipologia della richiesta da request_m
-    request_code = strtok_r(request_m, delimiter, &save_tok);
+    // Il filename e il payload sono già separati nel buffer della richiesta, il payload di WRITEFILE e PUTFILE può essere già in data
+    pathname = request_m;
+    content = request_m + header->name_len + 1;
+    content_size = header->payload_len;
 
     // Verifica il tipo di richiesta, la elabora e genera il messaggio di risposta
-    if(request_code != NULL && strcmp(request_code, CLOSECONN) == 0){
+    if(header->opcode == CLOSECONN){
         // È richiesta la chiusura della connessione
-        response_size = 2;
-
-        response_m = malloc(2 * sizeof(char));
-
-        strcpy(response_m, SUCCESS);
+        response_code = SUCCESS;
 
         result = 1;
-    } else if(request_code != NULL && strcmp(request_code, OPENFILE) == 0) {
+    } else if(header->opcode == OPENFILE) {
         // È richiesta l'apertura di un file
-        pathname = strtok_r(NULL, delimiter, &save_tok);
-        flags_string = strtok_r(NULL, delimiter, &save_tok);
-        flags = (int)strtol(flags_string, NULL, 10);
+        flags = header->flags;
 
         errno = 0;
-        victim = openFile(storage, pathname, flags, socket_fd, max);
+        victims = openFile(storage, pathname, flags, socket_fd);
 
-        // Genera il messaggio di risposta
+        // Genera il messaggio di risposta, l'eventuale file espulso è inviato come payload
         if(errno == 0) {
-            if(victim == NULL) {
-                response_size = 2;
-
-                response_m = malloc(2 * sizeof(char));
-
-                strcpy(response_m, SUCCESS);
-            } else {
-                response_size = 2 + strlen(victim->metadata.filename) + 1 + strlen(victim->data) + 1;
-
-                response_m = malloc(response_size + sizeof(char));
-
-                strcpy(response_m, SUCCESS);
-                strcat(response_m, delimiter);
-                strcat(response_m, victim->metadata.filename);
-                strcat(response_m, delimiter);
-                strcat(response_m, victim->data);
-
-                free(victim->data);
-                free(victim);
-            }
+            response_code = SUCCESS;
 
             result = 0;
         } else {
             result = -1;
         }
-    } else if(request_code != NULL && strcmp(request_code, CLOSEFILE) == 0) {
+    } else if(header->opcode == CLOSEFILE) {
         // È richiesta la chiusura di un file
-        pathname = strtok_r(NULL, delimiter, &save_tok);
-
-        result = closeFile(storage, pathname, socket_fd, max);
+        result = closeFile(storage, pathname, socket_fd);
 
         // Genera il messaggio di risposta
         if(result == 0) {
-            response_size = 2;
-
-            response_m = malloc(2 * sizeof(char));
-
-            strcpy(response_m, SUCCESS);
+            response_code = SUCCESS;
 
             result = 0;
         } else {
             result = -1;
         }
-    } else if(request_code != NULL && strcmp(request_code, WRITEFILE) == 0) {
+    } else if(header->opcode == WRITEFILE) {
         // È richiesta la scrittura di un file
-        int i = 0;
-
-        pathname = strtok_r(NULL, delimiter, &save_tok);
-        content = strtok_r(NULL, delimiter, &save_tok);
-
         errno = 0;
-        victims = writeFile(storage, pathname, socket_fd, content, max);
+        victims = writeFile(storage, pathname, socket_fd, content, content_size, data);
 
         // Genera il messaggio di risposta
         if(victims != NULL || (victims == NULL && errno == 0)) {
-            // Calcola la dimensione della risposta
-            if(victims == NULL) {
-                response_size = 2;
+            response_code = SUCCESS;
 
-                response_m = malloc(2 * sizeof(char));
+            result = 0;
+        } else {
+            result = -1;
+        }
+    } else if(header->opcode == PUTFILE) {
+        // È richiesta la creazione di un file con il suo contenuto, eseguita con una sola ricerca del file
+        errno = 0;
+        victims = putFile(storage, pathname, socket_fd, content, content_size, data);
 
-                strcpy(response_m, SUCCESS);
-            } else {
-                response_size = 2;
-
-                i = 0;
-                while(victims[i].data != NULL) {
-                    response_size += 1;
-                    response_size += strlen(victims[i].metadata.filename);
-                    response_size += 1;
-                    response_size += strlen(victims[i].data);
-
-                    i++;
-                }
-
-                response_m = malloc((response_size) * sizeof(char));
-
-                // Scrive il messaggio di risposta
-                strcpy(response_m, SUCCESS);
-                i = 0;
-                while(victims[i].data != NULL) {
-                    strcat(response_m, delimiter);
-                    strcat(response_m, victims[i].metadata.filename);
-                    strcat(response_m, delimiter);
-                    strcat(response_m, victims[i].data);
-
-                    free(victims[i].data);
-                    i++;
-                }
-                
-                free(victims);
-            }
+        // Genera il messaggio di risposta
+        if(victims != NULL || errno == 0) {
+            response_code = SUCCESS;
 
             result = 0;
         } else {
             result = -1;
         }
-    } else if(request_code != NULL && strcmp(request_code, READFILE) == 0) {
-        // È richiesta la lettura di un file
-        pathname = strtok_r(NULL, delimiter, &save_tok);
+    } else if(header->opcode == READFILE || header->opcode == GETFILE) {
+        // È richiesta la lettura di un file, con GETFILE senza aprirlo
+        read_data = header->opcode == READFILE ? readFile(storage, pathname, socket_fd) : getFile(storage, pathname, socket_fd);
 
-        content = readFile(storage, pathname, socket_fd);
+        // Genera il messaggio di risposta, il contenuto del file viene inviato direttamente dal buffer dello storage, un file vuoto non ha contenuto
+        if(read_data != NULL || errno == 0) {
+            response_code = SUCCESS;
+            response_size = read_data != NULL ? data_size(read_data) : 0;
+
+            result =  0;
+        } else {
+            result = -1;
+        }
+    } else if(header->opcode == READRANGE) {
+        // È richiesta la lettura di un intervallo di byte di un file
+        if(content_size == sizeof(file_range)) {
+            memcpy(&range, content, sizeof(file_range));
+
+            // Il contenuto viene inviato direttamente dai chunk che contengono l'intervallo
+            errno = 0;
+            read_data = readFileRange(storage, pathname, socket_fd, range.offset, range.length, &response_size);
+            read_offset = range.offset;
+        } else {
+            errno = EINVAL;
+        }
 
         // Genera il messaggio di risposta
-        if(content != NULL) {
-            response_size = 3 + strlen(content);
+        if(read_data != NULL || errno == 0) {
+            response_code = SUCCESS;
+
+            result = 0;
+        } else {
+            result = -1;
+        }
+    } else if(header->opcode == WRITEAT) {
+        // È richiesta la scrittura di byte a partire da una posizione del file
+        errno = EINVAL;
 
-            response_m = malloc(response_size * sizeof(char));
+        if(content_size >= (long)sizeof(file_range)) {
+            memcpy(&range, content, sizeof(file_range));
 
-            strcpy(response_m, SUCCESS);
-            strcat(response_m, delimiter);
-            strcat(response_m, content);
+            // I byte da scrivere seguono l'intervallo nel payload
+            if(range.length == content_size - sizeof(file_range)) {
+                errno = 0;
+                victims = writeFileAt(storage, pathname, socket_fd, range.offset, content + sizeof(file_range), range.length);
+            }
+        }
 
-            result =  0;
+        // Genera il messaggio di risposta
+        if(victims != NULL || errno == 0) {
+            response_code = SUCCESS;
+
+            result = 0;
         } else {
             result = -1;
         }
-    } else if(request_code != NULL && strcmp(request_code, READNFILE) == 0){
-        // È richiesta la lettura di n file
-        n = (int)strtol(strtok_r(NULL, delimiter, &save_tok), NULL, 10);
+    } else if(header->opcode == READNFILE){
+        // È richiesta la lettura di n file, eseguita un passo alla volta, il primo passo inizializza il cursore con il numero di file richiesto
+        errno = EINVAL;
 
-        read_file = readNFiles(storage, n, socket_fd);
+        if(header->flags & MORE_FRAMES) {
+            errno = 0;
+        } else if(content_size == sizeof(int)) {
+            memcpy(&n, content, sizeof(int));
 
-        // Genera il messaggio di risposta
-        if(read_file != NULL) {
-            response_size = 3 + strlen(read_file);
+            if(n >= 0) {
+                read_cursor_init(cursor, n);
 
-            response_m = malloc(response_size * sizeof(char));
+                errno = 0;
+            }
+        }
 
-            strcpy(response_m, SUCCESS);
-            strcat(response_m, delimiter);
-            strcat(response_m, read_file);
+        if(errno == 0) {
+            // I file letti sono inviati come i file espulsi, un frame per file con il contenuto preso dai buffer dello storage
+            victims = readNFiles(storage, cursor, socket_fd, &more);
+        }
 
-            free(read_file);
+        // Genera il messaggio di risposta
+        if(victims != NULL || errno == 0) {
+            response_code = SUCCESS;
 
             result = 0;
         } else {
             result = -1;
         }
-    } else if(request_code != NULL && strcmp(request_code, LOCKFILE) == 0) {
+    } else if(header->opcode == LOCKFILE) {
         // È richiesta l'acquisizione della lock su un file
-        pathname = strtok_r(NULL, delimiter, &save_tok);
-
         result = lockFile(storage, pathname, socket_fd);
 
         // Genera il messaggio di risposta
         if(result == 0) {
-            response_size = 2;
-
-            response_m = malloc(2 * sizeof(char));
-
-            strcpy(response_m, SUCCESS);
+            response_code = SUCCESS;
 
             result = 0;
         } else {
             result = -1;
         }
-    } else if(request_code != NULL && strcmp(request_code, UNLOCKFILE) == 0) {
+    } else if(header->opcode == UNLOCKFILE) {
         // È richiesto il rilascio della lock su un file
-        char *pathname = strtok_r(NULL, delimiter, &save_tok);
-
         result = unlockFile(storage, pathname, socket_fd);
         if(result == 0) {
-            response_size = 2;
-
-            response_m = malloc(2 * sizeof(char));
-
-            strcpy(response_m, SUCCESS);
+            response_code = SUCCESS;
 
             result = 0;
         } else {
             result = -1;
         }
-    } else if(request_code != NULL && strcmp(request_code, REMOVEFILE) == 0) { 
+    } else if(header->opcode == REMOVEFILE) {
         // È richiesta la rimozione di un file
-        char *pathname = strtok_r(NULL, delimiter, &save_tok);
-
         result = removeFile(storage, pathname, socket_fd);
 
         // Genera il messaggio di risposta
         if(result == 0) {
-            response_size = 2;
-
-            response_m = malloc(2 * sizeof(char));
-
-            strcpy(response_m, SUCCESS);
+            response_code = SUCCESS;
 
             result = 0;
         } else {
             result = -1;
         }
-
-        if((pthread_mutex_lock(&lock_storage)) != 0) {
-            print_ht(storage->ht, storage->size.size_ht);
-        }
-
-        pthread_mutex_unlock(&lock_storage);
-    } else if(request_code != NULL && strcmp(request_code, APPENDFILE) == 0) {
+    } else if(header->opcode == APPENDFILE) {
         // È richiesta l'operazione di scrittura in concatenazione al file
-        int i = 0;
-
-        pathname = strtok_r(NULL, delimiter, &save_tok);
-        content = strtok_r(NULL, delimiter, &save_tok);
-
         errno = 0;
-        victims = appendToFile(storage, pathname, socket_fd, content, max);
+        victims = appendToFile(storage, pathname, socket_fd, content, content_size);
 
         // Genera il messaggio di risposta
         if(victims != NULL || (victims == NULL && errno == 0)) {
-            // Calcola la dimensione della risposta
-            if(victims == NULL) {
-                response_size = 2;
-
-                response_m = malloc(2 * sizeof(char));
-
-                strcpy(response_m, SUCCESS);
-            } else {
-                response_size = 2;
-
-                i = 0;
-                while(victims[i].data != NULL) {
-                    response_size += 1;
-                    response_size += strlen(victims[i].metadata.filename);
-                    response_size += 1;
-                    response_size += strlen(victims[i].data);
-
-                    i++;
-                }
-
-                response_m = malloc((response_size) * sizeof(char));
-
-                // Scrive il messaggio di risposta
-                strcpy(response_m, SUCCESS);
-                i = 0;
-                while(victims[i].data != NULL) {
-                    strcat(response_m, delimiter);
-                    strcat(response_m, victims[i].metadata.filename);
-                    strcat(response_m, delimiter);
-                    strcat(response_m, victims[i].data);
-
-                    i++;
-                }
-
-                free(victims);
-            }
+            response_code = SUCCESS;
 
             result = 0;
         } else {
             result = -1;
         }
-    } else if(request_code != NULL && strcmp(request_code, WRITE_NO_CONTENT) == 0) {
+    } else if(header->opcode == WRITE_NO_CONTENT) {
             write_no_content(storage);
-            
-            response_size = 2;
 
-            response_m = malloc(3 * sizeof(char));
-
-            strcpy(response_m, SUCCESS);
+            response_code = SUCCESS;
 
             result = 0;
     } else {
@@ -443,83 +375,210 @@ int check_request(storage *storage, char *request_m, int socket_fd, int max) {
     }
 
     if(result == -1) {
-        // Si è verificato un errore
-        response_size = 2;
-
-        response_m = malloc(2 * sizeof(char));
+        // Si è verificato un errore, la risposta non contiene alcun payload
+        response_size = 0;
 
         // Scrive il codice di errore nel messaggio di risposta
         switch(errno) {
             case EBADR:
-                strcpy(response_m, ALREADY_OPENED);
+                response_code = ALREADY_OPENED;
 
                 result = 0;
 
                 break;
             case ENOENT:
-                strcpy(response_m, FILE_NOT_EXIST);
+                response_code = FILE_NOT_EXIST;
 
                 result = 0;
 
                 break;
             case EINVAL:
-                strcpy(response_m, UNKNOWN);
+                response_code = UNKNOWN;
 
                 result = 0;
 
                 break;
             case ENAMETOOLONG:
-                strcpy(response_m, FILENAME_TOO_LONG);
+                response_code = FILENAME_TOO_LONG;
 
                 result = 0;
 
                 break;
             case EEXIST:
-                strcpy(response_m, FILE_ALREADY_EXIST);
+                response_code = FILE_ALREADY_EXIST;
 
                 result = 0;
 
                 break;
             case EBADF:
-                strcpy(response_m, FILE_NOT_OPENED);
+                response_code = FILE_NOT_OPENED;
 
                 result = 0;
-                
+
                 break;
             case EPERM:
-                strcpy(response_m, FILE_LOCKED);
+                response_code = FILE_LOCKED;
 
                 result = 0;
-                
+
                 break;
             case ENOMEM:
-                strcpy(response_m, NOT_ENO_MEM);
+                response_code = NOT_ENO_MEM;
 
                 result = 0;
 
                 break;
         }
-    } 
+    }
 
-    // Invia la dimensione della risposta al client
-    if(write(socket_fd, &response_size, sizeof(int)) == -1) {
-        perror("WORKER: Scrivendo al client");
+    if((*resp = malloc(sizeof(response))) == NULL) {
+        // Non è possibile consegnare la risposta al manager, la connessione viene chiusa
+        perror("WORKER: Allocando la risposta");
 
-        result = 1;
+        free(response_m);
+        data_release(&storage->arena, read_data);
+        release_victims(storage, victims);
+
+        return 1;
+    }
+
+    (*resp)->header.version = PROTOCOL_VERSION;
+    (*resp)->header.opcode = response_code;
+    (*resp)->header.flags = more ? MORE_FRAMES : 0;
+    (*resp)->header.name_len = 0;
+    (*resp)->header.payload_len = response_size;
+    (*resp)->header.request_id = header->request_id;
+
+    // La risposta possiede i buffer da inviare, che sono rilasciati dal manager al termine dell'invio
+    (*resp)->payload = response_m;
+    (*resp)->data = read_data;
+    (*resp)->victims = victims;
+    (*resp)->victims_h = NULL;
+    (*resp)->iov_alloc = NULL;
+    (*resp)->src = NULL;
+    (*resp)->storage = storage;
+    (*resp)->resume = NULL;
+    (*resp)->next = NULL;
+
+    if(victims != NULL && ((*resp)->iov_alloc = encode_victims(victims, (header->flags & DISCARD_VICTIMS) != 0, &(*resp)->victims_h, &(*resp)->src, &(*resp)->iovcnt, &response_size)) != NULL) {
+        (*resp)->header.payload_len = response_size;
+        (*resp)->iov = (*resp)->iov_alloc;
+    } else if(read_data != NULL && (n = data_iov(read_data, read_offset, response_size, NULL, NULL)) > 1) {
+        // Il contenuto occupa più chunk, ognuno inviato dal proprio buffer senza essere copiato, le origini seguono i buffer nello stesso blocco
+        if(((*resp)->iov_alloc = malloc((1 + n) * (sizeof(struct iovec) + sizeof(data_source)))) == NULL) {
+            perror("WORKER: Allocando i buffer della risposta");
+
+            response_free(*resp);
+            *resp = NULL;
+
+            return 1;
+        }
+
+        (*resp)->iov = (*resp)->iov_alloc;
+        (*resp)->src = (data_source *)((*resp)->iov_alloc + 1 + n);
+        (*resp)->src[0].fd = -1;
+        (*resp)->iovcnt = 1 + data_iov(read_data, read_offset, response_size, (*resp)->iov + 1, (*resp)->src + 1);
     } else {
-        // Invia il messaggio di risposta al client
-        if(write(socket_fd, response_m, response_size) == -1) {
-            perror("WORKER: Scrivendo al client");
-                
-            result = 1;
+        if(victims != NULL) {
+            // Non è possibile consegnare i file espulsi, il client ne è informato con un errore invece di ricevere un successo vuoto
+            perror("WORKER: Codificando i frame dei file");
+
+            (*resp)->header.opcode = NOT_ENO_MEM;
+            (*resp)->header.flags = 0;
+            (*resp)->header.payload_len = 0;
+        }
+
+        (*resp)->iov = (*resp)->inline_iov;
+        (*resp)->iovcnt = 2;
+
+        (*resp)->iov[1].iov_base = response_m;
+        (*resp)->iov[1].iov_len = (*resp)->header.payload_len;
+
+        if(read_data != NULL) {
+            // Il contenuto, o l'intervallo richiesto, è contenuto in un solo chunk
+            (*resp)->src = (*resp)->inline_src;
+            (*resp)->src[0].fd = -1;
+            (*resp)->src[1].fd = -1;
+
+            data_iov(read_data, read_offset, (*resp)->header.payload_len, (*resp)->iov + 1, (*resp)->src + 1);
         }
     }
 
-    free(response_m);
+    (*resp)->iov[0].iov_base = &(*resp)->header;
+    (*resp)->iov[0].iov_len = sizeof(frame_header);
 
     return result;
 }
 
-static void cleanup_handler(void *arg) {
-    pthread_mutex_unlock(&lock_queue);
-}
\ No newline at end of file
+struct iovec *encode_victims(f_el *victims, int discard, frame_header **headers, data_source **src, int *iovcnt, long *size) {
+    struct iovec *iov;
+    frame_header *frame;
+    f_el *victim;
+
+    int n = 0;
+    int n_iov = 1;
+    int i;
+
+    for(victim = victims; victim != NULL; victim = victim->metadata.lru_next) {
+        n++;
+    }
+
+    if((*headers = malloc(n * sizeof(frame_header))) == NULL) {
+        errno = ENOMEM;
+
+        return NULL;
+    }
+
+    // La dimensione di ogni contenuto è letta una sola volta, il buffer di un file letto può crescere durante l'invio
+    for(victim = victims, frame = *headers; victim != NULL; victim = victim->metadata.lru_next, frame++) {
+        frame->version = PROTOCOL_VERSION;
+        frame->opcode = SUCCESS;
+        frame->flags = discard ? DISCARD_VICTIMS : 0;
+        frame->name_len = strlen(victim->metadata.filename);
+        frame->payload_len = victim->data != NULL ? data_size(victim->data) : 0;
+        frame->request_id = 0;
+
+        n_iov += 2;
+
+        if(!discard && frame->payload_len > 0) {
+            n_iov += data_iov(victim->data, 0, frame->payload_len, NULL, NULL);
+        }
+    }
+
+    if((iov = malloc(n_iov * (sizeof(struct iovec) + sizeof(data_source)))) == NULL) {
+        free(*headers);
+
+        errno = ENOMEM;
+
+        return NULL;
+    }
+
+    *src = (data_source *)(iov + n_iov);
+    (*src)[0].fd = -1;
+
+    *size = 0;
+    i = 1;
+
+    // Descrive un frame per ogni file espulso, i file vuoti hanno un frame senza contenuto
+    for(victim = victims, frame = *headers; victim != NULL; victim = victim->metadata.lru_next, frame++) {
+        (*src)[i].fd = -1;
+        iov[i].iov_base = frame;
+        iov[i++].iov_len = sizeof(frame_header);
+        (*src)[i].fd = -1;
+        iov[i].iov_base = victim->metadata.filename;
+        iov[i++].iov_len = frame->name_len;
+
+        *size += sizeof(frame_header) + frame->name_len;
+
+        if(!discard && frame->payload_len > 0) {
+            // Il contenuto è inviato direttamente dai chunk del buffer
+            i += data_iov(victim->data, 0, frame->payload_len, iov + i, *src + i);
+
+            *size += frame->payload_len;
+        }
+    }
+
+    *iovcnt = i;
+
+    return iov;
+}